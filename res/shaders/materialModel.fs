@@ -1,13 +1,9 @@
 #version 330 core
+// variants: SPOT_LIGHT, DIR_LIGHT, POINT_LIGHTS (NR_POINT_LIGHTS of them) and SHADOWS,
+// only the enabled paths are compiled in. UBER_ASTEROID adds the reflect/refract materials,
+// chosen per instance, so every asteroid type draws with this one program
 out vec4 FragColor;
 
-struct Material {
-    vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
-    float shininess;
-}; 
-
 struct DirLight {
     vec3 direction;
 	
@@ -28,37 +24,77 @@ struct PointLight {
     vec3 specular;
 };
 
+// std140 packs each vec3 with the float after it, keep in sync with SpotLightUniforms
 struct SpotLight {
     vec3 position;
-    vec3 direction;
     float cutOff;
+    vec3 direction;
     float outerCutOff;
-  
+
+    vec3 ambient;
     float constant;
+    vec3 diffuse;
     float linear;
+    vec3 specular;
     float quadratic;
-  
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;       
 };
 
-#define NR_SPOT_LIGHTS 2
+#ifdef SHADOWS
+#define SHADOW_FACTOR ShadowCalculation(FragPosLightSpace)
+#else
+#define SHADOW_FACTOR 0.0
+#endif
+
+#ifndef NR_POINT_LIGHTS
+#define NR_POINT_LIGHTS 1
+#endif
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+#ifdef SHADOWS
 in vec4 FragPosLightSpace;
+#endif
+#ifdef UBER_ASTEROID
+flat in int MaterialType;
+
+uniform samplerCube skybox;
+
+#define MATERIAL_LIT 0
+#define MATERIAL_REFLECT 1
+#define MATERIAL_REFRACT 2
+#endif
 
-uniform vec3 viewPos;
-uniform SpotLight spotLight;
+// shared with every program through the binding points in uniformBuffers.h
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPos;
+};
+
+layout (std140) uniform Lights
+{
+    SpotLight spotLight;
+};
+
+layout (std140) uniform Material
+{
+    vec3 ambient;
+    float shininess;
+    vec3 specular;
+} material;
+
+#ifdef DIR_LIGHT
 uniform DirLight dirLight;
-uniform Material material;
+#endif
+#ifdef POINT_LIGHTS
+uniform PointLight pointLights[NR_POINT_LIGHTS];
+#endif
 uniform sampler2D texture_diffuse1;
+#ifdef SHADOWS
 uniform sampler2D shadowMap;
-
-
-uniform vec3 lightPos;
+#endif
 
 // function prototypes
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
@@ -70,10 +106,30 @@ void main()
 {    
     // properties
     vec3 norm = normalize(Normal);
-    vec3 viewDir = normalize(viewPos - FragPos); 
+    vec3 viewDir = normalize(cameraPos - FragPos); 
+
+#ifdef UBER_ASTEROID
+	// the type is flat per primitive and instances are sorted by it, so neighbouring
+	// fragments almost always take the same side of this branch
+	if (MaterialType != MATERIAL_LIT)
+	{
+		vec3 R = MaterialType == MATERIAL_REFLECT ? reflect(-viewDir, norm) : refract(-viewDir, norm, 1.00 / 1.52);
+		FragColor = vec4(texture(skybox, R).rgb, 1.0);
+		return;
+	}
+#endif
 	
-	vec3 result = CalcSpotLight(spotLight, norm, FragPos, viewDir);
-	//vec3 result = CalcDirLight(dirLight, norm, viewDir) + CalcSpotLight(spotLight, norm, FragPos, viewDir);	
+	vec3 result = vec3(0.0);
+#ifdef DIR_LIGHT
+	result += CalcDirLight(dirLight, norm, viewDir);
+#endif
+#ifdef POINT_LIGHTS
+	for (int i = 0; i < NR_POINT_LIGHTS; i++)
+		result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);
+#endif
+#ifdef SPOT_LIGHT
+	result += CalcSpotLight(spotLight, norm, FragPos, viewDir);
+#endif
     
     FragColor = vec4(result * vec3(texture(texture_diffuse1, TexCoords)), 1.0);
 	//FragColor = vec4(result * vec3(texture(texture_diffuse1, TexCoords)), 1.0);
@@ -82,6 +138,9 @@ void main()
 //shadow
 float ShadowCalculation(vec4 fragPosLightSpace)
 {
+#ifndef SHADOWS
+    return 0.0;
+#else
     // perform perspective divide
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     // transform to [0,1] range
@@ -95,6 +154,7 @@ float ShadowCalculation(vec4 fragPosLightSpace)
     float shadow = currentDepth - bias > closestDepth  ? 1.0 : 0.0;
 
     return shadow;
+#endif
 }
 
 // calculates the color when using a directional light.
@@ -111,7 +171,7 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     vec3 diffuse = light.diffuse * diff * vec3(texture(texture_diffuse1, TexCoords));
     vec3 specular = light.specular * (spec * material.specular);
 	//shadow calculations
-	float shadow = ShadowCalculation(FragPosLightSpace);
+	float shadow = SHADOW_FACTOR;
     return (ambient + (1.0 - shadow) * (diffuse + specular));
 }
 
@@ -134,7 +194,7 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
-    float shadow = ShadowCalculation(FragPosLightSpace);
+    float shadow = SHADOW_FACTOR;
     return (ambient + (1.0 - shadow) * (diffuse + specular));
 }
 
@@ -163,7 +223,6 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     specular *= attenuation * intensity;
 	
 	//shadow calculations
-	float shadow = ShadowCalculation(FragPosLightSpace);
-    //return (ambient + (1.0 - shadow) * (diffuse + specular));
-	return (ambient + diffuse + specular);
+	float shadow = SHADOW_FACTOR;
+    return (ambient + (1.0 - shadow) * (diffuse + specular));
 }
\ No newline at end of file
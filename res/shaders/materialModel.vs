@@ -0,0 +1,54 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+#ifdef INSTANCED
+layout (location = 5) in mat4 instanceModel;
+layout (location = 9) in mat3 instanceNormal; // normal matrix of instanceModel, filled per instance on the CPU
+#endif
+#ifdef UBER_ASTEROID
+layout (location = 12) in vec4 instanceParams; // x: material, 0 lit, 1 reflect, 2 refract
+
+flat out int MaterialType;
+#endif
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+#ifdef SHADOWS
+out vec4 FragPosLightSpace;
+
+uniform mat4 lightSpaceMatrix;
+#endif
+
+#ifndef INSTANCED
+uniform mat4 model;
+uniform mat3 normalMatrix; // transpose(inverse(mat3(model))), computed once per draw on the CPU
+#endif
+
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPos;
+};
+
+void main()
+{
+#ifdef INSTANCED
+    FragPos = vec3(instanceModel * vec4(aPos, 1.0));
+    Normal = instanceNormal * aNormal;
+#else
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = normalMatrix * aNormal;
+#endif
+	TexCoords = aTexCoords;
+#ifdef UBER_ASTEROID
+    MaterialType = int(instanceParams.x);
+#endif
+#ifdef SHADOWS
+    FragPosLightSpace = lightSpaceMatrix * vec4(FragPos, 1.0);
+#endif
+	
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,33 @@
+#version 330 core
+// variants: REFLECT or REFRACT sample the skybox around the surface, FLAT is a plain colour (bullets)
+out vec4 FragColor;
+
+#ifndef FLAT
+in vec3 Normal;
+in vec3 Position;
+
+uniform samplerCube skybox;
+
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPos;
+};
+#endif
+
+void main()
+{             
+#if defined(REFRACT)
+	float ratio = 1.00 / 1.52;
+	vec3 I = normalize(Position - cameraPos);
+	vec3 R = refract(I, normalize(Normal), ratio);
+	FragColor = vec4(texture(skybox, R).rgb, 1.0);
+#elif defined(REFLECT)
+	vec3 I = normalize(Position - cameraPos);
+	vec3 R = reflect(I, normalize(Normal));
+	FragColor = vec4(texture(skybox, R).rgb, 1.0);
+#else
+	FragColor = vec4(1.0, 1.0, 0.0, 1.0);
+#endif
+}
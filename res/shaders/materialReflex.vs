@@ -0,0 +1,30 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+#ifndef FLAT
+out vec3 Normal;
+out vec3 Position;
+#endif
+
+uniform mat4 model;
+#ifndef FLAT
+uniform mat3 normalMatrix; // transpose(inverse(mat3(model))), computed once per draw on the CPU
+#endif
+
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPos;
+};
+
+void main()
+{
+	vec4 worldPos = model * vec4(aPos, 1.0);
+#ifndef FLAT
+	Normal = normalMatrix * aNormal;
+	Position = vec3(worldPos);
+#endif
+	gl_Position = projection * view * worldPos;
+}  
@@ -0,0 +1,18 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+out vec3 TexCoords;
+
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPos;
+};
+
+void main()
+{
+    TexCoords = aPos;
+    vec4 pos = projection * mat4(mat3(view)) * vec4(aPos, 1.0); // translation removed, the sky stays put
+    gl_Position = pos.xyww;
+}  
\ No newline at end of file
@@ -0,0 +1,217 @@
+#pragma once
+#ifndef ASSET_ARCHIVE_H
+#define ASSET_ARCHIVE_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "mappedFile.h"
+#include "assetPath.h"
+#include "logger.h"
+using namespace std;
+
+// Every asset the game loads packed into one file, mapped as a whole:
+//   header | entries sorted by path | path names | 16-byte aligned file contents
+// An entry keeps the packed file's size and time, so the caches' source checks work on packed
+// sources as they do on loose ones. Contents are aligned like the caches' own blobs, so a packed
+// mesh cache keeps its vertex data aligned. The cook tool writes it (asteroids-cook --pack).
+const unsigned int ASSET_ARCHIVE_MAGIC = 0x4B415041; // "APAK"
+const unsigned int ASSET_ARCHIVE_VERSION = 1;
+
+struct AssetArchiveHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int entryCount;
+	unsigned int namesSize;
+};
+
+struct AssetArchiveEntry {
+	unsigned long long offset;
+	unsigned long long size;
+	unsigned long long time;
+	unsigned int nameOffset; // into the names, which follow the entries
+	unsigned int nameLength;
+};
+
+class AssetArchive {
+private:
+	MappedFile file;
+	const AssetArchiveHeader *header;
+	const AssetArchiveEntry *entries;
+	const char *names;
+
+	AssetArchive(const AssetArchive &other);
+	AssetArchive &operator=(const AssetArchive &other);
+
+	static size_t align(size_t offset) {
+		return (offset + 15) & ~(size_t)15;
+	}
+
+	bool validate() {
+		size_t fileSize = file.getSize();
+		if (fileSize < sizeof(AssetArchiveHeader)) {
+			return false;
+		}
+		header = (const AssetArchiveHeader*)file.getData();
+		if (header->magic != ASSET_ARCHIVE_MAGIC || header->version != ASSET_ARCHIVE_VERSION) {
+			return false;
+		}
+		size_t namesStart = sizeof(AssetArchiveHeader) + (size_t)header->entryCount * sizeof(AssetArchiveEntry);
+		if (namesStart + header->namesSize > fileSize) {
+			return false;
+		}
+		entries = (const AssetArchiveEntry*)(file.getData() + sizeof(AssetArchiveHeader));
+		names = (const char*)file.getData() + namesStart;
+		for (unsigned int i = 0; i < header->entryCount; i++) {
+			if ((unsigned long long)entries[i].nameOffset + entries[i].nameLength > header->namesSize
+				|| entries[i].offset + entries[i].size > fileSize) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	int compareName(const AssetArchiveEntry &entry, const string &name) const {
+		int order = strncmp(names + entry.nameOffset, name.c_str(), min((size_t)entry.nameLength, name.size()));
+		if (order != 0) {
+			return order;
+		}
+		return entry.nameLength < name.size() ? -1 : entry.nameLength > name.size() ? 1 : 0;
+	}
+
+public:
+	AssetArchive() {
+		header = NULL;
+		entries = NULL;
+		names = NULL;
+	}
+
+	// maps the archive; false if there is none or it isn't one
+	bool open(const string &archivePath) {
+		if (!file.open(archivePath)) {
+			return false;
+		}
+		if (!validate()) {
+			logWarning(CATEGORY_ASSETS, "{} is not an asset archive of this version", archivePath);
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close() {
+		file.close();
+		header = NULL;
+	}
+
+	bool isOpen() const {
+		return header != NULL;
+	}
+
+	int getEntryCount() const {
+		return header->entryCount;
+	}
+
+	// binary search by canonical path; NULL if the archive doesn't have it
+	const AssetArchiveEntry *find(const string &path) const {
+		if (header == NULL) {
+			return NULL;
+		}
+		string name = canonicalAssetPath(path);
+		int low = 0, high = (int)header->entryCount - 1;
+		while (low <= high) {
+			int middle = (low + high) / 2;
+			int order = compareName(entries[middle], name);
+			if (order == 0) {
+				return &entries[middle];
+			}
+			if (order < 0) {
+				low = middle + 1;
+			}
+			else {
+				high = middle - 1;
+			}
+		}
+		return NULL;
+	}
+
+	const unsigned char *getData(const AssetArchiveEntry &entry) const {
+		return file.getData() + entry.offset;
+	}
+
+	// packs files (paths relative to the directory the game runs in) into archivePath
+	static bool write(const string &archivePath, const vector<string> &files) {
+		vector<string> sorted;
+		for (int i = 0; i < files.size(); i++) {
+			sorted.push_back(canonicalAssetPath(files[i]));
+		}
+		sort(sorted.begin(), sorted.end());
+		sorted.erase(unique(sorted.begin(), sorted.end()), sorted.end());
+
+		AssetArchiveHeader header;
+		header.magic = ASSET_ARCHIVE_MAGIC;
+		header.version = ASSET_ARCHIVE_VERSION;
+		header.entryCount = sorted.size();
+		header.namesSize = 0;
+		vector<AssetArchiveEntry> entries(sorted.size());
+		for (int i = 0; i < sorted.size(); i++) {
+			struct stat status;
+			if (stat(sorted[i].c_str(), &status) != 0) {
+				logError(CATEGORY_ASSETS, "could not pack {}", sorted[i]);
+				return false;
+			}
+			entries[i].size = status.st_size;
+			entries[i].time = status.st_mtime;
+			entries[i].nameOffset = header.namesSize;
+			entries[i].nameLength = sorted[i].size();
+			header.namesSize += sorted[i].size();
+		}
+		size_t offset = align(sizeof(AssetArchiveHeader) + entries.size() * sizeof(AssetArchiveEntry) + header.namesSize);
+		for (int i = 0; i < entries.size(); i++) {
+			entries[i].offset = offset;
+			offset = align(offset + entries[i].size);
+		}
+
+		// written next to the archive and moved over it, a failed pack leaves the old one intact
+		string temporary = archivePath + ".tmp";
+		ofstream out(temporary.c_str(), ios::binary | ios::trunc);
+		out.write((const char*)&header, sizeof(header));
+		if (!entries.empty()) {
+			out.write((const char*)&entries[0], entries.size() * sizeof(AssetArchiveEntry));
+		}
+		for (int i = 0; i < sorted.size(); i++) {
+			out.write(sorted[i].data(), sorted[i].size());
+		}
+		const char padding[16] = { 0 };
+		for (int i = 0; i < sorted.size() && out; i++) {
+			out.write(padding, entries[i].offset - (size_t)out.tellp());
+			MappedFile source;
+			if (entries[i].size > 0 && (!source.open(sorted[i]) || source.getSize() != entries[i].size)) {
+				logError(CATEGORY_ASSETS, "could not pack {}", sorted[i]);
+				out.setstate(ios::failbit);
+				break;
+			}
+			out.write((const char*)source.getData(), source.getSize());
+		}
+		out.close();
+		if (!out) {
+			logError(CATEGORY_ASSETS, "could not write {}", archivePath);
+			remove(temporary.c_str());
+			return false;
+		}
+		remove(archivePath.c_str());
+		if (rename(temporary.c_str(), archivePath.c_str()) != 0) {
+			logError(CATEGORY_ASSETS, "could not replace {}", archivePath);
+			remove(temporary.c_str());
+			return false;
+		}
+		return true;
+	}
+};
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+#ifndef ASSET_PATH_H
+#define ASSET_PATH_H
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Same file, same key: separators unified, "./" and "dir/../" folded, and case folded on Windows
+// where the file system ignores it.
+inline string canonicalAssetPath(const string &path) {
+	string unified = path;
+	replace(unified.begin(), unified.end(), '\\', '/');
+#ifdef _WIN32
+	transform(unified.begin(), unified.end(), unified.begin(), ::tolower);
+#endif
+	vector<string> parts;
+	size_t start = 0;
+	while (start <= unified.size()) {
+		size_t end = unified.find('/', start);
+		if (end == string::npos) {
+			end = unified.size();
+		}
+		string part = unified.substr(start, end - start);
+		if (part == "..") {
+			if (!parts.empty() && parts.back() != ".." && !parts.back().empty()) {
+				parts.pop_back();
+			}
+			else {
+				parts.push_back(part);
+			}
+		}
+		else if (part != "." && !(part.empty() && !parts.empty())) {
+			parts.push_back(part);
+		}
+		start = end + 1;
+	}
+	string canonical;
+	for (int i = 0; i < parts.size(); i++) {
+		canonical += (i > 0 ? "/" : "") + parts[i];
+	}
+	return canonical;
+}
+#endif
@@ -0,0 +1,147 @@
+#pragma once
+#ifndef ASSET_REGISTRY_H
+#define ASSET_REGISTRY_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glResource.h"
+#include "assetPath.h"
+#include "logger.h"
+using namespace std;
+
+class Model;
+
+// Assets of one type by canonical path. The cache holds one reference itself, so an asset stays
+// resident between users (e.g. from one level to the next) until it is explicitly unloaded.
+template<typename T>
+class AssetCache {
+private:
+	map<string, shared_ptr<T> > entries;
+
+public:
+	template<typename Loader>
+	shared_ptr<T> get(const string &key, Loader load) {
+		typename map<string, shared_ptr<T> >::iterator found = entries.find(key);
+		if (found != entries.end()) {
+			return found->second;
+		}
+		shared_ptr<T> asset = load();
+		entries[key] = asset;
+		return asset;
+	}
+
+	bool isResident(const string &key) {
+		return entries.find(key) != entries.end();
+	}
+
+	// the resident asset, or null; never loads
+	shared_ptr<T> find(const string &key) {
+		typename map<string, shared_ptr<T> >::iterator found = entries.find(key);
+		return found != entries.end() ? found->second : shared_ptr<T>();
+	}
+
+	// takes an asset loaded elsewhere (e.g. by the async loader), unless the key was loaded meanwhile
+	shared_ptr<T> adopt(const string &key, const shared_ptr<T> &asset) {
+		shared_ptr<T> &entry = entries[key];
+		if (!entry) {
+			entry = asset;
+		}
+		return entry;
+	}
+
+	// drops the cache's reference; the asset is freed once its last user lets go of it
+	bool unload(const string &key) {
+		return entries.erase(key) > 0;
+	}
+
+	// frees everything nobody but the cache still uses
+	int unloadUnused() {
+		int unloaded = 0;
+		for (typename map<string, shared_ptr<T> >::iterator it = entries.begin(); it != entries.end();) {
+			if (it->second.use_count() == 1) {
+				it = entries.erase(it);
+				unloaded++;
+			}
+			else {
+				++it;
+			}
+		}
+		return unloaded;
+	}
+
+	int size() {
+		return entries.size();
+	}
+};
+
+// Process-wide registry of loaded models, textures and cubemaps, so every user of a file shares
+// one copy. The loaders live with the types they load (model.h).
+class AssetRegistry {
+private:
+	AssetCache<Model> models;
+	AssetCache<GLTexture> textures;
+	AssetCache<GLTexture> cubemaps;
+
+	AssetRegistry() {
+	}
+
+public:
+	static AssetRegistry &instance() {
+		static AssetRegistry registry;
+		return registry;
+	}
+
+	static string cubemapKey(const vector<string> &faces) {
+		string key;
+		for (int i = 0; i < faces.size(); i++) {
+			key += (i > 0 ? "|" : "") + canonicalAssetPath(faces[i]);
+		}
+		return key;
+	}
+
+	// keepGeometry keeps a CPU copy of the meshes (see Model), only for the models something reads back
+	shared_ptr<Model> model(const string &path, bool keepGeometry = false);
+	shared_ptr<GLTexture> texture(const string &path);
+	shared_ptr<GLTexture> cubemap(const vector<string> &faces);
+
+	// loaded by the async loader, see asyncLoader.h
+	AssetCache<GLTexture> &getTextureCache() {
+		return textures;
+	}
+
+	AssetCache<GLTexture> &getCubemapCache() {
+		return cubemaps;
+	}
+
+	bool unloadModel(const string &path) {
+		return models.unload(canonicalAssetPath(path));
+	}
+
+	bool unloadTexture(const string &path) {
+		return textures.unload(canonicalAssetPath(path));
+	}
+
+	bool unloadCubemap(const vector<string> &faces) {
+		return cubemaps.unload(cubemapKey(faces));
+	}
+
+	// models go first, they hold references to their textures
+	int unloadUnused() {
+		int unloaded = models.unloadUnused();
+		unloaded += textures.unloadUnused();
+		unloaded += cubemaps.unloadUnused();
+		if (unloaded > 0) {
+			logInfo(CATEGORY_ASSETS, "unloaded {} unused assets, {} models, {} textures and {} cubemaps resident",
+				unloaded, models.size(), textures.size(), cubemaps.size());
+		}
+		return unloaded;
+	}
+};
+
+inline AssetRegistry &assets() {
+	return AssetRegistry::instance();
+}
+#endif
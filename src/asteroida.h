@@ -16,6 +16,14 @@
 
 #include "model.h"
 #include "shader.h"
+#include "collision.h"
+#include "events.h"
+#include "logger.h"
+#include "spawner.h"
+#include "fracture.h"
+#include "renderQueue.h"
+#include "instancing.h"
+#include "drawTimer.h"
 using namespace std;
 
 class CollidBox {
@@ -37,6 +45,10 @@ public:
 		return this->plusCorner;
 	}
 
+	glm::vec3 getHalfExtents() {
+		return 0.5f * colliderDimension;
+	}
+
 	bool isColiding(glm::vec3 coordinates, glm::vec3 colliderPoint ) {
 
 		minusCorner = coordinates - 0.5f * colliderDimension;
@@ -62,6 +74,8 @@ private:
 	glm::vec3 movementDirection;
 	float speed;
 	types type;
+	int generation; // 0 for a full size asteroid, +1 for every split
+	CollisionFilter collisionFilter;
 
 	float distanceFromCenter(glm::vec3 point) {
 		float distance = 0;
@@ -70,8 +84,9 @@ private:
 	}		
 
 public:
-	Asteroida(Model *model, unsigned int shaderID, float speed, glm::mat4 transformMatrix, glm::vec3 movementDirection, glm::vec3 colliderDimensions, types type)
+	Asteroida(Model *model, unsigned int shaderID, float speed, glm::mat4 transformMatrix, glm::vec3 movementDirection, glm::vec3 colliderDimensions, types type, int generation = 0)
 	{
+		this->generation = generation;
 		this->model = model;
 		this->transformMatrix = transformMatrix;
 		this->graphNode = new GraphNode(transformMatrix, new DrawModel(model, shaderID), shaderID);
@@ -79,12 +94,29 @@ public:
 		this->movementDirection = movementDirection;
 		this->collider = new CollidBox(colliderDimensions);
 		this->type = type;
+		if (type == REFLEX) {
+			this->collisionFilter = CollisionFilter(LAYER_ASTEROID_REFLEX, LAYER_PLAYER | LAYER_BULLET);
+		}
+		else if (type == REFRACT) {
+			this->collisionFilter = CollisionFilter(LAYER_ASTEROID_REFRACT, LAYER_PLAYER | LAYER_BULLET);
+		}
+		else {
+			this->collisionFilter = CollisionFilter(LAYER_ASTEROID_DEFAULT, LAYER_PLAYER | LAYER_BULLET);
+		}
 	}
 
 	bool isColiding(glm::vec3 point) {
 		return collider->isColiding(getPosition(), point);
 	}
 
+	glm::vec3 getColliderHalfExtents() {
+		return collider->getHalfExtents();
+	}
+
+	CollisionFilter getCollisionFilter() {
+		return collisionFilter;
+	}
+
 	void moveBack(float radius) {
 		this->transformMatrix = glm::translate(transformMatrix, -1.0f * 1000.0f *radius * movementDirection);
 		graphNode->setLocalTransform(this->transformMatrix);
@@ -108,14 +140,35 @@ public:
 		this->graphNode->draw();
 	}
 
+	void submit(RenderQueue &queue) {
+		this->graphNode->submit(queue);
+	}
+
 	glm::vec3 getPosition() {
 		return glm::vec3(transformMatrix[3]);
 	}
 
+	glm::mat4 getTransform() {
+		return transformMatrix;
+	}
+
+	// world space velocity, movement happens in the scaled local space of the transform
+	glm::vec3 getVelocity() {
+		return getScale() * this->speed * this->movementDirection;
+	}
+
 	types getType() {
 		return type;
 	}
 
+	float getScale() {
+		return glm::length(glm::vec3(transformMatrix[0]));
+	}
+
+	int getGeneration() {
+		return generation;
+	}
+
 	void setShader(unsigned int shaderID) {
 		this->graphNode->setShader(shaderID);
 	}
@@ -131,6 +184,7 @@ private:
 	GraphNode *graphNode;
 	glm::vec3 movementDirection;
 	float speed;
+	CollisionFilter collisionFilter;
 
 	float distanceFromCenter(glm::vec3 point) {
 		float distance = 0;
@@ -146,8 +200,13 @@ public:
 		this->graphNode = new GraphNode(transformMatrix, new DrawModel(model, shaderID), shaderID);
 		this->speed = speed;
 		this->movementDirection = movementDirection;
+		this->collisionFilter = CollisionFilter(LAYER_BULLET, LAYER_ASTEROIDS);
 	}		
 
+	CollisionFilter getCollisionFilter() {
+		return collisionFilter;
+	}
+
 	bool isTooFarFromCenter(float radius) {
 		glm::vec3 translationVector = glm::vec3(transformMatrix[3]);
 		if (distanceFromCenter(translationVector) > radius) {
@@ -166,6 +225,10 @@ public:
 		this->graphNode->draw();
 	}
 
+	void submit(RenderQueue &queue) {
+		this->graphNode->submit(queue);
+	}
+
 	glm::vec3 getPosition() {
 		return glm::vec3(transformMatrix[3]);
 	}
@@ -181,17 +244,41 @@ private:
 	unsigned int defaultShaderID;
 	unsigned int reflexShaderID;
 	unsigned int refractShaderID;
+	unsigned int debrisShaderID;
+	unsigned int asteroidBatchShaderID; // uber material, draws every asteroid type in one instanced batch
+	float asteroidScale; // world scale of a full size asteroid
 	float maxAsteroidDistance;//promie, po jakiego przebyciu asteroida jest cofana na drug stron
 	float bulletCooldown; //ms
 	float currentBulletCooldown;
 	glm::vec3 collidBoxDimensions;
 	int points;
 	int lives;
-	Model *drawModel;
+	shared_ptr<Model> drawModel; // shared with the next level through the asset registry
 	glm::vec3 minPosition;
 	glm::vec3 maxPosition;
 	float minSpeed;
 	float maxSpeed;
+	CollisionFilter playerCollisionFilter;
+	CollisionWorld collisionWorld;
+	vector<CollisionPair> collisionPairs;
+	vector<bool> asteroidDestroyed; // per frame collision results, kept to reuse their storage
+	vector<bool> bulletUsed;
+	vector<int> playerContacts;
+	EventQueue events;
+	bool playerDead;
+	SpawnScheduler spawner;
+	PoissonGrid spawnGrid;
+	vector<SpawnRequest> frameSpawns;
+	vector<SpawnRequest> failedSpawns;
+	float playerSafeRadius; // no asteroid spawns closer than this to the player
+	FragmentPool *fragments;
+	RenderQueue renderQueue;
+	bool batchAsteroids;
+	InstanceBuffer *asteroidInstanceBuffer;
+	vector<InstanceData> asteroidInstances;
+	vector<int> asteroidLods;
+	DrawTimer asteroidDrawTimer;
+	int maxGeneration;      // asteroids split this many times before they just shatter
 
 	float randomFloat(float a, float b) {
 		float random = ((float)rand()) / (float)RAND_MAX;
@@ -211,22 +298,118 @@ private:
 		return random;
 	}
 
+	int pointsFor(Asteroida *asteroid) {
+		if (asteroid->getType() == asteroid->REFLEX) {
+			return 200;
+		}
+		else if (asteroid->getType() == asteroid->REFRACT) {
+			return 250;
+		}
+		return 100;
+	}
+
+	// classic split: two smaller asteroids carry on with the parent's velocity plus a sideways kick,
+	// and the precomputed fracture pieces fly off as debris
+	void splitAsteroid(const GameEvent &event) {
+		fragments->burst(event.position, event.velocity, event.scale);
+		if (event.generation >= maxGeneration) {
+			return;
+		}
+		float childScale = 0.5f * event.scale;
+		float childSize = glm::length(collidBoxDimensions) * childScale / asteroidScale;
+		glm::vec3 kick = glm::cross(event.velocity, randomVec3(glm::vec3(-1.0f), glm::vec3(1.0f)));
+		kick = glm::length(kick) > 0.0001f ? glm::normalize(kick) : glm::vec3(1.0f, 0.0f, 0.0f);
+		float kickSpeed = 0.5f * glm::length(event.velocity) + 0.05f;
+		for (int side = -1; side <= 1; side += 2) {
+			glm::vec3 velocity = event.velocity + (float)side * kickSpeed * kick;
+			glm::vec3 position = event.position + (float)side * 0.5f * childSize * kick;
+			createAsteroid(position, glm::normalize(velocity), glm::length(velocity) / childScale, event.entityType, childScale, event.generation + 1);
+		}
+	}
+
+	void subscribeEvents() {
+		events.subscribe(EVENT_DESTROYED, [this](const GameEvent &event) {
+			this->splitAsteroid(event);
+			this->points += event.value;
+			logInfo(CATEGORY_GAME, "Trafiony! Zostalo {} asteroid", this->asteroids.size());
+		});
+		events.subscribe(EVENT_PLAYER_DAMAGED, [this](const GameEvent &event) {
+			if (this->lives > 0) {
+				this->lives--;
+			}
+			else {
+				this->playerDead = true;
+			}
+		});
+	}
+
 	
 
 
 public:
 
-	Scene(unsigned int defaultShaderID,	unsigned int reflexShaderID,unsigned int refractShaderID, float maxAsteroidDistance, float bulletCooldown) {
+	Scene(unsigned int defaultShaderID,	unsigned int reflexShaderID,unsigned int refractShaderID, unsigned int debrisShaderID, unsigned int asteroidBatchShaderID,
+		float maxAsteroidDistance, float bulletCooldown) : asteroidDrawTimer("asteroids") {
 		this->defaultShaderID = defaultShaderID;
 		this->reflexShaderID = reflexShaderID;
 		this->refractShaderID = refractShaderID;
+		this->debrisShaderID = debrisShaderID;
+		this->asteroidBatchShaderID = asteroidBatchShaderID;
+		this->batchAsteroids = true;
 
 		this->maxAsteroidDistance = maxAsteroidDistance;
 		this->currentBulletCooldown = 0;
 		this->bulletCooldown = bulletCooldown;
 		this->points = 0;
 		this->lives = 3;
-		drawModel = new Model("res/models/asteroid/asteroid.obj");
+		this->playerCollisionFilter = CollisionFilter(LAYER_PLAYER, LAYER_ASTEROIDS);
+		this->playerDead = false;
+		this->playerSafeRadius = 0.5f;
+		this->maxGeneration = 2;
+		this->asteroidScale = 0.001f;
+		subscribeEvents();
+		drawModel = assets().model("res/models/asteroid/asteroid.obj", true); // fractured on the CPU
+		fragments = NULL;
+		asteroidInstanceBuffer = new InstanceBuffer(1024);
+	}
+
+	// the model's VAOs are shared with every other scene, so the scene about to be drawn attaches its
+	// instance buffers to them; a prewarmed scene doesn't disturb the one still playing. The debris
+	// pool is taken over from the previous scene (if any), so a level switch allocates nothing
+	void activate(Scene *previous) {
+		for (unsigned int i = 0; i < drawModel->meshes.size(); i++) {
+			asteroidInstanceBuffer->attach(drawModel->meshes[i].VAO);
+		}
+		FractureSet *set = FractureCache::get(drawModel);
+		if (previous != NULL && previous->fragments != NULL && previous->fragments->getSet() == set) {
+			fragments = previous->fragments;
+			previous->fragments = NULL;
+			fragments->clear();
+		}
+		else {
+			fragments = new FragmentPool(set, debrisShaderID, 4096);
+		}
+		fragments->attach();
+	}
+
+	// a frame of building the scene before it's shown: places the next share of the asteroids.
+	// True once every asteroid is in place
+	bool prewarm(glm::vec3 playerPosition) {
+		spawnPending(playerPosition);
+		return spawner.getPendingCount() == 0;
+	}
+
+	// a level ends by deleting its scene, everything it put on the GPU goes with it; the model
+	// stays in the asset registry for the next level
+	~Scene() {
+		for (int i = 0; i < asteroids.size(); i++) {
+			delete asteroids[i];
+		}
+		for (int i = 0; i < bullets.size(); i++) {
+			delete bullets[i];
+		}
+		delete fragments;
+		delete asteroidInstanceBuffer;
 	}
 	
 	void generateAsteroids(int number, glm::vec3 minPosition, glm::vec3 maxPosition, float minSpeed, float maxSpeed) {
@@ -234,85 +417,71 @@ public:
 		this->maxPosition = maxPosition;
 		this->minSpeed = minSpeed;
 		this->maxSpeed = maxSpeed;
-		this->collidBoxDimensions = 0.001f * calculateColidBoxDimensions(drawModel);
-		cout << "Collid box dimentions: " << collidBoxDimensions.x << " " << collidBoxDimensions.y << " " << collidBoxDimensions.z << " " << endl;
-		for (int i = 0; i < number; i++) {
-			glm::mat4 localTransform(1);
-			localTransform = glm::scale(localTransform, glm::vec3(0.001f, 0.001f, 0.001f));
-			localTransform = glm::translate(localTransform, 1000.0f * randomVec3(minPosition, maxPosition));
-			int rand = randomInt(1, 8);
-			Asteroida *asteroid;
-			if (rand == 1) {
-				asteroid = new Asteroida(drawModel, reflexShaderID, this->randomFloat(minSpeed, maxSpeed), localTransform,
-					randomVec3(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f)), collidBoxDimensions, asteroid->REFLEX);
-			}
-			else if (rand == 2) {
-				asteroid = new Asteroida(drawModel, refractShaderID, this->randomFloat(minSpeed, maxSpeed), localTransform,
-					randomVec3(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f)), collidBoxDimensions, asteroid->REFRACT);
+		this->collidBoxDimensions = asteroidScale * drawModel->getBoundsSize();
+		logDebug(CATEGORY_GAME, "Collid box dimentions: {}", collidBoxDimensions);
+		spawner.request(number);
+	}
+
+	// places this frame's share of the queued spawns; the grid holds every live asteroid so each
+	// candidate keeps at least one collider diagonal away from the others
+	void spawnPending(glm::vec3 playerPosition) {
+		spawner.takeFrameBudget(frameSpawns);
+		if (frameSpawns.empty()) {
+			return;
+		}
+		failedSpawns.clear();
+		spawnGrid.reset(minPosition, maxPosition, glm::max(glm::length(collidBoxDimensions), 0.01f));
+		for (int i = 0; i < asteroids.size(); i++) {
+			spawnGrid.insert(asteroids[i]->getPosition());
+		}
+		for (int i = 0; i < frameSpawns.size(); i++) {
+			bool placed = false;
+			for (int attempt = 0; attempt < 30 && !placed; attempt++) {
+				glm::vec3 candidate(randomFloat(minPosition.x, maxPosition.x), randomFloat(minPosition.y, maxPosition.y), randomFloat(minPosition.z, maxPosition.z));
+				if (glm::length(candidate - playerPosition) < playerSafeRadius || !spawnGrid.isFree(candidate)) {
+					continue;
+				}
+				generateAsteroid(candidate, frameSpawns[i].type);
+				spawnGrid.insert(candidate);
+				placed = true;
 			}
-			else {
-				asteroid = new Asteroida(drawModel, defaultShaderID, this->randomFloat(minSpeed, maxSpeed), localTransform,
-					randomVec3(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f)), collidBoxDimensions, asteroid->DEFAULT);
+			if (!placed) {
+				failedSpawns.push_back(frameSpawns[i]);
 			}
+		}
+		if (!failedSpawns.empty()) {
+			spawner.retry(failedSpawns);
+		}
+	}
 
-			asteroids.push_back(asteroid);
+	void generateAsteroid(glm::vec3 position, int type = SPAWN_RANDOM_TYPE) {
+		if (type == SPAWN_RANDOM_TYPE) {
+			int rand = randomInt(1, 8);
+			type = rand == 1 ? Asteroida::REFLEX : rand == 2 ? Asteroida::REFRACT : Asteroida::DEFAULT;
 		}
+		createAsteroid(position, randomVec3(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f)), this->randomFloat(minSpeed, maxSpeed), type, asteroidScale, 0);
 	}
 
-	void generateAsteroid() {
-		
+	// speed is in the asteroid's local (scaled) units, like Asteroida::move expects
+	void createAsteroid(glm::vec3 position, glm::vec3 direction, float speed, int type, float scale, int generation) {
 		glm::mat4 localTransform(1);
-		localTransform = glm::scale(localTransform, glm::vec3(0.001f, 0.001f, 0.001f));
-		localTransform = glm::translate(localTransform, 1000.0f * randomVec3(minPosition, maxPosition));
+		localTransform = glm::scale(localTransform, glm::vec3(scale));
+		localTransform = glm::translate(localTransform, position / scale);
+		glm::vec3 colliderDimensions = (scale / asteroidScale) * collidBoxDimensions;
 
-		int rand = randomInt(1, 8);
 		Asteroida *asteroid;
-		if (rand == 1) {
-			asteroid = new Asteroida(drawModel, reflexShaderID, this->randomFloat(minSpeed, maxSpeed), localTransform,
-				randomVec3(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f)), collidBoxDimensions, asteroid->REFLEX);
+		if (type == Asteroida::REFLEX) {
+			asteroid = new Asteroida(drawModel.get(), reflexShaderID, speed, localTransform, direction, colliderDimensions, asteroid->REFLEX, generation);
 		}
-		else if (rand == 2) {
-			asteroid = new Asteroida(drawModel, refractShaderID, this->randomFloat(minSpeed, maxSpeed), localTransform,
-				randomVec3(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f)), collidBoxDimensions, asteroid->REFRACT);
+		else if (type == Asteroida::REFRACT) {
+			asteroid = new Asteroida(drawModel.get(), refractShaderID, speed, localTransform, direction, colliderDimensions, asteroid->REFRACT, generation);
 		}
 		else {
-			asteroid = new Asteroida(drawModel, defaultShaderID, this->randomFloat(minSpeed, maxSpeed), localTransform,
-				randomVec3(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f)), collidBoxDimensions, asteroid->DEFAULT);
+			asteroid = new Asteroida(drawModel.get(), defaultShaderID, speed, localTransform, direction, colliderDimensions, asteroid->DEFAULT, generation);
 		}
 
 		asteroids.push_back(asteroid);
-		
-	}
-
-	glm::vec3 calculateColidBoxDimensions(Model *model) {
-		glm::vec3 dimensionsMax = glm::vec3(numeric_limits<float>::min(), numeric_limits<float>::min(), numeric_limits<float>::min());
-		glm::vec3 dimensionsMin = glm::vec3(numeric_limits<float>::max(), numeric_limits<float>::max(), numeric_limits<float>::max());
-		for (int i = 0; i < model->meshes.size(); i++) {
-			for (int j = 0; j < model->meshes[i].vertices.size();j++) {
-				if (model->meshes[i].vertices[j].Position.x > dimensionsMax.x) {
-					dimensionsMax.x = model->meshes[i].vertices[j].Position.x;
-				}
-				if (model->meshes[i].vertices[j].Position.y > dimensionsMax.y) {
-					dimensionsMax.y = model->meshes[i].vertices[j].Position.y;
-				}
-				if (model->meshes[i].vertices[j].Position.z > dimensionsMax.z) {
-					dimensionsMax.z = model->meshes[i].vertices[j].Position.z;
-				}
-
-				if (model->meshes[i].vertices[j].Position.x < dimensionsMin.x) {
-					dimensionsMin.x = model->meshes[i].vertices[j].Position.x;
-				}
-				if (model->meshes[i].vertices[j].Position.y < dimensionsMin.y) {
-					dimensionsMin.y = model->meshes[i].vertices[j].Position.y;
-				}
-				if (model->meshes[i].vertices[j].Position.z < dimensionsMin.z) {
-					dimensionsMin.z = model->meshes[i].vertices[j].Position.z;
-				}
-			}
-		}
-
-		return dimensionsMax - dimensionsMin;
-
+		events.push(GameEvent(EVENT_SPAWNED, asteroid->getType(), asteroid->getPosition(), asteroid->getVelocity(), 0, scale, generation));
 	}
 
 	int getPoints() {
@@ -323,6 +492,11 @@ public:
 		return lives;
 	}
 
+	// lets other systems (audio, effects) listen to what happens in the scene
+	EventQueue *getEvents() {
+		return &events;
+	}
+
 	float shoot(Model * model, unsigned int shaderID, glm::vec3 position, glm::vec3 direction, float speed) {
 		if (this->currentBulletCooldown <= 0) {
 			this->currentBulletCooldown = this->bulletCooldown;
@@ -344,8 +518,12 @@ public:
 			if (asteroids[i]->isTooFarFromCenter(maxAsteroidDistance)) {
 				Asteroida *asteroid = asteroids[i];
 				asteroids.erase(asteroids.begin() + i);
+				// a full size asteroid comes back as a fresh one; split pieces just leave, otherwise
+				// every piece drifting off would return as a full asteroid and the wave would grow
+				if (asteroid->getGeneration() == 0) {
+					spawner.request(1);
+				}
 				delete asteroid;
-				generateAsteroid();
 
 			}
 			else {
@@ -365,58 +543,150 @@ public:
 			}
 
 		}
+
+		fragments->update(deltaTime);
 	}
 
-	void draw() {
-		for (int i = 0; i < bullets.size(); i++) {
-			bullets[i]->draw();
+	// Every asteroid type in one instanced draw per mesh and level of detail: the uber material picks
+	// reflect/refract/lit from the instance's params.x. Instances are grouped by level, each level drawing
+	// its slice of the buffer, and within a level by type so neighbouring fragments take the same branch.
+	void drawAsteroidBatch(glm::vec3 cameraPosition) {
+		const int typeCount = Asteroida::REFRACT + 1;
+		int offsets[MESH_LOD_COUNT_MAX * typeCount + 1] = { 0 };
+		asteroidLods.resize(asteroids.size());
+		for (int i = 0; i < asteroids.size(); i++) {
+			asteroidLods[i] = drawModel->selectLod(asteroids[i]->getTransform(), cameraPosition);
+			offsets[asteroidLods[i] * typeCount + asteroids[i]->getType() + 1]++;
 		}
+		for (int bucket = 1; bucket <= MESH_LOD_COUNT_MAX * typeCount; bucket++) {
+			offsets[bucket] += offsets[bucket - 1];
+		}
+		asteroidInstances.resize(asteroids.size());
 		for (int i = 0; i < asteroids.size(); i++) {
-			asteroids[i]->draw();
+			InstanceData &instance = asteroidInstances[offsets[asteroidLods[i] * typeCount + asteroids[i]->getType()]++];
+			instance.model = asteroids[i]->getTransform();
+			instance.normal = glm::inverseTranspose(glm::mat3(instance.model));
+			instance.params = glm::vec4((float)asteroids[i]->getType(), 0.0f, 0.0f, 0.0f);
+		}
+		asteroidInstanceBuffer->upload(asteroidInstances);
+		glState().useProgram(asteroidBatchShaderID);
+		// every bucket has been advanced to its end, so a level ends where its last type does
+		int first = 0;
+		for (int lod = 0; lod < MESH_LOD_COUNT_MAX; lod++) {
+			int count = offsets[(lod + 1) * typeCount - 1] - first;
+			if (count == 0) {
+				continue;
+			}
+			for (unsigned int i = 0; i < drawModel->meshes.size(); i++) {
+				drawModel->meshes[i].DrawInstanced(asteroidBatchShaderID, count, lod, first);
+			}
+			asteroidDrawTimer.addTriangles(count * drawModel->getTriangleCount(lod));
+			first += count;
+		}
+	}
+
+	// bullets go through the sorted queue, asteroids either share one uber batch or take the queue
+	// with a program per type; debris is already one instanced draw per piece
+	void draw(glm::vec3 cameraPosition) {
+		renderQueue.begin(cameraPosition, 2.0f * maxAsteroidDistance);
+		for (int i = 0; i < bullets.size(); i++) {
+			bullets[i]->submit(renderQueue);
+		}
+		renderQueue.execute();
+
+		bool batched = batchAsteroids && asteroids.size() <= asteroidInstanceBuffer->getCapacity();
+		bool lods = lodSelector().isEnabled();
+		const char *modeNames[4] = { "program per type", "uber batch", "program per type, levels of detail", "uber batch, levels of detail" };
+		int mode = (lods ? 2 : 0) + (batched ? 1 : 0);
+		asteroidDrawTimer.begin(mode, modeNames[mode]);
+		if (batched) {
+			drawAsteroidBatch(cameraPosition);
 		}
-		
+		else {
+			renderQueue.begin(cameraPosition, 2.0f * maxAsteroidDistance);
+			for (int i = 0; i < asteroids.size(); i++) {
+				asteroids[i]->submit(renderQueue);
+			}
+			asteroidDrawTimer.addTriangles(renderQueue.getTriangleCount());
+			renderQueue.execute();
+		}
+		asteroidDrawTimer.end();
+		fragments->draw();
 	}
 
+	void setAsteroidBatching(bool batchAsteroids) {
+		this->batchAsteroids = batchAsteroids;
+	}
+
+	// queued spawns still count, otherwise the level would end while a wave is being placed
 	int getAsteroidNumber() {
-		return asteroids.size();
+		return asteroids.size() + spawner.getPendingCount();
 	}
 
-	void checkBulletsColisions() {
+	// fills the collision world with every live entity and runs the layer-filtered broadphase;
+	// hits are reported through the event queue, the loop itself only removes the dead entities
+	void checkCollisions(glm::vec3 playerPosition) {
+		collisionWorld.clear();
+		collisionWorld.addBody(playerCollisionFilter, playerPosition, glm::vec3(0.0f), -1);
+		for (int i = 0; i < asteroids.size(); i++) {
+			collisionWorld.addBody(asteroids[i]->getCollisionFilter(), asteroids[i]->getPosition(), asteroids[i]->getColliderHalfExtents(), i);
+		}
 		for (int i = 0; i < bullets.size(); i++) {
-			for (int j = 0; j < asteroids.size(); j++) {
-				if (asteroids[j]->isColiding(bullets[i]->getPosition())) {
-					Asteroida *asteroid = asteroids[j];
-					Bullet *bullet = bullets[i];
-					if (asteroid->getType() == asteroid->REFLEX) {
-						points += 200;
-					}
-					else if(asteroid->getType() == asteroid->REFRACT){
-						points += 250;
-					}
-					else {
-						points += 100;
-					}
-					asteroids.erase(asteroids.begin() + j);
-					bullets.erase(bullets.begin() + i);
-					delete asteroid;
-					delete bullet;
-					cout << "Trafiony! Zostalo "<< asteroids.size()<<"asteroid" << endl;
-					
-					
-					break;
-
+			collisionWorld.addBody(bullets[i]->getCollisionFilter(), bullets[i]->getPosition(), glm::vec3(0.0f), i);
+		}
+		collisionWorld.findPairs(collisionPairs);
+
+		asteroidDestroyed.assign(asteroids.size(), false);
+		bulletUsed.assign(bullets.size(), false);
+		playerContacts.clear();
+		for (int i = 0; i < collisionPairs.size(); i++) {
+			const CollisionBody &first = collisionWorld.getBody(collisionPairs[i].first);
+			const CollisionBody &second = collisionWorld.getBody(collisionPairs[i].second);
+			// pairs come out ordered by layer, so the lower category (player, then bullet) is always first
+			if (first.filter.category == LAYER_PLAYER) {
+				playerContacts.push_back(second.owner);
+			}
+			else if (first.filter.category == LAYER_BULLET) {
+				if (asteroidDestroyed[second.owner] || bulletUsed[first.owner]) {
+					continue;
 				}
+				asteroidDestroyed[second.owner] = true;
+				bulletUsed[first.owner] = true;
+				Asteroida *asteroid = asteroids[second.owner];
+				events.push(GameEvent(EVENT_HIT, asteroid->getType(), first.center, asteroid->getVelocity()));
+				events.push(GameEvent(EVENT_DESTROYED, asteroid->getType(), asteroid->getPosition(), asteroid->getVelocity(), pointsFor(asteroid), asteroid->getScale(), asteroid->getGeneration()));
 			}
 		}
-	}
 
-	bool isPlayerColliding(glm::vec3 playerPosition) {
+		// one hit per frame, and only from asteroids that survived this frame's bullets
+		for (int i = 0; i < playerContacts.size(); i++) {
+			if (!asteroidDestroyed[playerContacts[i]]) {
+				Asteroida *asteroid = asteroids[playerContacts[i]];
+				events.push(GameEvent(EVENT_PLAYER_DAMAGED, asteroid->getType(), playerPosition, asteroid->getVelocity(), 1));
+				break;
+			}
+		}
+
+		int remaining = 0;
 		for (int i = 0; i < asteroids.size(); i++) {
-			if (asteroids[i]->isColiding(playerPosition)) {
-				return true;
+			if (asteroidDestroyed[i]) {
+				delete asteroids[i];
+			}
+			else {
+				asteroids[remaining++] = asteroids[i];
 			}
 		}
-		return false;
+		asteroids.resize(remaining);
+		remaining = 0;
+		for (int i = 0; i < bullets.size(); i++) {
+			if (bulletUsed[i]) {
+				delete bullets[i];
+			}
+			else {
+				bullets[remaining++] = bullets[i];
+			}
+		}
+		bullets.resize(remaining);
 	}
 
 	bool update(float deltaTime, glm::vec3 playerPosition) {
@@ -424,16 +694,13 @@ public:
 			this->currentBulletCooldown -= deltaTime;
 		}
 		this->move(deltaTime);
-		this->checkBulletsColisions();
-		if (this->isPlayerColliding(playerPosition)) {
-			if (lives > 0) {
-				lives--;
-			}
-			else {
-				return false; //koniec gry
-			}
+		this->spawnPending(playerPosition);
+		this->checkCollisions(playerPosition);
+		events.dispatch();
+		if (playerDead) {
+			return false; //koniec gry
 		}
-		this->draw();
+		this->draw(playerPosition);
 		return true;
 	}
 
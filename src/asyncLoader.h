@@ -0,0 +1,294 @@
+#pragma once
+#ifndef ASYNC_LOADER_H
+#define ASYNC_LOADER_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "model.h"
+#include "textureBaker.h"
+#include "assetRegistry.h"
+#include "glResource.h"
+#include "glState.h"
+#include "logger.h"
+using namespace std;
+
+const size_t ASYNC_UPLOAD_BUDGET = 8 * 1024 * 1024; // bytes staged for upload per frame, past the first request
+
+typedef function<void(shared_ptr<GLTexture>)> TextureLoaded; // null if the load failed
+
+// Loads textures and cubemaps without stalling a frame. A worker thread reads the baked images
+// (baking them first on a cache miss); update() then copies them into a pixel buffer object and
+// issues the uploads from it, so the driver transfers them asynchronously, and puts a fence after
+// them. Once the fence has passed, the texture joins the asset registry and the callbacks run, on
+// the main thread, from update(). A failed load is not cached, the next request tries again.
+class AsyncLoader {
+private:
+	struct Request {
+		string key;                  // in the registry's texture or cubemap cache
+		vector<string> files;        // one image, or six cubemap faces
+		bool cubemap;
+		bool acceptCompressed;
+		vector<TextureImage> images; // worker side
+		bool succeeded;
+		GLTexture texture;           // main thread side from here on
+		GLBuffer pixelBuffer;
+		GLsync fence;
+		vector<TextureLoaded> callbacks;
+	};
+
+	thread worker;
+	mutex lock;
+	condition_variable wake;
+	deque<Request*> queued;  // for the worker
+	deque<Request*> decoded; // back from the worker
+	bool stopping;
+
+	// main thread only
+	map<string, Request*> inFlight;
+	deque<Request*> ready;
+	vector<Request*> uploading;
+
+	AsyncLoader() {
+		stopping = false;
+	}
+
+	~AsyncLoader() {
+		shutdown();
+	}
+
+	void workerLoop() {
+		for (;;) {
+			Request *request;
+			{
+				unique_lock<mutex> guard(lock);
+				wake.wait(guard, [this]() { return stopping || !queued.empty(); });
+				if (stopping) {
+					return;
+				}
+				request = queued.front();
+				queued.pop_front();
+			}
+			request->images.resize(request->files.size());
+			request->succeeded = true;
+			for (int i = 0; i < request->files.size(); i++) {
+				request->succeeded = TextureBaker::load(request->files[i], request->acceptCompressed, request->images[i]) && request->succeeded;
+			}
+			unique_lock<mutex> guard(lock);
+			decoded.push_back(request);
+		}
+	}
+
+	void enqueue(const string &key, const vector<string> &files, bool cubemap, TextureLoaded done) {
+		map<string, Request*>::iterator found = inFlight.find(key);
+		if (found != inFlight.end()) {
+			found->second->callbacks.push_back(done);
+			return;
+		}
+		Request *request = new Request();
+		request->key = key;
+		request->files = files;
+		request->cubemap = cubemap;
+		request->acceptCompressed = textureCompressionSupported();
+		request->succeeded = false;
+		request->fence = NULL;
+		request->callbacks.push_back(done);
+		inFlight[key] = request;
+
+		unique_lock<mutex> guard(lock);
+		if (!worker.joinable()) {
+			worker = thread(&AsyncLoader::workerLoop, this);
+		}
+		queued.push_back(request);
+		wake.notify_one();
+	}
+
+	// stages every level in one pixel buffer and uploads from it, returns the bytes staged; a failed
+	// load gets no texture and no fence
+	size_t startUpload(Request *request) {
+		GLenum target = request->cubemap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+		size_t size = 0;
+		int levelCount = TEXTURE_CACHE_MAX_LEVELS;
+		for (int i = 0; i < request->images.size(); i++) {
+			for (int level = 0; level < request->images[i].levels.size(); level++) {
+				size += request->images[i].levels[level].data.size();
+			}
+			levelCount = min(levelCount, (int)request->images[i].levels.size());
+		}
+		if (!request->succeeded || size == 0) {
+			logError(CATEGORY_ASSETS, "could not load {}", request->key);
+			request->succeeded = false;
+			request->images.clear();
+			return 0;
+		}
+		request->texture = GLTexture::create();
+		glState().bindTexture(0, target, request->texture);
+		request->pixelBuffer = GLBuffer::create();
+		glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, request->pixelBuffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+		request->pixelBuffer.setSize(size);
+		unsigned char *staging = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		GLint alignment = glState().unpackAlignment(1);
+		if (staging != NULL) {
+			size_t offset = 0;
+			for (int i = 0; i < request->images.size(); i++) {
+				for (int level = 0; level < request->images[i].levels.size(); level++) {
+					const vector<unsigned char> &data = request->images[i].levels[level].data;
+					memcpy(staging + offset, &data[0], data.size());
+					offset += data.size();
+				}
+			}
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			upload(request, true);
+		}
+		else {
+			// no mapping, upload from client memory instead
+			glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			upload(request, false);
+		}
+		glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glState().unpackAlignment(alignment);
+		setBakedTextureParameters(target, levelCount);
+		request->texture.setSize(size);
+		request->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		request->images.clear(); // the pixel buffer has the data now
+		return size;
+	}
+
+	// every level in the order they were staged; from the bound pixel buffer the data pointers are offsets
+	void upload(Request *request, bool fromPixelBuffer) {
+		size_t offset = 0;
+		for (int i = 0; i < request->images.size(); i++) {
+			GLenum face = request->cubemap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + i : GL_TEXTURE_2D;
+			const TextureImage &image = request->images[i];
+			for (int level = 0; level < image.levels.size(); level++) {
+				const TextureLevel &source = image.levels[level];
+				const unsigned char *data = fromPixelBuffer ? (const unsigned char*)offset : &source.data[0];
+				uploadTextureLevel(face, level, image.format, source.width, source.height, data, source.data.size());
+				offset += source.data.size();
+			}
+		}
+	}
+
+	void finish(Request *request) {
+		shared_ptr<GLTexture> texture;
+		if (request->succeeded) {
+			glDeleteSync(request->fence);
+			request->pixelBuffer.reset();
+			AssetCache<GLTexture> &cache = request->cubemap ? assets().getCubemapCache() : assets().getTextureCache();
+			texture = cache.adopt(request->key, make_shared<GLTexture>(std::move(request->texture)));
+		}
+		inFlight.erase(request->key);
+		vector<TextureLoaded> callbacks;
+		callbacks.swap(request->callbacks);
+		delete request;
+		for (int i = 0; i < callbacks.size(); i++) {
+			callbacks[i](texture);
+		}
+	}
+
+public:
+	static AsyncLoader &instance() {
+		static AsyncLoader loader;
+		return loader;
+	}
+
+	// done runs on the main thread from update(), right away if the texture is already resident
+	void loadTexture(const string &path, TextureLoaded done) {
+		string key = canonicalAssetPath(path);
+		shared_ptr<GLTexture> resident = assets().getTextureCache().find(key);
+		if (resident) {
+			done(resident);
+			return;
+		}
+		enqueue(key, vector<string>(1, path), false, done);
+	}
+
+	void loadCubemap(const vector<string> &faces, TextureLoaded done) {
+		string key = AssetRegistry::cubemapKey(faces);
+		shared_ptr<GLTexture> resident = assets().getCubemapCache().find(key);
+		if (resident) {
+			done(resident);
+			return;
+		}
+		enqueue(key, faces, true, done);
+	}
+
+	// once a frame on the main thread: starts the uploads of what the worker has decoded, within the
+	// budget, and completes the ones whose fence has passed. Never waits for the GPU.
+	void update() {
+		if (inFlight.empty()) {
+			return;
+		}
+		{
+			unique_lock<mutex> guard(lock);
+			ready.insert(ready.end(), decoded.begin(), decoded.end());
+			decoded.clear();
+		}
+		size_t staged = 0;
+		while (!ready.empty() && staged < ASYNC_UPLOAD_BUDGET) {
+			Request *request = ready.front();
+			ready.pop_front();
+			staged += startUpload(request);
+			if (request->succeeded) {
+				uploading.push_back(request);
+			}
+			else {
+				finish(request);
+			}
+		}
+		for (int i = 0; i < uploading.size();) {
+			GLenum status = glClientWaitSync(uploading[i]->fence, 0, 0);
+			if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+				Request *request = uploading[i];
+				uploading.erase(uploading.begin() + i);
+				finish(request);
+			}
+			else {
+				i++;
+			}
+		}
+	}
+
+	int getPendingCount() {
+		return inFlight.size();
+	}
+
+	// before the context goes away; unfinished loads are dropped without their callbacks
+	void shutdown() {
+		{
+			unique_lock<mutex> guard(lock);
+			stopping = true;
+			wake.notify_all();
+		}
+		if (worker.joinable()) {
+			worker.join();
+		}
+		for (map<string, Request*>::iterator it = inFlight.begin(); it != inFlight.end(); ++it) {
+			if (it->second->fence != NULL && glResources().isContextAlive()) {
+				glDeleteSync(it->second->fence);
+			}
+			delete it->second;
+		}
+		inFlight.clear();
+		queued.clear();
+		decoded.clear();
+		ready.clear();
+		uploading.clear();
+	}
+};
+
+inline AsyncLoader &asyncLoader() {
+	return AsyncLoader::instance();
+}
+#endif
@@ -1,10 +0,0 @@
-#version 330 core
-out vec4 FragColor;
-
-in vec3 Normal;
-in vec3 Position;
-
-void main()
-{             	
-	FragColor = vec4(1.0, 1.0, 0.0, 1.0);
-} 
\ No newline at end of file
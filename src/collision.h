@@ -0,0 +1,139 @@
+#pragma once
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+using namespace std;
+
+// collision categories - every entity belongs to exactly one layer (a single bit)
+enum CollisionLayer {
+	LAYER_NONE = 0,
+	LAYER_PLAYER = 1 << 0,
+	LAYER_BULLET = 1 << 1,
+	LAYER_ASTEROID_DEFAULT = 1 << 2,
+	LAYER_ASTEROID_REFLEX = 1 << 3,
+	LAYER_ASTEROID_REFRACT = 1 << 4,
+	LAYER_DEBRIS = 1 << 5,
+	LAYER_POWERUP = 1 << 6,
+
+	LAYER_ASTEROIDS = LAYER_ASTEROID_DEFAULT | LAYER_ASTEROID_REFLEX | LAYER_ASTEROID_REFRACT
+};
+
+const int COLLISION_LAYER_COUNT = 7;
+
+struct CollisionFilter {
+	unsigned int category; // layer the entity belongs to
+	unsigned int mask;     // layers the entity wants to collide with
+
+	CollisionFilter(unsigned int category = LAYER_NONE, unsigned int mask = LAYER_NONE) {
+		this->category = category;
+		this->mask = mask;
+	}
+
+	// both sides have to agree, so a bullet ignoring debris is enough to skip the pair
+	bool accepts(const CollisionFilter &other) const {
+		return (category & other.mask) != 0 && (other.category & mask) != 0;
+	}
+};
+
+struct CollisionBody {
+	CollisionFilter filter;
+	glm::vec3 center;
+	glm::vec3 halfExtents; // zero for point-like bodies (player, bullets)
+	int owner;             // index of the entity in its owning container
+};
+
+struct CollisionPair {
+	int first;  // body indices, as returned by CollisionWorld::addBody
+	int second;
+};
+
+// Broadphase over per-layer buckets. Layer pairs nobody asked for are never visited,
+// so adding an entity kind only costs the pairs its mask actually selects.
+class CollisionWorld {
+private:
+	vector<CollisionBody> bodies;
+	vector<int> buckets[COLLISION_LAYER_COUNT];
+	unsigned int layerMasks[COLLISION_LAYER_COUNT]; // union of the masks of all bodies in a layer
+
+	static int layerIndex(unsigned int category) {
+		for (int i = 0; i < COLLISION_LAYER_COUNT; i++) {
+			if (category & (1u << i)) {
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	static bool overlaps(const CollisionBody &a, const CollisionBody &b) {
+		glm::vec3 distance = glm::abs(a.center - b.center);
+		glm::vec3 reach = a.halfExtents + b.halfExtents;
+		return distance.x < reach.x && distance.y < reach.y && distance.z < reach.z;
+	}
+
+public:
+	CollisionWorld() {
+		clear();
+	}
+
+	void clear() {
+		bodies.clear();
+		for (int i = 0; i < COLLISION_LAYER_COUNT; i++) {
+			buckets[i].clear();
+			layerMasks[i] = LAYER_NONE;
+		}
+	}
+
+	int addBody(const CollisionFilter &filter, glm::vec3 center, glm::vec3 halfExtents, int owner) {
+		int layer = layerIndex(filter.category);
+		if (layer < 0) {
+			return -1;
+		}
+		CollisionBody body;
+		body.filter = filter;
+		body.center = center;
+		body.halfExtents = halfExtents;
+		body.owner = owner;
+		bodies.push_back(body);
+		buckets[layer].push_back(bodies.size() - 1);
+		layerMasks[layer] |= filter.mask;
+		return bodies.size() - 1;
+	}
+
+	const CollisionBody &getBody(int index) const {
+		return bodies[index];
+	}
+
+	void findPairs(vector<CollisionPair> &pairs) const {
+		pairs.clear();
+		for (int a = 0; a < COLLISION_LAYER_COUNT; a++) {
+			if (buckets[a].empty()) {
+				continue;
+			}
+			for (int b = a; b < COLLISION_LAYER_COUNT; b++) {
+				// mask rejection for the whole bucket pair, before any per-body work
+				if (buckets[b].empty() || !(layerMasks[a] & (1u << b)) || !(layerMasks[b] & (1u << a))) {
+					continue;
+				}
+				const vector<int> &first = buckets[a];
+				const vector<int> &second = buckets[b];
+				for (int i = 0; i < first.size(); i++) {
+					for (int j = (a == b ? i + 1 : 0); j < second.size(); j++) {
+						const CollisionBody &bodyA = bodies[first[i]];
+						const CollisionBody &bodyB = bodies[second[j]];
+						if (!bodyA.filter.accepts(bodyB.filter) || !overlaps(bodyA, bodyB)) {
+							continue;
+						}
+						CollisionPair pair;
+						pair.first = first[i];
+						pair.second = second[j];
+						pairs.push_back(pair);
+					}
+				}
+			}
+		}
+	}
+};
+#endif
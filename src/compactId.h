@@ -0,0 +1,139 @@
+#pragma once
+#ifndef COMPACT_ID_H
+#define COMPACT_ID_H
+
+#include <cstddef>
+#include <vector>
+using namespace std;
+
+// Small ids for objects that per-draw code squeezes into a few bits (the render queue's sort key).
+// An id is handed out when the object is created and comes back when it goes; freed ids are
+// reused first, so ids stay below the most objects ever alive at once. 0 is never handed out.
+class CompactIdPool {
+private:
+	vector<unsigned int> freeIds;
+	unsigned int next;
+
+public:
+	CompactIdPool() {
+		next = 1;
+	}
+
+	unsigned int acquire() {
+		if (freeIds.empty()) {
+			return next++;
+		}
+		unsigned int id = freeIds.back();
+		freeIds.pop_back();
+		return id;
+	}
+
+	void release(unsigned int id) {
+		if (id != 0) {
+			freeIds.push_back(id);
+		}
+	}
+};
+
+// Owns one id of a pool. Move-only, so an object holding one can be moved (into a vector) and the
+// id is released exactly once.
+class CompactId {
+private:
+	CompactIdPool *pool;
+	unsigned int id;
+
+	CompactId(const CompactId &other);
+	CompactId &operator=(const CompactId &other);
+
+public:
+	CompactId() {
+		this->pool = NULL;
+		this->id = 0;
+	}
+
+	explicit CompactId(CompactIdPool &pool) {
+		this->pool = &pool;
+		this->id = pool.acquire();
+	}
+
+	CompactId(CompactId &&other) noexcept {
+		this->pool = other.pool;
+		this->id = other.id;
+		other.pool = NULL;
+		other.id = 0;
+	}
+
+	CompactId &operator=(CompactId &&other) noexcept {
+		if (this != &other) {
+			reset();
+			this->pool = other.pool;
+			this->id = other.id;
+			other.pool = NULL;
+			other.id = 0;
+		}
+		return *this;
+	}
+
+	~CompactId() {
+		reset();
+	}
+
+	void reset() {
+		if (pool != NULL) {
+			pool->release(id);
+		}
+		pool = NULL;
+		id = 0;
+	}
+
+	unsigned int get() const {
+		return id;
+	}
+};
+
+// Compact ids of GL objects, looked up by GL name; drivers hand out small names, so a plain
+// vector indexed by name does.
+class CompactIdTable {
+private:
+	CompactIdPool pool;
+	vector<unsigned int> ids;
+
+public:
+	void assign(unsigned int name) {
+		if (name >= ids.size()) {
+			ids.resize(name + 1, 0);
+		}
+		pool.release(ids[name]);
+		ids[name] = pool.acquire();
+	}
+
+	void release(unsigned int name) {
+		if (name < ids.size()) {
+			pool.release(ids[name]);
+			ids[name] = 0;
+		}
+	}
+
+	// 0 for names that were never assigned
+	unsigned int get(unsigned int name) const {
+		return name < ids.size() ? ids[name] : 0;
+	}
+};
+
+// The sort key ids of live programs and textures (assigned by the GL resource registry) and of
+// live meshes. Never destroyed: meshes in statics can outlive main.
+inline CompactIdTable &programIds() {
+	static CompactIdTable *table = new CompactIdTable();
+	return *table;
+}
+
+inline CompactIdTable &textureIds() {
+	static CompactIdTable *table = new CompactIdTable();
+	return *table;
+}
+
+inline CompactIdPool &meshIds() {
+	static CompactIdPool *pool = new CompactIdPool();
+	return *pool;
+}
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+using namespace std;
+
+const unsigned long long CONTENT_HASH_SEED = 14695981039346656037ull;
+
+// 64-bit FNV-1a over raw bytes, chained through hash. Used to key caches (programs, meshes) and by
+// the cook tool to tell changed inputs apart; not meant to resist anyone trying to collide it.
+inline unsigned long long contentHash(const void *data, size_t size, unsigned long long hash = CONTENT_HASH_SEED) {
+	const unsigned char *bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+// text hashes end with a separator, so "ab"+"c" and "a"+"bc" differ
+inline unsigned long long contentHash(const string &text, unsigned long long hash = CONTENT_HASH_SEED) {
+	hash = contentHash(text.data(), text.size(), hash);
+	return (hash ^ 0xFF) * 1099511628211ull;
+}
+
+// whole file, read in blocks; false if it can't be read
+inline bool fileContentHash(const string &path, unsigned long long &hash) {
+	ifstream file(path.c_str(), ios::binary);
+	if (!file) {
+		return false;
+	}
+	hash = CONTENT_HASH_SEED;
+	char block[64 * 1024];
+	while (file) {
+		file.read(block, sizeof(block));
+		hash = contentHash(block, (size_t)file.gcount(), hash);
+	}
+	return !file.bad();
+}
+#endif
@@ -0,0 +1,100 @@
+#pragma once
+#ifndef DRAW_TIMER_H
+#define DRAW_TIMER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <string>
+
+#include "glResource.h"
+#include "logger.h"
+using namespace std;
+
+// CPU and GPU time of one span of draw calls, and the triangles it drew, averaged and logged once
+// a second per mode. GPU time comes from GL_TIME_ELAPSED queries read a frame late, so reading
+// them never stalls.
+class DrawTimer {
+private:
+	string label;
+	GLQuery queries[2];
+	bool queryPending[2];
+	int frame;
+	int mode;
+	const char *modeName;
+	double cpuMilliseconds;
+	double gpuMilliseconds;
+	int cpuSamples;
+	int gpuSamples;
+	unsigned long long triangles;
+	chrono::steady_clock::time_point spanStart;
+	chrono::steady_clock::time_point reportStart;
+
+	void reset() {
+		cpuMilliseconds = gpuMilliseconds = 0.0;
+		cpuSamples = gpuSamples = 0;
+		triangles = 0;
+		reportStart = chrono::steady_clock::now();
+	}
+
+	void collect(int query) {
+		if (!queryPending[query]) {
+			return;
+		}
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(queries[query], GL_QUERY_RESULT, &nanoseconds);
+			gpuMilliseconds += nanoseconds / 1000000.0;
+			gpuSamples++;
+		}
+		queryPending[query] = false; // an unavailable result is dropped rather than waited for
+	}
+
+public:
+	DrawTimer(const char *label) {
+		this->label = label;
+		queries[0] = GLQuery::create();
+		queries[1] = GLQuery::create();
+		queryPending[0] = queryPending[1] = false;
+		frame = 0;
+		mode = -1;
+		modeName = "";
+		reset();
+	}
+
+	// mode tells the compared variants apart, averages restart when it changes
+	void begin(int mode, const char *modeName) {
+		if (mode != this->mode) {
+			this->mode = mode;
+			this->modeName = modeName;
+			queryPending[0] = queryPending[1] = false;
+			reset();
+		}
+		int query = frame & 1;
+		collect(query);
+		glBeginQuery(GL_TIME_ELAPSED, queries[query]);
+		spanStart = chrono::steady_clock::now();
+	}
+
+	// triangles drawn in the current span
+	void addTriangles(unsigned int count) {
+		triangles += count;
+	}
+
+	void end() {
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		glEndQuery(GL_TIME_ELAPSED);
+		queryPending[frame & 1] = true;
+		frame++;
+		cpuMilliseconds += chrono::duration<double, milli>(now - spanStart).count();
+		cpuSamples++;
+		if (chrono::duration<double>(now - reportStart).count() >= 1.0) {
+			logInfo(CATEGORY_RENDER, "{} [{}]: cpu {} ms, gpu {} ms, {} triangles per frame over {} frames", label, modeName,
+				cpuMilliseconds / cpuSamples, gpuSamples > 0 ? gpuMilliseconds / gpuSamples : 0.0, triangles / cpuSamples, cpuSamples);
+			reset();
+		}
+	}
+};
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <mutex>
+#include <functional>
+using namespace std;
+
+enum GameEventType {
+	EVENT_HIT,            // bullet touched an asteroid
+	EVENT_DESTROYED,      // asteroid removed by the player, value = points awarded
+	EVENT_SPAWNED,        // asteroid entered the scene
+	EVENT_PLAYER_DAMAGED, // asteroid touched the player
+	EVENT_TYPE_COUNT
+};
+
+struct GameEvent {
+	GameEventType type;
+	int entityType;     // Asteroida::types of the asteroid involved
+	glm::vec3 position;
+	glm::vec3 velocity;
+	int value;
+	float scale;    // world scale of the asteroid involved
+	int generation; // how many times the asteroid has already been split
+
+	GameEvent(GameEventType type, int entityType = 0, glm::vec3 position = glm::vec3(0.0f), glm::vec3 velocity = glm::vec3(0.0f), int value = 0, float scale = 0.0f, int generation = 0) {
+		this->type = type;
+		this->entityType = entityType;
+		this->position = position;
+		this->velocity = velocity;
+		this->value = value;
+		this->scale = scale;
+		this->generation = generation;
+	}
+};
+
+// Systems push events from their loops (from any thread) and the queue hands them to
+// the subscribed consumers in one pass, so scoring/audio/effects/logging stay out of the hot loops.
+class EventQueue {
+public:
+	typedef function<void(const GameEvent &)> Handler;
+
+private:
+	mutex pendingMutex;
+	vector<GameEvent> pending;
+	vector<GameEvent> processing;
+	vector<Handler> handlers[EVENT_TYPE_COUNT];
+
+public:
+	void push(const GameEvent &event) {
+		lock_guard<mutex> lock(pendingMutex);
+		pending.push_back(event);
+	}
+
+	void subscribe(GameEventType type, Handler handler) {
+		handlers[type].push_back(handler);
+	}
+
+	// main thread only; events pushed by handlers are delivered on the next dispatch
+	void dispatch() {
+		{
+			lock_guard<mutex> lock(pendingMutex);
+			processing.swap(pending);
+		}
+		for (int i = 0; i < processing.size(); i++) {
+			const vector<Handler> &typeHandlers = handlers[processing[i].type];
+			for (int j = 0; j < typeHandlers.size(); j++) {
+				typeHandlers[j](processing[i]);
+			}
+		}
+		processing.clear();
+	}
+};
+#endif
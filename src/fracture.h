@@ -0,0 +1,519 @@
+#pragma once
+#ifndef FRACTURE_H
+#define FRACTURE_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "model.h"
+#include "instancing.h"
+using namespace std;
+
+// Closed pieces of a model, cut along the Voronoi cells of a few seed points on its surface.
+// Piece vertices are re-centred on the piece, `offsets` holds where each piece sat in the model.
+struct FractureSet {
+	vector<Mesh> pieces;
+	vector<glm::vec3> offsets;
+};
+
+// Fracture meshes are built once per source model and reused by every later explosion.
+// Entries watch their model, so a model unloaded from the asset registry doesn't leave its pieces behind.
+class FractureCache {
+private:
+	struct Entry {
+		weak_ptr<Model> model;
+		FractureSet *set;
+	};
+
+	static map<Model*, Entry> &sets() {
+		static map<Model*, Entry> cache;
+		return cache;
+	}
+
+	// farthest point sampling spreads the seeds evenly over the surface
+	static vector<glm::vec3> pickSeeds(const vector<Vertex> &vertices, int count) {
+		vector<glm::vec3> seeds;
+		vector<float> distances(vertices.size(), numeric_limits<float>::max());
+		int next = 0;
+		for (int s = 0; s < count && s < vertices.size(); s++) {
+			seeds.push_back(vertices[next].Position);
+			int farthest = 0;
+			for (int i = 0; i < vertices.size(); i++) {
+				glm::vec3 offset = vertices[i].Position - seeds.back();
+				distances[i] = glm::min(distances[i], glm::dot(offset, offset));
+				if (distances[i] > distances[farthest]) {
+					farthest = i;
+				}
+			}
+			next = farthest;
+		}
+		return seeds;
+	}
+
+	// the point where the edge from inside (distance di <= 0) to outside (dout > 0) meets the plane;
+	// always interpolated from the inside end, so both triangles along an edge get the same point
+	static Vertex cutEdge(const Vertex &inside, float di, const Vertex &outside, float dout) {
+		float t = di / (di - dout);
+		Vertex cut;
+		cut.Position = glm::mix(inside.Position, outside.Position, t);
+		cut.Normal = glm::normalize(glm::mix(inside.Normal, outside.Normal, t));
+		cut.TexCoords = glm::mix(inside.TexCoords, outside.TexCoords, t);
+		cut.Tangent = glm::mix(inside.Tangent, outside.Tangent, t);
+		cut.Bitangent = glm::mix(inside.Bitangent, outside.Bitangent, t);
+		return cut;
+	}
+
+	// keeps the part of a closed triangle soup behind the plane (dot(normal, p) <= offset) and
+	// closes it again with a cap facing along normal (see capCut())
+	static void clipCell(vector<Vertex> &triangles, glm::vec3 normal, float offset, float uvScale) {
+		vector<Vertex> clipped;
+		vector<glm::vec3> cut; // pairs of points, in the order the cap runs through them
+		for (int t = 0; t + 2 < triangles.size(); t += 3) {
+			const Vertex *corners = &triangles[t];
+			float distances[3];
+			for (int k = 0; k < 3; k++) {
+				distances[k] = glm::dot(normal, corners[k].Position) - offset;
+			}
+			Vertex polygon[4];
+			int count = 0;
+			glm::vec3 exit, entry;
+			int crossings = 0;
+			for (int k = 0; k < 3; k++) {
+				int next = (k + 1) % 3;
+				bool inside = distances[k] <= 0.0f;
+				if (inside) {
+					polygon[count++] = corners[k];
+				}
+				if (inside && distances[next] > 0.0f) {
+					polygon[count] = cutEdge(corners[k], distances[k], corners[next], distances[next]);
+					exit = polygon[count++].Position;
+					crossings++;
+				}
+				else if (!inside && distances[next] <= 0.0f) {
+					polygon[count] = cutEdge(corners[next], distances[next], corners[k], distances[k]);
+					entry = polygon[count++].Position;
+					crossings++;
+				}
+			}
+			for (int k = 1; k + 1 < count; k++) {
+				clipped.push_back(polygon[0]);
+				clipped.push_back(polygon[k]);
+				clipped.push_back(polygon[k + 1]);
+			}
+			if (crossings == 2) {
+				cut.push_back(entry);
+				cut.push_back(exit);
+			}
+		}
+		triangles.swap(clipped);
+		if (cut.empty()) {
+			return;
+		}
+
+		// the cut edges chain into loops, the outlines of the cross section and any holes in it
+		vector<bool> used(cut.size() / 2, false);
+		vector<vector<glm::vec3> > loops;
+		for (int first = 0; first < used.size(); first++) {
+			if (used[first]) {
+				continue;
+			}
+			loops.push_back(vector<glm::vec3>());
+			vector<glm::vec3> &loop = loops.back();
+			for (int segment = first; segment >= 0;) {
+				used[segment] = true;
+				loop.push_back(cut[2 * segment]);
+				glm::vec3 end = cut[2 * segment + 1];
+				segment = -1;
+				if (end == loop[0]) {
+					break;
+				}
+				for (int s = 0; s < used.size(); s++) {
+					if (!used[s] && cut[2 * s] == end) {
+						segment = s;
+						break;
+					}
+				}
+			}
+		}
+		capCut(loops, normal, uvScale, triangles);
+	}
+
+	static float cross2(glm::vec2 a, glm::vec2 b) {
+		return a.x * b.y - a.y * b.x;
+	}
+
+	static bool segmentsCross(glm::vec2 a, glm::vec2 b, glm::vec2 c, glm::vec2 d) {
+		float abc = cross2(b - a, c - a), abd = cross2(b - a, d - a);
+		float cda = cross2(d - c, a - c), cdb = cross2(d - c, b - c);
+		return ((abc > 0.0f && abd < 0.0f) || (abc < 0.0f && abd > 0.0f)) && ((cda > 0.0f && cdb < 0.0f) || (cda < 0.0f && cdb > 0.0f));
+	}
+
+	static bool insideLoop(glm::vec2 point, const vector<glm::vec2> &loop) {
+		bool inside = false;
+		for (int i = 0, j = loop.size() - 1; i < loop.size(); j = i++) {
+			if ((loop[i].y > point.y) != (loop[j].y > point.y) &&
+				point.x < loop[j].x + (point.y - loop[j].y) * (loop[i].x - loop[j].x) / (loop[i].y - loop[j].y)) {
+				inside = !inside;
+			}
+		}
+		return inside;
+	}
+
+	// joins a hole into the outline around it along an edge from the hole's rightmost point to the
+	// nearest outline point it can see, so the outline can be clipped as one polygon
+	static void bridgeHole(vector<glm::vec3> &outline, vector<glm::vec2> &flatOutline, const vector<glm::vec3> &hole, const vector<glm::vec2> &flatHole, const vector<vector<glm::vec2> > &flat) {
+		int from = 0;
+		for (int i = 1; i < flatHole.size(); i++) {
+			if (flatHole[i].x > flatHole[from].x) {
+				from = i;
+			}
+		}
+		glm::vec2 start = flatHole[from];
+		int to = -1;
+		float nearest = numeric_limits<float>::max();
+		for (int i = 0; i < flatOutline.size(); i++) {
+			float distance = glm::length(flatOutline[i] - start);
+			if (distance >= nearest) {
+				continue;
+			}
+			bool visible = true;
+			for (int j = 0; j < flatOutline.size() && visible; j++) {
+				visible = !segmentsCross(start, flatOutline[i], flatOutline[j], flatOutline[(j + 1) % flatOutline.size()]);
+			}
+			for (int l = 0; l < flat.size() && visible; l++) {
+				for (int j = 0; j < flat[l].size() && visible; j++) {
+					visible = !segmentsCross(start, flatOutline[i], flat[l][j], flat[l][(j + 1) % flat[l].size()]);
+				}
+			}
+			if (visible || to < 0) {
+				to = i;
+				nearest = visible ? distance : nearest;
+			}
+		}
+		vector<glm::vec3> merged(outline.begin(), outline.begin() + to + 1);
+		vector<glm::vec2> flatMerged(flatOutline.begin(), flatOutline.begin() + to + 1);
+		for (int k = 0; k <= hole.size(); k++) {
+			merged.push_back(hole[(from + k) % hole.size()]);
+			flatMerged.push_back(flatHole[(from + k) % hole.size()]);
+		}
+		merged.insert(merged.end(), outline.begin() + to, outline.end());
+		flatMerged.insert(flatMerged.end(), flatOutline.begin() + to, flatOutline.end());
+		outline.swap(merged);
+		flatOutline.swap(flatMerged);
+	}
+
+	// caps the cross section a plane cut through a piece. Outlines run counter-clockwise seen from
+	// outside the piece, holes the other way round; the sections of a lumpy model are rarely convex,
+	// so each outline is ear clipped rather than fanned
+	static void capCut(vector<vector<glm::vec3> > &loops, glm::vec3 normal, float uvScale, vector<Vertex> &triangles) {
+		glm::vec3 tangent = glm::normalize(glm::cross(normal, fabs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f)));
+		glm::vec3 bitangent = glm::cross(normal, tangent);
+		vector<vector<glm::vec2> > flat(loops.size());
+		vector<float> areas(loops.size(), 0.0f);
+		for (int l = 0; l < loops.size(); l++) {
+			for (int i = 0; i < loops[l].size(); i++) {
+				flat[l].push_back(glm::vec2(glm::dot(loops[l][i], tangent), glm::dot(loops[l][i], bitangent)));
+			}
+			for (int i = 0; i < flat[l].size(); i++) {
+				areas[l] += cross2(flat[l][i], flat[l][(i + 1) % flat[l].size()]);
+			}
+		}
+		for (int h = 0; h < loops.size(); h++) {
+			if (areas[h] >= 0.0f || loops[h].size() < 3) {
+				continue;
+			}
+			// the smallest outline around the hole
+			int around = -1;
+			for (int o = 0; o < loops.size(); o++) {
+				if (areas[o] > 0.0f && insideLoop(flat[h][0], flat[o]) && (around < 0 || areas[o] < areas[around])) {
+					around = o;
+				}
+			}
+			if (around >= 0) {
+				bridgeHole(loops[around], flat[around], loops[h], flat[h], flat);
+			}
+		}
+		for (int o = 0; o < loops.size(); o++) {
+			if (areas[o] > 0.0f) {
+				capOutline(loops[o], flat[o], normal, tangent, bitangent, uvScale, triangles);
+			}
+		}
+	}
+
+	static void capOutline(const vector<glm::vec3> &loop, const vector<glm::vec2> &points, glm::vec3 normal, glm::vec3 tangent, glm::vec3 bitangent, float uvScale, vector<Vertex> &triangles) {
+		vector<int> remaining(loop.size());
+		for (int i = 0; i < remaining.size(); i++) {
+			remaining[i] = i;
+		}
+		while (remaining.size() > 2) {
+			int count = remaining.size();
+			int ear = -1;
+			// a convex corner with nothing of the loop inside it, else a flat one, else give up on
+			// whatever degenerate rest is left and clip the first
+			for (int pass = 0; pass < 2 && ear < 0; pass++) {
+				for (int i = 0; i < count && ear < 0; i++) {
+					glm::vec2 a = points[remaining[(i + count - 1) % count]];
+					glm::vec2 b = points[remaining[i]];
+					glm::vec2 c = points[remaining[(i + 1) % count]];
+					float turn = cross2(b - a, c - b);
+					if (pass == 0 ? turn <= 0.0f : turn < 0.0f) {
+						continue;
+					}
+					bool empty = true;
+					for (int j = 0; j < count && pass == 0 && empty; j++) {
+						glm::vec2 p = points[remaining[j]];
+						if (p == a || p == b || p == c) {
+							continue;
+						}
+						empty = cross2(b - a, p - a) <= 0.0f || cross2(c - b, p - b) <= 0.0f || cross2(a - c, p - c) <= 0.0f;
+					}
+					if (empty) {
+						ear = i;
+					}
+				}
+			}
+			if (ear < 0) {
+				ear = 0;
+			}
+			int corners[3] = { remaining[(ear + count - 1) % count], remaining[ear], remaining[(ear + 1) % count] };
+			for (int k = 0; k < 3; k++) {
+				Vertex vertex;
+				vertex.Position = loop[corners[k]];
+				vertex.Normal = normal;
+				vertex.TexCoords = uvScale * points[corners[k]];
+				vertex.Tangent = tangent;
+				vertex.Bitangent = bitangent;
+				triangles.push_back(vertex);
+			}
+			remaining.erase(remaining.begin() + ear);
+		}
+	}
+
+	// every seed's Voronoi cell cut out of the mesh as a closed piece: the surface inside the cell
+	// plus caps where the cell's walls (the planes halfway to the other seeds) cut through
+	static void fractureMesh(const Mesh &mesh, int pieceCount, FractureSet *set) {
+		vector<glm::vec3> seeds = pickSeeds(mesh.vertices, pieceCount);
+		vector<Vertex> surface;
+		glm::vec3 boundsMin(numeric_limits<float>::max()), boundsMax(-numeric_limits<float>::max());
+		for (int i = 0; i + 2 < mesh.indices.size(); i += 3) {
+			for (int k = 0; k < 3; k++) {
+				surface.push_back(mesh.vertices[mesh.indices[i + k]]);
+				boundsMin = glm::min(boundsMin, surface.back().Position);
+				boundsMax = glm::max(boundsMax, surface.back().Position);
+			}
+		}
+		if (surface.empty()) {
+			return;
+		}
+		float extent = glm::max(boundsMax.x - boundsMin.x, glm::max(boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z));
+		float uvScale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+		for (int c = 0; c < seeds.size(); c++) {
+			vector<Vertex> vertices = surface;
+			for (int s = 0; s < seeds.size() && !vertices.empty(); s++) {
+				glm::vec3 axis = seeds[s] - seeds[c];
+				if (s == c || glm::length(axis) <= 0.0f) {
+					continue;
+				}
+				glm::vec3 normal = glm::normalize(axis);
+				clipCell(vertices, normal, glm::dot(normal, 0.5f * (seeds[s] + seeds[c])), uvScale);
+			}
+			if (vertices.empty()) {
+				continue;
+			}
+			glm::vec3 center(0.0f);
+			for (int i = 0; i < vertices.size(); i++) {
+				center += vertices[i].Position;
+			}
+			center /= (float)vertices.size();
+			vector<unsigned int> indices(vertices.size());
+			for (int i = 0; i < vertices.size(); i++) {
+				vertices[i].Position -= center;
+				indices[i] = i;
+			}
+			set->pieces.push_back(Mesh(vertices, indices, mesh.textures));
+			set->offsets.push_back(center);
+		}
+	}
+
+public:
+	static FractureSet *get(const shared_ptr<Model> &model, int pieceCount = 8) {
+		map<Model*, Entry>::iterator found = sets().find(model.get());
+		if (found != sets().end()) {
+			if (!found->second.model.expired()) {
+				return found->second.set;
+			}
+			// a new model at the address of an unloaded one
+			delete found->second.set;
+			sets().erase(found);
+		}
+		FractureSet *set = new FractureSet();
+		for (int i = 0; i < model->meshes.size(); i++) {
+			fractureMesh(model->meshes[i], pieceCount, set);
+		}
+		Entry entry;
+		entry.model = model;
+		entry.set = set;
+		sets()[model.get()] = entry;
+		return set;
+	}
+
+	// frees the pieces of models that no longer exist
+	static int collect() {
+		int freed = 0;
+		for (map<Model*, Entry>::iterator it = sets().begin(); it != sets().end();) {
+			if (it->second.model.expired()) {
+				delete it->second.set;
+				it = sets().erase(it);
+				freed++;
+			}
+			else {
+				++it;
+			}
+		}
+		return freed;
+	}
+};
+
+struct Fragment {
+	glm::vec3 position;
+	glm::vec3 velocity;
+	glm::vec3 axis;
+	float angle;
+	float angularSpeed;
+	float scale;
+	float life;
+	int piece;
+};
+
+// Fixed-capacity pool of flying debris. Nothing is allocated after construction: dead fragments
+// are swapped out of the live range and every piece mesh is drawn with one instanced call.
+// The piece VAOs belong to the fracture set, so the pool attaches its buffers to them only once
+// it's the one drawing them (see attach()).
+class FragmentPool {
+private:
+	FractureSet *set;
+	GLuint shaderID;
+	vector<Fragment> fragments;
+	int alive;
+	vector<InstanceBuffer*> instanceBuffers;
+	vector<vector<InstanceData> > pieceInstances;
+
+	float randomFloat(float a, float b) {
+		return a + (b - a) * ((float)rand() / (float)RAND_MAX);
+	}
+
+	glm::vec3 randomDirection() {
+		glm::vec3 direction(randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f));
+		float length = glm::length(direction);
+		return length > 0.0001f ? direction / length : glm::vec3(0.0f, 1.0f, 0.0f);
+	}
+
+public:
+	FragmentPool(FractureSet *set, GLuint shaderID, int capacity) {
+		this->set = set;
+		this->shaderID = shaderID;
+		this->alive = 0;
+		fragments.resize(capacity);
+		pieceInstances.resize(set->pieces.size());
+		for (int i = 0; i < set->pieces.size(); i++) {
+			pieceInstances[i].reserve(capacity);
+			instanceBuffers.push_back(new InstanceBuffer(capacity));
+		}
+	}
+
+	~FragmentPool() {
+		for (int i = 0; i < instanceBuffers.size(); i++) {
+			delete instanceBuffers[i];
+		}
+	}
+
+	// points the pieces' VAOs at this pool's instance buffers
+	void attach() {
+		for (int i = 0; i < instanceBuffers.size(); i++) {
+			instanceBuffers[i]->attach(set->pieces[i].VAO);
+		}
+	}
+
+	// drops every fragment still flying
+	void clear() {
+		alive = 0;
+	}
+
+	FractureSet *getSet() {
+		return set;
+	}
+
+	// throws every piece of the source model outwards, on top of the inherited velocity
+	void burst(glm::vec3 position, glm::vec3 velocity, float scale) {
+		float burstSpeed = glm::max(glm::length(velocity), 0.2f);
+		for (int i = 0; i < set->pieces.size() && alive < fragments.size(); i++) {
+			Fragment &fragment = fragments[alive++];
+			glm::vec3 offset = scale * set->offsets[i];
+			glm::vec3 outwards = glm::length(offset) > 0.0f ? glm::normalize(offset) : randomDirection();
+			fragment.position = position + offset;
+			fragment.velocity = velocity + burstSpeed * randomFloat(0.3f, 1.0f) * glm::normalize(outwards + 0.5f * randomDirection());
+			fragment.axis = randomDirection();
+			fragment.angle = 0.0f;
+			fragment.angularSpeed = randomFloat(1.0f, 6.0f);
+			fragment.scale = scale;
+			fragment.life = randomFloat(1.5f, 3.0f);
+			fragment.piece = i;
+		}
+	}
+
+	void update(float deltaTime) {
+		for (int i = 0; i < alive;) {
+			Fragment &fragment = fragments[i];
+			fragment.life -= deltaTime;
+			if (fragment.life <= 0.0f) {
+				fragment = fragments[--alive];
+				continue;
+			}
+			fragment.position += deltaTime * fragment.velocity;
+			fragment.angle += deltaTime * fragment.angularSpeed;
+			i++;
+		}
+	}
+
+	void draw() {
+		if (alive == 0) {
+			return;
+		}
+		for (int i = 0; i < pieceInstances.size(); i++) {
+			pieceInstances[i].clear();
+		}
+		for (int i = 0; i < alive; i++) {
+			const Fragment &fragment = fragments[i];
+			float shrink = glm::min(fragment.life / 0.5f, 1.0f); // fade out by shrinking in the last half second
+			glm::mat4 rotation = glm::rotate(glm::mat4(1), fragment.angle, fragment.axis);
+			InstanceData instance;
+			instance.model = glm::translate(glm::mat4(1), fragment.position) * glm::scale(rotation, glm::vec3(fragment.scale * shrink));
+			instance.normal = glm::mat3(rotation); // uniform scale only changes the length, the fragment shader normalizes anyway
+			instance.params = glm::vec4(0.0f);
+			pieceInstances[fragment.piece].push_back(instance);
+		}
+		glState().useProgram(shaderID);
+		for (int i = 0; i < pieceInstances.size(); i++) {
+			if (pieceInstances[i].empty()) {
+				continue;
+			}
+			instanceBuffers[i]->upload(pieceInstances[i]);
+			set->pieces[i].DrawInstanced(shaderID, instanceBuffers[i]->getCount());
+		}
+	}
+
+	int getAliveCount() {
+		return alive;
+	}
+};
+#endif
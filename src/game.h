@@ -17,6 +17,7 @@
 #include "model.h"
 #include "shader.h"
 #include "asteroida.h"
+#include "asyncLoader.h"
 using namespace std;
 
 struct Character {
@@ -27,14 +28,14 @@ struct Character {
 };
 
 
-void renderText(Shader &shader, std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color, GLuint *VAO, GLuint *VBO, std::map<GLchar, Character> *characters)
+void renderText(Shader &shader, std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color, GLVertexArray *VAO, GLBuffer *VBO, std::map<GLchar, Character> *characters)
 {
 
 	// Activate corresponding render state	
 	shader.use();
-	glUniform3f(glGetUniformLocation(shader.ID, "textColor"), color.x, color.y, color.z);
-	glActiveTexture(GL_TEXTURE0);
-	glBindVertexArray(*VAO);
+	shader.setVec3("textColor", color);
+	glState().bindVertexArray(*VAO);
+	glState().bindBuffer(GL_ARRAY_BUFFER, *VBO);
 
 	// Iterate through all characters
 	std::string::const_iterator c;
@@ -58,19 +59,15 @@ void renderText(Shader &shader, std::string text, GLfloat x, GLfloat y, GLfloat
 		{ xpos + w, ypos + h,   1.0, 0.0 }
 		};
 		// Render glyph texture over quad
-		glBindTexture(GL_TEXTURE_2D, ch.TextureID);
+		glState().bindTexture(0, GL_TEXTURE_2D, ch.TextureID);
 		// Update content of VBO memory
-		glBindBuffer(GL_ARRAY_BUFFER, *VBO);
 		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // Be sure to use glBufferSubData and not glBufferData
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		// Render quad
 		glDrawArrays(GL_TRIANGLES, 0, 6);
 		// Now advance cursors for next glyph (note that advance is number of 1/64 pixels)
 		x += (ch.Advance >> 6) * scale; // Bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
 	}
-	glBindVertexArray(0);
-	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 class Menu {
@@ -88,7 +85,7 @@ public:
 		notSelectedColor = glm::vec3(1.0f, 1.0f, 1.0f);
 	}
 
-	void draw(Shader *textShader, float windowHeight, float windowWidth, GLuint *VAO, GLuint *VBO, std::map<GLchar, Character> *characters) {
+	void draw(Shader *textShader, float windowHeight, float windowWidth, GLVertexArray *VAO, GLBuffer *VBO, std::map<GLchar, Character> *characters) {
 		if (selectedOption == NEW_GAME) {
 			renderText(*textShader, "NEW GAME", windowWidth / 2 - 340.0f, windowHeight / 2 + 60.0f, 2.0f, selectedColor, VAO, VBO, characters);
 			renderText(*textShader, "EXIT", windowWidth / 2 - 340.0f, windowHeight / 2 - 60.0f, 2.0f, notSelectedColor, VAO, VBO, characters);
@@ -124,18 +121,27 @@ public:
 private:
 	
 	Scene *currentScene;
+	Scene *nextScene;                    // built while the NEXT_LEVEL screen shows
+	bool nextSceneReady;
+	shared_ptr<GLTexture> skybox;        // the current level's, null until the first level switch
+	shared_ptr<GLTexture> nextSkybox;    // null until the async loader has it on the GPU
+	vector<std::string> nextSkyboxFaces;
+	bool advanceRequested;               // the player asked for the next level before it was ready
 	Menu *menu;
 	Shader *textShader;
 	unsigned int defaultShaderID;
 	unsigned int reflexShaderID;
 	unsigned int refractShaderID;
+	unsigned int debrisShaderID;
+	unsigned int asteroidBatchShaderID;
+	bool batchAsteroids;
 	int windowHeight;
 	int windowWidth;
 	gameStates gameState;
-	Model *bulletModel;
+	shared_ptr<Model> bulletModel;
 	unsigned int bulletShaderID;
-	GLuint *VAO;
-	GLuint *VBO;
+	GLVertexArray *VAO;
+	GLBuffer *VBO;
 	int level;
 	std::map<GLchar, Character> *characters;
 	vector<std::string> skyboxFaces;
@@ -145,58 +151,140 @@ private:
 	
 public:
 
-	Game(Shader *textShader, unsigned int defaultShaderID, unsigned int reflexShaderID, unsigned int refractShaderID, unsigned int bulletShaderID, int windowWidth, int windowHeight,
-		GLuint *VAO, GLuint *VBO, std::map<GLchar, Character> *characters) {
+	Game(Shader *textShader, unsigned int defaultShaderID, unsigned int reflexShaderID, unsigned int refractShaderID, unsigned int bulletShaderID, unsigned int debrisShaderID, unsigned int asteroidBatchShaderID,
+		int windowWidth, int windowHeight, GLVertexArray *VAO, GLBuffer *VBO, std::map<GLchar, Character> *characters) {
 		this->textShader = textShader;
 		this->windowWidth = windowWidth;
 		this->windowHeight = windowHeight;
 		this->defaultShaderID = defaultShaderID;
 		this->reflexShaderID = reflexShaderID;
 		this->refractShaderID = refractShaderID;
-		this->bulletModel = new Model("res/models/asteroid/asteroid.obj");
+		this->debrisShaderID = debrisShaderID;
+		this->asteroidBatchShaderID = asteroidBatchShaderID;
+		this->batchAsteroids = true;
+		this->bulletModel = assets().model("res/models/asteroid/asteroid.obj");
 		this->bulletShaderID = bulletShaderID;
 		this->VAO = VAO;
 		this->VBO = VBO;
 		this->characters = characters;
 		menu = new Menu();
+		currentScene = NULL;
+		nextScene = NULL;
+		nextSceneReady = false;
+		advanceRequested = false;
 		gameState = MENU;
 	}
 
+	Scene *createScene() {
+		Scene *scene = new Scene(defaultShaderID, reflexShaderID, refractShaderID, debrisShaderID, asteroidBatchShaderID, 2.0f, 0.5f);
+		scene->setAsteroidBatching(batchAsteroids);
+		scene->generateAsteroids(20, glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f), 150.0f, 180.0f);
+		return scene;
+	}
+
 	void initialize() {
-		currentScene = new Scene(defaultShaderID, reflexShaderID, refractShaderID, 2.0f, 0.5f);
-		currentScene->generateAsteroids(20, glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f), 150.0f, 180.0f);
+		Scene *previous = currentScene; // a new game after a game over replaces the old scene
+		delete nextScene;
+		nextScene = NULL;
+		advanceRequested = false;
+		currentScene = createScene();
+		currentScene->activate(previous);
+		delete previous;
 		level = 1;
 		skyboxFaces = {
-			"C:\\Users\\mattibu\\Desktop\\studia\\5sem\\PAGi\\OpenGLPAG\\res\\textures\\skybox\\right.jpg",
-			"C:\\Users\\mattibu\\Desktop\\studia\\5sem\\PAGi\\OpenGLPAG\\res\\textures\\skybox\\left.jpg",
-			"C:\\Users\\mattibu\\Desktop\\studia\\5sem\\PAGi\\OpenGLPAG\\res\\textures\\skybox\\top.jpg",
-			"C:\\Users\\mattibu\\Desktop\\studia\\5sem\\PAGi\\OpenGLPAG\\res\\textures\\skybox\\bottom.jpg",
-			"C:\\Users\\mattibu\\Desktop\\studia\\5sem\\PAGi\\OpenGLPAG\\res\\textures\\skybox\\front.jpg",
-			"C:\\Users\\mattibu\\Desktop\\studia\\5sem\\PAGi\\OpenGLPAG\\res\\textures\\skybox\\back.jpg"
+			"res/textures/skybox/right.jpg",
+			"res/textures/skybox/left.jpg",
+			"res/textures/skybox/top.jpg",
+			"res/textures/skybox/bottom.jpg",
+			"res/textures/skybox/front.jpg",
+			"res/textures/skybox/back.jpg"
 		};
 	}
 
-	void loadNextLevel() {
-		delete currentScene;
-		currentScene = new Scene(defaultShaderID, reflexShaderID, refractShaderID, 2.0f, 0.5f);
-		currentScene->generateAsteroids(20, glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f), 150.0f, 180.0f);
-		level = 1;
-		skyboxFaces = {
-			"C:\\Users\\mattibu\\Desktop\\studia\\5sem\\PAGi\\OpenGLPAG\\res\\textures\\skybox2\\right.jpg",
-			"C:\\Users\\mattibu\\Desktop\\studia\\5sem\\PAGi\\OpenGLPAG\\res\\textures\\skybox2\\left.jpg",
-			"C:\\Users\\mattibu\\Desktop\\studia\\5sem\\PAGi\\OpenGLPAG\\res\\textures\\skybox2\\top.jpg",
-			"C:\\Users\\mattibu\\Desktop\\studia\\5sem\\PAGi\\OpenGLPAG\\res\\textures\\skybox2\\bottom.jpg",
-			"C:\\Users\\mattibu\\Desktop\\studia\\5sem\\PAGi\\OpenGLPAG\\res\\textures\\skybox2\\front.jpg",
-			"C:\\Users\\mattibu\\Desktop\\studia\\5sem\\PAGi\\OpenGLPAG\\res\\textures\\skybox2\\back.jpg"
+	// Starts building the next level when its screen comes up: the scene places its asteroids a few
+	// per frame in prewarmNextLevel() and the skybox decodes and uploads in the background.
+	void startNextLevel() {
+		delete nextScene;
+		nextScene = createScene();
+		nextSceneReady = false;
+		nextSkyboxFaces = {
+			"res/textures/skybox2/right.jpg",
+			"res/textures/skybox2/left.jpg",
+			"res/textures/skybox2/top.jpg",
+			"res/textures/skybox2/bottom.jpg",
+			"res/textures/skybox2/front.jpg",
+			"res/textures/skybox2/back.jpg"
 		};
+		nextSkybox.reset();
+		Scene *requested = nextScene;
+		asyncLoader().loadCubemap(nextSkyboxFaces, [this, requested](shared_ptr<GLTexture> loaded) {
+			if (this->nextScene != requested) { // not for a level that was abandoned meanwhile
+				return;
+			}
+			if (loaded) {
+				this->nextSkybox = loaded;
+			}
+			else {
+				// the level still starts, under the skybox it has now
+				this->nextSkybox = this->skybox;
+				this->nextSkyboxFaces = this->skyboxFaces;
+			}
+		});
+	}
+
+	void prewarmNextLevel(glm::vec3 playerPosition) {
+		if (nextScene != NULL && !nextSceneReady) {
+			nextSceneReady = nextScene->prewarm(playerPosition);
+		}
+	}
+
+	bool isNextLevelReady() {
+		return nextScene != NULL && nextSceneReady && nextSkybox;
+	}
 
+	// the prewarmed scene and its skybox replace the current ones together, between two frames
+	void switchLevel() {
+		Scene *previous = currentScene;
+		currentScene = nextScene;
+		nextScene = NULL;
+		currentScene->activate(previous);
+		skybox = nextSkybox;
+		skyboxFaces = nextSkyboxFaces;
+		nextSkybox.reset();
+		delete previous;
+		advanceRequested = false;
+		level = 1;
 		gameState = RUNNING;
 	}
 
+	// switches right away when the next level is prewarmed, otherwise as soon as it is
+	void loadNextLevel() {
+		advanceRequested = true;
+		if (isNextLevelReady()) {
+			switchLevel();
+		}
+	}
+
+	// benchmark switch between the uber asteroid batch and a program per asteroid type, kept across levels
+	void toggleAsteroidBatching() {
+		batchAsteroids = !batchAsteroids;
+		if (currentScene != NULL) {
+			currentScene->setAsteroidBatching(batchAsteroids);
+		}
+		if (nextScene != NULL) {
+			nextScene->setAsteroidBatching(batchAsteroids);
+		}
+		logInfo(CATEGORY_RENDER, "asteroid batching {}", batchAsteroids ? "on" : "off");
+	}
+
 	vector<std::string> getSkyboxFaces() {
 		return skyboxFaces;
 	}
 
+	shared_ptr<GLTexture> getSkybox() {
+		return skybox;
+	}
+
 
 	void drawGui(){
 		renderText(*textShader, "Points: " + to_string(currentScene->getPoints()), 20, windowHeight - 20,0.5f, glm::vec3(1.0f, 1.0f, 0.0f), VAO, VBO, characters);
@@ -212,12 +300,15 @@ public:
 	void drawNextLevelScreen() {
 		renderText(*textShader, "NEXT LEVEL", windowWidth / 2 - 340.0f, windowHeight / 2, 2.0f, glm::vec3(1.0f, 1.0f, 0.0f), VAO, VBO, characters);
 		renderText(*textShader, "Points: " + to_string(currentScene->getPoints()), windowWidth / 2 - 300.0f, windowHeight / 2 - 80.0f, 2.0f, glm::vec3(1.0f, 1.0f, 0.0f), VAO, VBO, characters);
+		if (advanceRequested) {
+			renderText(*textShader, "Loading...", windowWidth / 2 - 300.0f, windowHeight / 2 - 160.0f, 1.0f, glm::vec3(1.0f, 1.0f, 0.0f), VAO, VBO, characters);
+		}
 
 	}
 
 
 	void shoot(glm::vec3 position, glm::vec3 direction) {
-		currentScene->shoot(bulletModel, bulletShaderID, position, direction, 25000.0f);
+		currentScene->shoot(bulletModel.get(), bulletShaderID, position, direction, 25000.0f);
 	}
 
 	void changeMenuOptionUp() {
@@ -257,7 +348,13 @@ public:
 		}
 
 		if (gameState == NEXT_LEVEL) {
-			drawNextLevelScreen();
+			prewarmNextLevel(playerPosition);
+			if (advanceRequested && isNextLevelReady()) {
+				switchLevel();
+			}
+			else {
+				drawNextLevelScreen();
+			}
 		}
 
 		if (gameState == RUNNING) {
@@ -267,6 +364,7 @@ public:
 
 			if (currentScene->getAsteroidNumber() == 0) {
 				gameState = NEXT_LEVEL;
+				startNextLevel();
 			}
 			
 			drawGui();
@@ -0,0 +1,224 @@
+#pragma once
+#ifndef GL_RESOURCE_H
+#define GL_RESOURCE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <map>
+
+#include "glState.h"
+#include "compactId.h"
+#include "logger.h"
+using namespace std;
+
+enum GLResourceKind {
+	GL_RESOURCE_BUFFER,
+	GL_RESOURCE_TEXTURE,
+	GL_RESOURCE_VERTEX_ARRAY,
+	GL_RESOURCE_FRAMEBUFFER,
+	GL_RESOURCE_PROGRAM,
+	GL_RESOURCE_QUERY,
+	GL_RESOURCE_KIND_COUNT
+};
+
+static const char *const glResourceKindNames[GL_RESOURCE_KIND_COUNT] = { "buffers", "textures", "vertex arrays", "framebuffers", "programs", "queries" };
+
+// Live GL objects by kind, with the memory their owners reported for them. Sizes are estimates
+// (what was uploaded, not what the driver allocated), good enough to see a category growing.
+// Programs and textures also hold their render queue sort id (compactId.h) while they live.
+class GLResourceRegistry {
+private:
+	map<GLuint, size_t> sizes[GL_RESOURCE_KIND_COUNT];
+	size_t bytes[GL_RESOURCE_KIND_COUNT];
+	bool contextAlive;
+
+	GLResourceRegistry() {
+		for (int kind = 0; kind < GL_RESOURCE_KIND_COUNT; kind++) {
+			bytes[kind] = 0;
+		}
+		contextAlive = true;
+	}
+
+	static CompactIdTable *compactIds(GLResourceKind kind) {
+		return kind == GL_RESOURCE_PROGRAM ? &programIds() : kind == GL_RESOURCE_TEXTURE ? &textureIds() : NULL;
+	}
+
+public:
+	static GLResourceRegistry &instance() {
+		static GLResourceRegistry registry;
+		return registry;
+	}
+
+	void created(GLResourceKind kind, GLuint id) {
+		sizes[kind][id] = 0;
+		if (compactIds(kind) != NULL) {
+			compactIds(kind)->assign(id);
+		}
+	}
+
+	void destroyed(GLResourceKind kind, GLuint id) {
+		map<GLuint, size_t>::iterator found = sizes[kind].find(id);
+		if (found != sizes[kind].end()) {
+			bytes[kind] -= found->second;
+			sizes[kind].erase(found);
+		}
+		if (compactIds(kind) != NULL) {
+			compactIds(kind)->release(id);
+		}
+	}
+
+	// replaces the previous estimate, e.g. when a buffer is reallocated with glBufferData
+	void setSize(GLResourceKind kind, GLuint id, size_t size) {
+		map<GLuint, size_t>::iterator found = sizes[kind].find(id);
+		if (found != sizes[kind].end()) {
+			bytes[kind] += size - found->second;
+			found->second = size;
+		}
+	}
+
+	int getLiveCount(GLResourceKind kind) {
+		return sizes[kind].size();
+	}
+
+	size_t getBytes(GLResourceKind kind) {
+		return bytes[kind];
+	}
+
+	size_t getTotalBytes() {
+		size_t total = 0;
+		for (int kind = 0; kind < GL_RESOURCE_KIND_COUNT; kind++) {
+			total += bytes[kind];
+		}
+		return total;
+	}
+
+	void report(const char *when) {
+		logInfo(CATEGORY_RENDER, "GL objects {}: {} KiB estimated", when, getTotalBytes() / 1024);
+		for (int kind = 0; kind < GL_RESOURCE_KIND_COUNT; kind++) {
+			if (!sizes[kind].empty()) {
+				logInfo(CATEGORY_RENDER, "  {} {}, {} KiB", sizes[kind].size(), glResourceKindNames[kind], bytes[kind] / 1024);
+			}
+		}
+	}
+
+	// called right before the context goes away: whatever is still alive is reported and the
+	// handles destroyed after this (statics, main's locals) no longer call into GL
+	void shutdown() {
+		report("alive at shutdown");
+		contextAlive = false;
+	}
+
+	bool isContextAlive() {
+		return contextAlive;
+	}
+};
+
+inline GLResourceRegistry &glResources() {
+	return GLResourceRegistry::instance();
+}
+
+// estimated size of a texture level chain, a full mip chain adds a third
+inline size_t textureBytes(int width, int height, int bytesPerTexel, bool mipmapped, int layers = 1) {
+	size_t size = (size_t)width * height * bytesPerTexel * layers;
+	return mipmapped ? size + size / 3 : size;
+}
+
+// Owns one GL object name. Move-only: the object is deleted exactly once, by whichever handle
+// holds it last, and the state cache and registry are told about it.
+template<GLResourceKind Kind>
+class GLHandle {
+private:
+	GLuint id;
+
+	static GLuint generate() {
+		GLuint name = 0;
+		switch (Kind) {
+		case GL_RESOURCE_BUFFER: glGenBuffers(1, &name); break;
+		case GL_RESOURCE_TEXTURE: glGenTextures(1, &name); break;
+		case GL_RESOURCE_VERTEX_ARRAY: glGenVertexArrays(1, &name); break;
+		case GL_RESOURCE_FRAMEBUFFER: glGenFramebuffers(1, &name); break;
+		case GL_RESOURCE_PROGRAM: name = glCreateProgram(); break;
+		case GL_RESOURCE_QUERY: glGenQueries(1, &name); break;
+		default: break;
+		}
+		return name;
+	}
+
+	static void destroy(GLuint name) {
+		switch (Kind) {
+		case GL_RESOURCE_BUFFER: glState().forgetBuffer(name); glDeleteBuffers(1, &name); break;
+		case GL_RESOURCE_TEXTURE: glState().forgetTexture(name); glDeleteTextures(1, &name); break;
+		case GL_RESOURCE_VERTEX_ARRAY: glState().forgetVertexArray(name); glDeleteVertexArrays(1, &name); break;
+		case GL_RESOURCE_FRAMEBUFFER: glDeleteFramebuffers(1, &name); break;
+		case GL_RESOURCE_PROGRAM: glState().forgetProgram(name); glDeleteProgram(name); break;
+		case GL_RESOURCE_QUERY: glDeleteQueries(1, &name); break;
+		default: break;
+		}
+	}
+
+	GLHandle(const GLHandle &other);
+	GLHandle &operator=(const GLHandle &other);
+
+public:
+	GLHandle() {
+		this->id = 0;
+	}
+
+	static GLHandle create() {
+		GLHandle handle;
+		handle.id = generate();
+		glResources().created(Kind, handle.id);
+		return handle;
+	}
+
+	GLHandle(GLHandle &&other) noexcept {
+		this->id = other.id;
+		other.id = 0;
+	}
+
+	GLHandle &operator=(GLHandle &&other) noexcept {
+		if (this != &other) {
+			reset();
+			this->id = other.id;
+			other.id = 0;
+		}
+		return *this;
+	}
+
+	~GLHandle() {
+		reset();
+	}
+
+	void reset() {
+		if (id == 0) {
+			return;
+		}
+		glResources().destroyed(Kind, id);
+		if (glResources().isContextAlive()) {
+			destroy(id);
+		}
+		id = 0;
+	}
+
+	// size in bytes for the registry, see textureBytes() for textures
+	void setSize(size_t size) {
+		glResources().setSize(Kind, id, size);
+	}
+
+	GLuint get() const {
+		return id;
+	}
+
+	operator GLuint() const {
+		return id;
+	}
+};
+
+typedef GLHandle<GL_RESOURCE_BUFFER> GLBuffer;
+typedef GLHandle<GL_RESOURCE_TEXTURE> GLTexture;
+typedef GLHandle<GL_RESOURCE_VERTEX_ARRAY> GLVertexArray;
+typedef GLHandle<GL_RESOURCE_FRAMEBUFFER> GLFramebuffer;
+typedef GLHandle<GL_RESOURCE_PROGRAM> GLProgram;
+typedef GLHandle<GL_RESOURCE_QUERY> GLQuery;
+#endif
@@ -0,0 +1,248 @@
+#pragma once
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+using namespace std;
+
+const int GL_STATE_TEXTURE_UNITS = 16;
+const GLuint GL_STATE_UNKNOWN = 0xFFFFFFFFu; // forces the next call through
+const GLint GL_DEFAULT_UNPACK_ALIGNMENT = 4;
+
+// Shadow copy of the GL bindings the engine touches. Draw code goes through it instead of calling
+// glUseProgram/glBindVertexArray/glBindTexture... directly, so a call that wouldn't change anything
+// never reaches the driver. Anything that changes state behind its back (e.g. deleting a bound object)
+// has to call the matching forget*()/invalidate().
+class GLState {
+private:
+	enum TextureTarget { TARGET_2D, TARGET_CUBE_MAP, TEXTURE_TARGET_COUNT };
+	enum BufferTarget { BUFFER_ARRAY, BUFFER_UNIFORM, BUFFER_PIXEL_UNPACK, BUFFER_TARGET_COUNT };
+	enum Capability { CAPABILITY_BLEND, CAPABILITY_DEPTH_TEST, CAPABILITY_CULL_FACE, CAPABILITY_COUNT };
+
+	GLuint program;
+	GLuint vertexArray;
+	GLuint buffers[BUFFER_TARGET_COUNT];
+	GLuint activeUnit;
+	GLuint textures[GL_STATE_TEXTURE_UNITS][TEXTURE_TARGET_COUNT];
+	GLuint capabilities[CAPABILITY_COUNT];
+	GLenum blendSource, blendDestination;
+	GLenum depthFunction;
+	GLuint depthWrite;
+	GLuint unpackAlignmentValue;
+
+	unsigned long long issued;
+	unsigned long long skipped;
+
+	GLState() {
+		invalidate();
+		resetCounters();
+	}
+
+	bool changes(GLuint &cached, GLuint value) {
+		if (cached == value) {
+			skipped++;
+			return false;
+		}
+		cached = value;
+		issued++;
+		return true;
+	}
+
+	static int textureTarget(GLenum target) {
+		return target == GL_TEXTURE_CUBE_MAP ? TARGET_CUBE_MAP : TARGET_2D;
+	}
+
+	static int bufferTarget(GLenum target) {
+		switch (target) {
+		case GL_ARRAY_BUFFER: return BUFFER_ARRAY;
+		case GL_UNIFORM_BUFFER: return BUFFER_UNIFORM;
+		case GL_PIXEL_UNPACK_BUFFER: return BUFFER_PIXEL_UNPACK;
+		}
+		return -1;
+	}
+
+	static int capability(GLenum cap) {
+		switch (cap) {
+		case GL_BLEND: return CAPABILITY_BLEND;
+		case GL_DEPTH_TEST: return CAPABILITY_DEPTH_TEST;
+		case GL_CULL_FACE: return CAPABILITY_CULL_FACE;
+		}
+		return -1;
+	}
+
+public:
+	static GLState &instance() {
+		static GLState state;
+		return state;
+	}
+
+	// after foreign code (or a lost context) touched the bindings
+	void invalidate() {
+		program = GL_STATE_UNKNOWN;
+		vertexArray = GL_STATE_UNKNOWN;
+		for (int i = 0; i < BUFFER_TARGET_COUNT; i++) {
+			buffers[i] = GL_STATE_UNKNOWN;
+		}
+		activeUnit = GL_STATE_UNKNOWN;
+		for (int unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++) {
+			for (int target = 0; target < TEXTURE_TARGET_COUNT; target++) {
+				textures[unit][target] = GL_STATE_UNKNOWN;
+			}
+		}
+		for (int i = 0; i < CAPABILITY_COUNT; i++) {
+			capabilities[i] = GL_STATE_UNKNOWN;
+		}
+		blendSource = blendDestination = GL_STATE_UNKNOWN;
+		depthFunction = GL_STATE_UNKNOWN;
+		depthWrite = GL_STATE_UNKNOWN;
+		unpackAlignmentValue = GL_STATE_UNKNOWN;
+	}
+
+	void useProgram(GLuint id) {
+		if (changes(program, id)) {
+			glUseProgram(id);
+		}
+	}
+
+	void bindVertexArray(GLuint id) {
+		if (changes(vertexArray, id)) {
+			glBindVertexArray(id);
+		}
+	}
+
+	// GL_ELEMENT_ARRAY_BUFFER is part of the VAO and other targets aren't tracked, those are always issued
+	void bindBuffer(GLenum target, GLuint id) {
+		int index = bufferTarget(target);
+		if (index < 0) {
+			issued++;
+			glBindBuffer(target, id);
+		}
+		else if (changes(buffers[index], id)) {
+			glBindBuffer(target, id);
+		}
+	}
+
+	void activeTexture(GLuint unit) {
+		if (changes(activeUnit, unit)) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+		}
+	}
+
+	// unit is an index (0, 1...), not GL_TEXTUREi
+	void bindTexture(GLuint unit, GLenum target, GLuint id) {
+		if (unit >= GL_STATE_TEXTURE_UNITS) {
+			issued += 2;
+			activeUnit = unit;
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(target, id);
+			return;
+		}
+		GLuint &cached = textures[unit][textureTarget(target)];
+		if (cached == id) {
+			skipped++;
+			return;
+		}
+		activeTexture(unit);
+		changes(cached, id);
+		glBindTexture(target, id);
+	}
+
+	void setEnabled(GLenum cap, bool enabled) {
+		int index = capability(cap);
+		if (index >= 0 && !changes(capabilities[index], enabled ? 1 : 0)) {
+			return;
+		}
+		if (index < 0) {
+			issued++;
+		}
+		if (enabled) {
+			glEnable(cap);
+		}
+		else {
+			glDisable(cap);
+		}
+	}
+
+	void blendFunc(GLenum source, GLenum destination) {
+		if (blendSource == source && blendDestination == destination) {
+			skipped++;
+			return;
+		}
+		blendSource = source;
+		blendDestination = destination;
+		issued++;
+		glBlendFunc(source, destination);
+	}
+
+	void depthFunc(GLenum function) {
+		if (changes(depthFunction, function)) {
+			glDepthFunc(function);
+		}
+	}
+
+	void depthMask(bool write) {
+		if (changes(depthWrite, write ? 1 : 0)) {
+			glDepthMask(write ? GL_TRUE : GL_FALSE);
+		}
+	}
+
+	// GL_UNPACK_ALIGNMENT for the uploads that follow, returns the previous one to restore afterwards
+	// (GL's default if it isn't known)
+	GLint unpackAlignment(GLint alignment) {
+		GLint previous = unpackAlignmentValue == GL_STATE_UNKNOWN ? GL_DEFAULT_UNPACK_ALIGNMENT : (GLint)unpackAlignmentValue;
+		if (changes(unpackAlignmentValue, alignment)) {
+			glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+		}
+		return previous;
+	}
+
+	// deleted names may be handed out again, so the cache must not keep believing they're bound
+	void forgetProgram(GLuint id) {
+		if (program == id) {
+			program = GL_STATE_UNKNOWN;
+		}
+	}
+
+	void forgetVertexArray(GLuint id) {
+		if (vertexArray == id) {
+			vertexArray = GL_STATE_UNKNOWN;
+		}
+	}
+
+	void forgetBuffer(GLuint id) {
+		for (int i = 0; i < BUFFER_TARGET_COUNT; i++) {
+			if (buffers[i] == id) {
+				buffers[i] = GL_STATE_UNKNOWN;
+			}
+		}
+	}
+
+	void forgetTexture(GLuint id) {
+		for (int unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++) {
+			for (int target = 0; target < TEXTURE_TARGET_COUNT; target++) {
+				if (textures[unit][target] == id) {
+					textures[unit][target] = GL_STATE_UNKNOWN;
+				}
+			}
+		}
+	}
+
+	unsigned long long getIssuedCount() {
+		return issued;
+	}
+
+	unsigned long long getSkippedCount() {
+		return skipped;
+	}
+
+	void resetCounters() {
+		issued = 0;
+		skipped = 0;
+	}
+};
+
+inline GLState &glState() {
+	return GLState::instance();
+}
+#endif
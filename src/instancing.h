@@ -0,0 +1,84 @@
+#pragma once
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include "glState.h"
+#include "glResource.h"
+using namespace std;
+
+// first vertex attribute used by per-instance data, Mesh uses 0-4
+const GLuint INSTANCE_ATTRIBUTE_LOCATION = 5;
+const GLuint INSTANCE_NORMAL_ATTRIBUTE_LOCATION = INSTANCE_ATTRIBUTE_LOCATION + 4;
+const GLuint INSTANCE_PARAMS_ATTRIBUTE_LOCATION = INSTANCE_NORMAL_ATTRIBUTE_LOCATION + 3;
+
+// Per-instance data: the model matrix and its normal matrix, so the vertex stage doesn't invert anything.
+struct InstanceData {
+	glm::mat4 model;
+	glm::mat3 normal;
+	glm::vec4 params; // x: material of the instance for the asteroid uber material
+};
+
+// Fixed-capacity buffer of per-instance data, attached to mesh VAOs at locations 5-8 (model), 9-11 (normal)
+// and 12 (params). One buffer can be attached to several VAOs.
+class InstanceBuffer {
+private:
+	GLBuffer VBO;
+	int capacity;
+	int count;
+
+public:
+	InstanceBuffer(int capacity) {
+		this->capacity = capacity;
+		this->count = 0;
+		VBO = GLBuffer::create();
+		glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+		VBO.setSize(capacity * sizeof(InstanceData));
+	}
+
+	// a matrix attribute takes one consecutive location per column
+	void attach(GLuint VAO) {
+		glState().bindVertexArray(VAO);
+		glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+		for (GLuint i = 0; i < 4; i++) {
+			glEnableVertexAttribArray(INSTANCE_ATTRIBUTE_LOCATION + i);
+			glVertexAttribPointer(INSTANCE_ATTRIBUTE_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+			glVertexAttribDivisor(INSTANCE_ATTRIBUTE_LOCATION + i, 1);
+		}
+		for (GLuint i = 0; i < 3; i++) {
+			glEnableVertexAttribArray(INSTANCE_NORMAL_ATTRIBUTE_LOCATION + i);
+			glVertexAttribPointer(INSTANCE_NORMAL_ATTRIBUTE_LOCATION + i, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, normal) + i * sizeof(glm::vec3)));
+			glVertexAttribDivisor(INSTANCE_NORMAL_ATTRIBUTE_LOCATION + i, 1);
+		}
+		glEnableVertexAttribArray(INSTANCE_PARAMS_ATTRIBUTE_LOCATION);
+		glVertexAttribPointer(INSTANCE_PARAMS_ATTRIBUTE_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, params));
+		glVertexAttribDivisor(INSTANCE_PARAMS_ATTRIBUTE_LOCATION, 1);
+		glState().bindVertexArray(0);
+	}
+
+	// orphans the old storage so the driver doesn't stall on buffers still in flight
+	void upload(const vector<InstanceData> &instances) {
+		count = instances.size() < capacity ? instances.size() : capacity;
+		glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+		if (count > 0) {
+			glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), &instances[0]);
+		}
+	}
+
+	int getCount() {
+		return count;
+	}
+
+	int getCapacity() {
+		return capacity;
+	}
+};
+#endif
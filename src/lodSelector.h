@@ -0,0 +1,68 @@
+#pragma once
+#ifndef LOD_SELECTOR_H
+#define LOD_SELECTOR_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <vector>
+using namespace std;
+
+const float LOD_PIXEL_ERROR = 1.0f;     // how far, in pixels, a level may draw its surface from the full mesh
+const float LOD_MIN_DISTANCE = 0.001f;  // closer than this always gets the full mesh
+
+// Picks a level of detail by how big its error bound would be on screen: the coarsest level
+// whose error, scaled into the world and projected at the object's distance, stays within
+// LOD_PIXEL_ERROR. The projection comes from the camera once a frame.
+class LodSelector {
+private:
+	float pixelsPerUnit; // on screen, for something one world unit across at distance 1
+	bool enabled;
+
+	LodSelector() {
+		pixelsPerUnit = 0.0f;
+		enabled = true;
+	}
+
+public:
+	static LodSelector &instance() {
+		static LodSelector selector;
+		return selector;
+	}
+
+	// fovY in radians, viewportHeight in pixels
+	void setProjection(float fovY, int viewportHeight) {
+		pixelsPerUnit = viewportHeight / (2.0f * tan(0.5f * fovY));
+	}
+
+	// disabled, everything draws its full mesh
+	void setEnabled(bool enabled) {
+		this->enabled = enabled;
+	}
+
+	bool isEnabled() const {
+		return enabled;
+	}
+
+	// errors per level in model units, level 0 (the full mesh) first; scale takes them into the
+	// world and distance is from the eye to the nearest the object can get
+	int select(const vector<float> &errors, float scale, float distance) const {
+		if (!enabled || pixelsPerUnit <= 0.0f || distance < LOD_MIN_DISTANCE) {
+			return 0;
+		}
+		float pixelsPerModelUnit = scale * pixelsPerUnit / distance;
+		int lod = 0;
+		for (int level = 1; level < errors.size(); level++) {
+			if (errors[level] * pixelsPerModelUnit > LOD_PIXEL_ERROR) {
+				break;
+			}
+			lod = level;
+		}
+		return lod;
+	}
+};
+
+inline LodSelector &lodSelector() {
+	return LodSelector::instance();
+}
+#endif
@@ -0,0 +1,306 @@
+#pragma once
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+using namespace std;
+
+enum LogLevel { LEVEL_DEBUG, LEVEL_INFO, LEVEL_WARNING, LEVEL_ERROR };
+enum LogCategory { CATEGORY_GAME, CATEGORY_RENDER, CATEGORY_SHADER, CATEGORY_ASSETS, CATEGORY_INPUT, CATEGORY_COUNT };
+
+const int LOG_MAX_ARGUMENTS = 8;
+const int LOG_TEXT_CAPACITY = 1024; // inline storage for copied strings, longer text goes through logText
+const int LOG_QUEUE_SIZE = 512;     // must be a power of two
+
+// A log argument captured in binary form; turning it into text happens on the writer thread.
+struct LogArgument {
+	enum Kind { INT, UINT, DOUBLE, BOOL, TEXT, VEC3 };
+	Kind kind;
+	union {
+		long long i;
+		unsigned long long u;
+		double d;
+		float v[3];
+		struct {
+			unsigned short offset;
+			unsigned short length;
+		} text;
+	};
+};
+
+struct LogRecord {
+	long long time; // microseconds since the logger started
+	LogLevel level;
+	LogCategory category;
+	const char *format; // string literal, "{}" marks the next argument
+	int argumentCount;
+	LogArgument arguments[LOG_MAX_ARGUMENTS];
+	int textUsed;
+	char text[LOG_TEXT_CAPACITY];
+};
+
+// Logging front end: producers claim a slot of a bounded lock-free MPSC ring, copy the raw
+// arguments into it and publish it. A background thread formats and writes the records,
+// so the calling thread never formats, locks or flushes. When the ring is full the record is dropped.
+class Logger {
+private:
+	struct Slot {
+		atomic<size_t> sequence;
+		LogRecord record;
+	};
+
+	Slot slots[LOG_QUEUE_SIZE];
+	atomic<size_t> enqueuePosition;
+	size_t dequeuePosition; // writer thread only
+	atomic<bool> running;
+	atomic<int> minLevel;
+	atomic<unsigned int> categoryMask;
+	atomic<unsigned int> dropped;
+	chrono::steady_clock::time_point start;
+	thread writer;
+	string line;
+
+	Logger() : enqueuePosition(0), dequeuePosition(0), running(true), minLevel(LEVEL_INFO), categoryMask(~0u), dropped(0) {
+		for (size_t i = 0; i < LOG_QUEUE_SIZE; i++) {
+			slots[i].sequence.store(i, memory_order_relaxed);
+		}
+		start = chrono::steady_clock::now();
+		writer = thread(&Logger::writerLoop, this);
+	}
+
+	~Logger() {
+		running.store(false, memory_order_release);
+		writer.join();
+	}
+
+	Slot *claim(size_t &position) {
+		position = enqueuePosition.load(memory_order_relaxed);
+		for (;;) {
+			Slot *slot = &slots[position & (LOG_QUEUE_SIZE - 1)];
+			size_t sequence = slot->sequence.load(memory_order_acquire);
+			long long difference = (long long)sequence - (long long)position;
+			if (difference == 0) {
+				if (enqueuePosition.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+					return slot;
+				}
+			}
+			else if (difference < 0) {
+				return nullptr; // full
+			}
+			else {
+				position = enqueuePosition.load(memory_order_relaxed);
+			}
+		}
+	}
+
+	static void capture(LogRecord &) {
+	}
+
+	template<typename T, typename... Rest>
+	static void capture(LogRecord &record, const T &value, const Rest&... rest) {
+		if (record.argumentCount < LOG_MAX_ARGUMENTS) {
+			store(record, record.arguments[record.argumentCount++], value);
+		}
+		capture(record, rest...);
+	}
+
+	static void store(LogRecord &, LogArgument &argument, int value) { argument.kind = LogArgument::INT; argument.i = value; }
+	static void store(LogRecord &, LogArgument &argument, long value) { argument.kind = LogArgument::INT; argument.i = value; }
+	static void store(LogRecord &, LogArgument &argument, long long value) { argument.kind = LogArgument::INT; argument.i = value; }
+	static void store(LogRecord &, LogArgument &argument, unsigned int value) { argument.kind = LogArgument::UINT; argument.u = value; }
+	static void store(LogRecord &, LogArgument &argument, unsigned long value) { argument.kind = LogArgument::UINT; argument.u = value; }
+	static void store(LogRecord &, LogArgument &argument, unsigned long long value) { argument.kind = LogArgument::UINT; argument.u = value; }
+	static void store(LogRecord &, LogArgument &argument, float value) { argument.kind = LogArgument::DOUBLE; argument.d = value; }
+	static void store(LogRecord &, LogArgument &argument, double value) { argument.kind = LogArgument::DOUBLE; argument.d = value; }
+	static void store(LogRecord &, LogArgument &argument, bool value) { argument.kind = LogArgument::BOOL; argument.u = value; }
+	static void store(LogRecord &, LogArgument &argument, const glm::vec3 &value) {
+		argument.kind = LogArgument::VEC3;
+		argument.v[0] = value.x;
+		argument.v[1] = value.y;
+		argument.v[2] = value.z;
+	}
+	static void store(LogRecord &record, LogArgument &argument, const string &value) { storeText(record, argument, value.c_str(), value.size()); }
+	static void store(LogRecord &record, LogArgument &argument, const char *value) { storeText(record, argument, value ? value : "(null)", value ? strlen(value) : 6); }
+	static void store(LogRecord &record, LogArgument &argument, char *value) { store(record, argument, (const char *)value); }
+
+	// strings may not outlive the call, so they're copied (and truncated) into the record
+	static void storeText(LogRecord &record, LogArgument &argument, const char *value, size_t length) {
+		size_t available = LOG_TEXT_CAPACITY - record.textUsed;
+		if (length > available) {
+			length = available;
+		}
+		memcpy(record.text + record.textUsed, value, length);
+		argument.kind = LogArgument::TEXT;
+		argument.text.offset = record.textUsed;
+		argument.text.length = length;
+		record.textUsed += length;
+	}
+
+	void format(const LogRecord &record) {
+		static const char *levelNames[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+		static const char *categoryNames[] = { "game", "render", "shader", "assets", "input" };
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), "[%8.3f] %-5s %-6s ", record.time / 1000000.0, levelNames[record.level], categoryNames[record.category]);
+		line.assign(buffer);
+		int argument = 0;
+		for (const char *c = record.format; *c; c++) {
+			if (c[0] == '{' && c[1] == '}' && argument < record.argumentCount) {
+				append(record, record.arguments[argument++]);
+				c++;
+			}
+			else {
+				line.push_back(*c);
+			}
+		}
+		line.push_back('\n');
+		fwrite(line.data(), 1, line.size(), stdout);
+	}
+
+	void append(const LogRecord &record, const LogArgument &argument) {
+		char buffer[96];
+		switch (argument.kind) {
+		case LogArgument::INT: snprintf(buffer, sizeof(buffer), "%lld", argument.i); break;
+		case LogArgument::UINT: snprintf(buffer, sizeof(buffer), "%llu", argument.u); break;
+		case LogArgument::DOUBLE: snprintf(buffer, sizeof(buffer), "%g", argument.d); break;
+		case LogArgument::BOOL: snprintf(buffer, sizeof(buffer), "%s", argument.u ? "true" : "false"); break;
+		case LogArgument::VEC3: snprintf(buffer, sizeof(buffer), "(%g, %g, %g)", argument.v[0], argument.v[1], argument.v[2]); break;
+		case LogArgument::TEXT:
+			line.append(record.text + argument.text.offset, argument.text.length);
+			return;
+		}
+		line.append(buffer);
+	}
+
+	bool drain() {
+		bool any = false;
+		for (;;) {
+			Slot *slot = &slots[dequeuePosition & (LOG_QUEUE_SIZE - 1)];
+			if (slot->sequence.load(memory_order_acquire) != dequeuePosition + 1) {
+				break;
+			}
+			format(slot->record);
+			slot->sequence.store(dequeuePosition + LOG_QUEUE_SIZE, memory_order_release);
+			dequeuePosition++;
+			any = true;
+		}
+		unsigned int lost = dropped.exchange(0, memory_order_relaxed);
+		if (lost > 0) {
+			fprintf(stdout, "[logger] dropped %u records, queue full\n", lost);
+			any = true;
+		}
+		return any;
+	}
+
+	void writerLoop() {
+		while (running.load(memory_order_acquire)) {
+			if (drain()) {
+				fflush(stdout);
+			}
+			else {
+				this_thread::sleep_for(chrono::milliseconds(2));
+			}
+		}
+		drain();
+		fflush(stdout);
+	}
+
+public:
+	static Logger &instance() {
+		static Logger logger;
+		return logger;
+	}
+
+	void setLevel(LogLevel level) {
+		minLevel.store(level, memory_order_relaxed);
+	}
+
+	void setCategoryEnabled(LogCategory category, bool enabled) {
+		if (enabled) {
+			categoryMask.fetch_or(1u << category, memory_order_relaxed);
+		}
+		else {
+			categoryMask.fetch_and(~(1u << category), memory_order_relaxed);
+		}
+	}
+
+	bool isEnabled(LogLevel level, LogCategory category) const {
+		return level >= minLevel.load(memory_order_relaxed) && (categoryMask.load(memory_order_relaxed) & (1u << category));
+	}
+
+	// text longer than a record holds (shader info logs) goes out as several records, split at line
+	// ends where possible; records from one thread keep their order
+	void writeText(LogLevel level, LogCategory category, const string &text) {
+		size_t at = 0;
+		do {
+			size_t length = min(text.size() - at, (size_t)LOG_TEXT_CAPACITY);
+			if (at + length < text.size()) {
+				size_t lineEnd = text.rfind('\n', at + length - 1);
+				if (lineEnd != string::npos && lineEnd >= at) {
+					length = lineEnd - at + 1;
+				}
+			}
+			size_t end = at + length;
+			// the line end is the record's own
+			if (length > 0 && text[end - 1] == '\n') {
+				length--;
+			}
+			write(level, category, "{}", text.substr(at, length));
+			at = end;
+		} while (at < text.size());
+	}
+
+	template<typename... Args>
+	void write(LogLevel level, LogCategory category, const char *format, const Args&... args) {
+		if (!isEnabled(level, category)) {
+			return;
+		}
+		size_t position;
+		Slot *slot = claim(position);
+		if (slot == nullptr) {
+			dropped.fetch_add(1, memory_order_relaxed);
+			return;
+		}
+		LogRecord &record = slot->record;
+		record.time = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+		record.level = level;
+		record.category = category;
+		record.format = format;
+		record.argumentCount = 0;
+		record.textUsed = 0;
+		capture(record, args...);
+		slot->sequence.store(position + 1, memory_order_release);
+	}
+};
+
+inline void logText(LogLevel level, LogCategory category, const string &text) {
+	Logger::instance().writeText(level, category, text);
+}
+
+template<typename... Args>
+void logDebug(LogCategory category, const char *format, const Args&... args) {
+	Logger::instance().write(LEVEL_DEBUG, category, format, args...);
+}
+
+template<typename... Args>
+void logInfo(LogCategory category, const char *format, const Args&... args) {
+	Logger::instance().write(LEVEL_INFO, category, format, args...);
+}
+
+template<typename... Args>
+void logWarning(LogCategory category, const char *format, const Args&... args) {
+	Logger::instance().write(LEVEL_WARNING, category, format, args...);
+}
+
+template<typename... Args>
+void logError(LogCategory category, const char *format, const Args&... args) {
+	Logger::instance().write(LEVEL_ERROR, category, format, args...);
+}
+#endif
@@ -24,6 +24,14 @@
 #include "game.h"
 #include "camera.h"
 #include "asteroida.h"
+#include "logger.h"
+#include "uniformBuffers.h"
+#include "glState.h"
+#include "shaderVariants.h"
+#include "glResource.h"
+#include "assetRegistry.h"
+#include "asyncLoader.h"
+#include "vfs.h"
 
 // About OpenGL function loaders: modern OpenGL doesn't have a standard header file and requires individual function pointers to be loaded manually. 
 // Helper libraries are often used for this purpose! Here we are supporting a few common ones: gl3w, glew, glad.
@@ -61,15 +69,24 @@ bool shoot = false;
 bool changeMenuOptionDown=false, changeMenuOptionUp=false;
 bool selectMenuOption=false, selectMenu = false;
 float selectMenuOptionCooldown = 0.5f, selectMenuCooldown = 0.5f;
+bool toggleAsteroidBatching = false;
+float toggleAsteroidBatchingCooldown = 0.5f;
+bool toggleLevelsOfDetail = false;
+float toggleLevelsOfDetailCooldown = 0.5f;
 
 // timing
 float deltaTime = 0.0f;	// time between current frame and last frame
 float lastFrame = 0.0f;
 
 std::map<GLchar, Character> Characters;
-GLuint VAO, VBO;
+GLVertexArray VAO;
+GLBuffer VBO;
 
-unsigned int planeVAO;
+GLVertexArray planeVAO;
+GLBuffer planeVBO;
+// created on first use by renderCube()/renderQuad()
+GLVertexArray cubeVAO, quadVAO;
+GLBuffer cubeVBO, quadVBO;
 
 void RenderText(Shader &shader, std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color);
 void renderScene(const Shader &shader);
@@ -109,6 +126,16 @@ void processInput(GLFWwindow *window)
 		selectMenuOption = true;
 		selectMenuOptionCooldown = 0.5f;
 	}
+
+	if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS && toggleAsteroidBatchingCooldown <= 0.0f) {
+		toggleAsteroidBatching = true;
+		toggleAsteroidBatchingCooldown = 0.5f;
+	}
+
+	if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS && toggleLevelsOfDetailCooldown <= 0.0f) {
+		toggleLevelsOfDetail = true;
+		toggleLevelsOfDetailCooldown = 0.5f;
+	}
 		
 
 }
@@ -150,90 +177,15 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 	camera.ProcessMouseScroll(yoffset);
 }
 
-// utility function for loading a 2D texture from file
-// ---------------------------------------------------
-unsigned int loadTexture(char const * path)
-{
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height, nrComponents;
-	unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-	if (data)
-	{
-		GLenum format;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-	}
-
-	return textureID;
-}
-
-// loads a cubemap texture from 6 individual texture faces
-// order:
-// +X (right)
-// -X (left)
-// +Y (top)
-// -Y (bottom)
-// +Z (front) 
-// -Z (back)
-// -------------------------------------------------------
-unsigned int loadCubemap(vector<std::string> faces)
-{
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-	int width, height, nrChannels;
-	for (unsigned int i = 0; i < faces.size(); i++)
-	{
-		unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-		if (data)
-		{
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-			stbi_image_free(data);
-		}
-		else
-		{
-			std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-			stbi_image_free(data);
-		}
-	}
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-	return textureID;
-}
-
 int main(int, char**)
 {
 	glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
 	glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
 	glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 
+	// a packed game maps every asset at once (asteroids-cook --pack), otherwise the files under res/ are read
+	vfs().mount("assets.pak");
+
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -245,7 +197,7 @@ int main(int, char**)
 
 	if (window == nullptr)
 	{
-		std::cout << "Failed to create GLFW window" << std::endl;
+		logError(CATEGORY_RENDER, "Failed to create GLFW window");
 		glfwTerminate();
 		return -1;
 	}
@@ -260,39 +212,47 @@ int main(int, char**)
 
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
 	{
-		std::cout << "Failed to initialize GLAD" << std::endl;
+		logError(CATEGORY_RENDER, "Failed to initialize GLAD");
 		return -1;
 	}
 
 	// configure global opengl state
 	// -----------------------------
-	glEnable(GL_DEPTH_TEST);
+	glState().setEnabled(GL_DEPTH_TEST, true);
 
 	// build and compile shaders
 	// -------------------------
-	Shader shadowMapping("..\\..\\src\\shadowMapping.vs", "..\\..\\src\\shadowMapping.fs");
-	Shader simpleDepthShader("..\\..\\src\\shadowMappingDepth.vs", "..\\..\\src\\shadowMappingDepth.fs");
-	Shader debugDepthQuad("..\\..\\src\\debugQuad.vs", "..\\..\\src\\debugQuad.fs");	
+	Shader shadowMapping("res/shaders/shadowMapping.vs", "res/shaders/shadowMapping.fs");
+	Shader simpleDepthShader("res/shaders/shadowMappingDepth.vs", "res/shaders/shadowMappingDepth.fs");
+	Shader debugDepthQuad("res/shaders/debugQuad.vs", "res/shaders/debugQuad.fs");	
 	
 	// Set OpenGL options
-	glEnable(GL_CULL_FACE);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	Shader lightingShader("..\\..\\src\\materialModel.vs", "..\\..\\src\\materialModel.fs");
-	Shader lampShader("..\\..\\src\\light.vs", "..\\..\\src\\light.fs");
-	Shader skyboxShader("..\\..\\src\\skybox.vs", "..\\..\\src\\skybox.fs");
-	Shader reflexShader("..\\..\\src\\materialReflex.vs", "..\\..\\src\\materialReflex.fs");
-	Shader refractShader("..\\..\\src\\materialReflex.vs", "..\\..\\src\\materialRefract.fs");
-	Shader bulletShader("..\\..\\src\\materialReflex.vs", "..\\..\\src\\bullet.fs");
+	glState().setEnabled(GL_CULL_FACE, true);
+	glState().setEnabled(GL_BLEND, true);
+	glState().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// material programs are variants of two sources, picked by feature flags
+	ShaderVariants shaderVariants;
+	Shader &lightingShader = *shaderVariants.get("res/shaders/materialModel.vs", "res/shaders/materialModel.fs", SHADER_SPOT_LIGHT);
+	Shader lampShader("res/shaders/light.vs", "res/shaders/light.fs");
+	Shader skyboxShader("res/shaders/skybox.vs", "res/shaders/skybox.fs");
+	Shader &reflexShader = *shaderVariants.get("res/shaders/materialReflex.vs", "res/shaders/materialReflex.fs", SHADER_REFLECT);
+	Shader &refractShader = *shaderVariants.get("res/shaders/materialReflex.vs", "res/shaders/materialReflex.fs", SHADER_REFRACT);
+	Shader &bulletShader = *shaderVariants.get("res/shaders/materialReflex.vs", "res/shaders/materialReflex.fs", SHADER_FLAT);
+	Shader &debrisShader = *shaderVariants.get("res/shaders/materialModel.vs", "res/shaders/materialModel.fs", SHADER_INSTANCED | SHADER_SPOT_LIGHT);
+	Shader &asteroidShader = *shaderVariants.get("res/shaders/materialModel.vs", "res/shaders/materialModel.fs", SHADER_INSTANCED | SHADER_SPOT_LIGHT | SHADER_UBER_ASTEROID);
+
+	// camera, light and material constants live in uniform buffers shared by all programs above
+	UniformBuffer<FrameUniforms> frameUniforms(FRAME_BLOCK_BINDING);
+	UniformBuffer<LightUniforms> lightUniforms(LIGHTS_BLOCK_BINDING);
+	UniformBuffer<MaterialUniforms> materialUniforms(MATERIAL_BLOCK_BINDING);
 
 	const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
-	unsigned int depthMapFBO;
-	glGenFramebuffers(1, &depthMapFBO);
+	GLFramebuffer depthMapFBO = GLFramebuffer::create();
 	// create depth texture
-	unsigned int depthMap;
-	glGenTextures(1, &depthMap);
-	glBindTexture(GL_TEXTURE_2D, depthMap);
+	GLTexture depthMap = GLTexture::create();
+	glState().bindTexture(0, GL_TEXTURE_2D, depthMap);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	depthMap.setSize(textureBytes(SHADOW_WIDTH, SHADOW_HEIGHT, 4, false));
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -308,41 +268,41 @@ int main(int, char**)
 	///TEXT
 
 	// Compile and setup the shader
-	Shader shader("..\\..\\src\\text.vs", "..\\..\\src\\text.fs");
+	Shader shader("res/shaders/text.vs", "res/shaders/text.fs");
 	glm::mat4 textProjection = glm::ortho(0.0f, static_cast<GLfloat>(SCREEN_WIDTH), 0.0f, static_cast<GLfloat>(SCREEN_HEIGHT));
 	shader.use();
-	glUniformMatrix4fv(glGetUniformLocation(shader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(textProjection));
+	shader.setMat4("projection", textProjection);
 
 	// FreeType
 	FT_Library ft;
 	// All functions return a value different than 0 whenever an error occurred
 	if (FT_Init_FreeType(&ft))
-		std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+		logError(CATEGORY_RENDER, "ERROR::FREETYPE: Could not init FreeType Library");
 
 	// Load font as face
 	FT_Face face;
 	if (FT_New_Face(ft, "C:\\Windows\\Fonts\\arial.ttf", 0, &face))
-		std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+		logError(CATEGORY_RENDER, "ERROR::FREETYPE: Failed to load font");
 
 	// Set size to load glyphs as
 	FT_Set_Pixel_Sizes(face, 0, 48);
 
 	// Disable byte-alignment restriction
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	GLint alignment = glState().unpackAlignment(1);
 
 	// Load first 128 characters of ASCII set
+	vector<GLTexture> glyphTextures; // Characters only keeps the names
 	for (GLubyte c = 0; c < 128; c++)
 	{
 		// Load character glyph 
 		if (FT_Load_Char(face, c, FT_LOAD_RENDER))
 		{
-			std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
+			logError(CATEGORY_RENDER, "ERROR::FREETYTPE: Failed to load Glyph");
 			continue;
 		}
 		// Generate texture
-		GLuint texture;
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
+		GLTexture texture = GLTexture::create();
+		glState().bindTexture(0, GL_TEXTURE_2D, texture);
 		glTexImage2D(
 			GL_TEXTURE_2D,
 			0,
@@ -359,6 +319,7 @@ int main(int, char**)
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		texture.setSize(textureBytes(face->glyph->bitmap.width, face->glyph->bitmap.rows, 1, false));
 		// Now store character for later use
 		Character character = {
 			texture,
@@ -367,23 +328,26 @@ int main(int, char**)
 			face->glyph->advance.x
 		};
 		Characters.insert(std::pair<GLchar, Character>(c, character));
+		glyphTextures.push_back(std::move(texture));
 	}
-	glBindTexture(GL_TEXTURE_2D, 0);
+	glState().unpackAlignment(alignment);
+	glState().bindTexture(0, GL_TEXTURE_2D, 0);
 	// Destroy FreeType once we're finished
 	FT_Done_Face(face);
 	FT_Done_FreeType(ft);
 
 
 	// Configure VAO/VBO for texture quads
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	VAO = GLVertexArray::create();
+	VBO = GLBuffer::create();
+	glState().bindVertexArray(VAO);
+	glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+	VBO.setSize(sizeof(GLfloat) * 6 * 4);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	glState().bindBuffer(GL_ARRAY_BUFFER, 0);
+	glState().bindVertexArray(0);
 
 
 
@@ -399,9 +363,9 @@ int main(int, char**)
 
 	glClearColor(0.338f, 0.257f, 0.273f, 1.0f);
 
-	glEnable(GL_DEPTH_TEST);
+	glState().setEnabled(GL_DEPTH_TEST, true);
 	// Accept fragment if it closer to the camera than the former one
-	glDepthFunc(GL_LESS);
+	glState().depthFunc(GL_LESS);
 
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
@@ -432,40 +396,21 @@ int main(int, char**)
 	};
 
 	// plane VAO
-	unsigned int planeVBO;
-	glGenVertexArrays(1, &planeVAO);
-	glGenBuffers(1, &planeVBO);
-	glBindVertexArray(planeVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
+	planeVBO = GLBuffer::create();
+	planeVAO = GLVertexArray::create();
+	glState().bindVertexArray(planeVAO);
+	glState().bindBuffer(GL_ARRAY_BUFFER, planeVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), planeVertices, GL_STATIC_DRAW);
+	planeVBO.setSize(sizeof(planeVertices));
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(1);
 	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
 	glEnableVertexAttribArray(2);
 	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glBindVertexArray(0);
-
-	unsigned int woodTexture = loadTexture("..\\..\\res\\textures\\stone.jpg");
-
-	// configure depth map FBO
-	// -----------------------
-	glGenFramebuffers(1, &depthMapFBO);
-	// create depth texture
-	glGenTextures(1, &depthMap);
-	glBindTexture(GL_TEXTURE_2D, depthMap);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// attach depth texture as FBO's depth buffer
-	glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
-	glDrawBuffer(GL_NONE);
-	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glState().bindVertexArray(0);
 
+	shared_ptr<GLTexture> woodTexture = assets().texture("res/textures/stone.jpg");
 
 	// shader configuration
 	// --------------------
@@ -523,31 +468,32 @@ int main(int, char**)
 	};		
 
 	//SKYBOX
-	unsigned int skyboxVAO, skyboxVBO;
-	glGenVertexArrays(1, &skyboxVAO);
-	glGenBuffers(1, &skyboxVBO);
-	glBindVertexArray(skyboxVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+	GLVertexArray skyboxVAO = GLVertexArray::create();
+	GLBuffer skyboxVBO = GLBuffer::create();
+	glState().bindVertexArray(skyboxVAO);
+	glState().bindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+	skyboxVBO.setSize(sizeof(skyboxVertices));
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 
 	vector<std::string> faces
 	{
-		"..\\..\\res\\textures\\skybox\\right.jpg",
-		"..\\..\\res\\textures\\skybox\\left.jpg",
-		"..\\..\\res\\textures\\skybox\\top.jpg",
-		"..\\..\\res\\textures\\skybox\\bottom.jpg",
-		"..\\..\\res\\textures\\skybox\\front.jpg",
-		"..\\..\\res\\textures\\skybox\\back.jpg"
+		"res/textures/skybox/right.jpg",
+		"res/textures/skybox/left.jpg",
+		"res/textures/skybox/top.jpg",
+		"res/textures/skybox/bottom.jpg",
+		"res/textures/skybox/front.jpg",
+		"res/textures/skybox/back.jpg"
 	};
-	unsigned int cubemapTexture = loadCubemap(faces);
+	shared_ptr<GLTexture> cubemapTexture = assets().cubemap(faces);
+
+	// programs were compiling in the background while the textures loaded
+	Shader::finishPending();
 
 	//LIGHTS
 
-	skyboxShader.use();
-	skyboxShader.setInt("skybox", 0);
-	Model *drawModel = new Model("res/models/asteroid/asteroid.obj");
+	shared_ptr<Model> drawModel = assets().model("res/models/asteroid/asteroid.obj");
 	//"Normal" model
 	/*glm::mat4 localTransform(1);
 	localTransform = glm::scale(localTransform, glm::vec3(0.02f, 0.02f, 0.02f));
@@ -564,36 +510,29 @@ int main(int, char**)
 	localTransform = glm::scale(localTransform, glm::vec3(0.015f, 0.015f, 0.015f));
 
 	Asteroida *asteroid;
-	asteroid = new Asteroida(drawModel, lightingShader.ID, 0.0f, localTransform,
+	asteroid = new Asteroida(drawModel.get(), lightingShader.ID, 0.0f, localTransform,
 		glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), asteroid->REFLEX);
 
 	localTransform = glm::mat4(1);
 	localTransform = glm::translate(model, glm::vec3(2.0f, 0.0f, 1.0));
 	localTransform = glm::scale(localTransform, glm::vec3(0.015f, 0.015f, 0.015f));
 	Asteroida *asteroid2;
-	asteroid2 = new Asteroida(drawModel, lightingShader.ID, 0.0f, localTransform,
+	asteroid2 = new Asteroida(drawModel.get(), lightingShader.ID, 0.0f, localTransform,
 		glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), asteroid->REFLEX);
 
 	localTransform = glm::mat4(1);
 	localTransform = glm::translate(model, glm::vec3(-1.0f, 0.0f, 2.0));
 	localTransform = glm::scale(localTransform, glm::vec3(0.015f, 0.015f, 0.015f));
 	Asteroida *asteroid3;
-	asteroid3 = new Asteroida(drawModel, lightingShader.ID, 0.0f, localTransform,
+	asteroid3 = new Asteroida(drawModel.get(), lightingShader.ID, 0.0f, localTransform,
 		glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), asteroid->REFLEX);
 
 		
 
-	Scene *scene = new Scene(lightingShader.ID, reflexShader.ID, refractShader.ID, 2.0f, 0.5f);
-	scene->generateAsteroids(20, glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f), 150.0f, 180.0f);
-
-	Game *game = new Game(&shader, lightingShader.ID, reflexShader.ID, refractShader.ID,bulletShader.ID, SCREEN_WIDTH, SCREEN_HEIGHT, &VAO, &VBO, &Characters);
+	Game *game = new Game(&shader, lightingShader.ID, reflexShader.ID, refractShader.ID,bulletShader.ID, debrisShader.ID, asteroidShader.ID, SCREEN_WIDTH, SCREEN_HEIGHT, &VAO, &VBO, &Characters);
 	game->initialize();
+	glResources().report("after startup");
 
-	lightingShader.use();
-	lightingShader.setInt("shadowMap", 1);
-		
-	reflexShader.use();
-	reflexShader.setInt("skybox", 0);
 
 
 
@@ -610,7 +549,8 @@ int main(int, char**)
 	static float spotlightColor2[3] = { 1.0f,1.0f,1.0f };
 	glm::vec3 directionVector(-0.2f, -1.0f, -0.3f);
 
-	glDisable(GL_CULL_FACE);
+	glState().setEnabled(GL_CULL_FACE, false);
+	float stateStatsTime = 0.0f;
 	while (!glfwWindowShouldClose(window))
 	{
 		// per-frame time logic
@@ -619,11 +559,22 @@ int main(int, char**)
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
+		// how many state changes the cache saved, once a second
+		stateStatsTime += deltaTime;
+		if (stateStatsTime >= 1.0f) {
+			logDebug(CATEGORY_RENDER, "gl state: {} calls issued, {} skipped", glState().getIssuedCount(), glState().getSkippedCount());
+			glState().resetCounters();
+			stateStatsTime = 0.0f;
+		}
+
 		// input
 		// -----
 		processInput(window);
 		glfwPollEvents();
 
+		// textures loading in the background that are ready now
+		asyncLoader().update();
+
 		if (shoot == true) {
 			shoot = false;
 			game->shoot(camera.Position, camera.Front);
@@ -634,6 +585,16 @@ int main(int, char**)
 			game->changeMenuOptionDown();
 		}
 
+		if (toggleAsteroidBatching) {
+			toggleAsteroidBatching = false;
+			game->toggleAsteroidBatching();
+		}
+
+		if (toggleLevelsOfDetail) {
+			toggleLevelsOfDetail = false;
+			lodSelector().setEnabled(!lodSelector().isEnabled());
+		}
+
 		if (changeMenuOptionUp) {
 			changeMenuOptionUp = false;
 			game->changeMenuOptionUp();
@@ -647,8 +608,8 @@ int main(int, char**)
 				game->selectMenuOption();
 			}
 			else if (game->getGameState() == game->NEXT_LEVEL) {
+				// the next level has been prewarming since its screen came up, this only swaps it in
 				game->loadNextLevel();
-				cubemapTexture = loadCubemap(game->getSkyboxFaces());
 			}
 			
 		}
@@ -659,7 +620,7 @@ int main(int, char**)
 
 		if (selectMenu) {
 			selectMenu = false;
-			cout << "ESCAPE" << endl;
+			logDebug(CATEGORY_INPUT, "ESCAPE");
 			if (game->getGameState() == game->MENU_RUNNING) {
 				game->setGameState(game->RUNNING);
 			}else if (game->getGameState() == game->RUNNING){
@@ -673,6 +634,12 @@ int main(int, char**)
 		if (selectMenuCooldown > 0.0f) {
 			selectMenuCooldown -= deltaTime;
 		}
+		if (toggleAsteroidBatchingCooldown > 0.0f) {
+			toggleAsteroidBatchingCooldown -= deltaTime;
+		}
+		if (toggleLevelsOfDetailCooldown > 0.0f) {
+			toggleLevelsOfDetailCooldown -= deltaTime;
+		}
 
 				
 		//SHADOWS
@@ -731,30 +698,26 @@ int main(int, char**)
 		//SHADOWS
 		
 		
-		lightingShader.use();
-		lightingShader.setVec3("viewPos", camera.Position);
-		lightingShader.setFloat("material.shininess", 32.0f);
-		lightingShader.setVec3("material.ambient", 0.2f,0.2f,0.2f);
-		//lightingShader.setInt("texture_diffuse1", 0);
-		lightingShader.setVec3("material.specular", 0.633, 0.727811, 0.633);	
-
-		// light properties
-		glm::vec3 lightColor = glm::vec3(1.0f,1.0f,1.0f);
-
-		glm::vec3 diffuseColor = lightColor * glm::vec3(0.5f); // decrease the influence
-		glm::vec3 ambientColor = diffuseColor * glm::vec3(0.2f); // low influence
-		
-		lightingShader.setVec3("spotLight.diffuse", spotlightColor1[0] *  1.0f, spotlightColor1[1] * 1.0f, spotlightColor1[2] * 1.0f);
-		lightingShader.setVec3("spotLight.specular", spotlightColor1[0] * 1.0f, spotlightColor1[1] * 1.0f, spotlightColor1[2] *1.0f);		
-		
-		lightingShader.setVec3("spotLight.position", camera.Position);
-		lightingShader.setVec3("spotLight.direction", camera.Front);
-		lightingShader.setVec3("spotLight.ambient", 0.1f, 0.1f, 0.1f);	
-		lightingShader.setFloat("spotLight.constant", 1.0f);
-		lightingShader.setFloat("spotLight.linear", 0.09);
-		lightingShader.setFloat("spotLight.quadratic", 0.032);
-		lightingShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-		lightingShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
+		// buffers are only rewritten when their contents change, the material never does after the first frame
+		MaterialUniforms material;
+		material.ambient = glm::vec3(0.2f, 0.2f, 0.2f);
+		material.shininess = 32.0f;
+		material.specular = glm::vec3(0.633f, 0.727811f, 0.633f);
+		material.padding = 0.0f;
+		materialUniforms.update(material);
+
+		LightUniforms lights;
+		lights.spotLight.position = camera.Position;
+		lights.spotLight.direction = camera.Front;
+		lights.spotLight.ambient = glm::vec3(0.1f, 0.1f, 0.1f);
+		lights.spotLight.diffuse = glm::vec3(spotlightColor1[0], spotlightColor1[1], spotlightColor1[2]);
+		lights.spotLight.specular = glm::vec3(spotlightColor1[0], spotlightColor1[1], spotlightColor1[2]);
+		lights.spotLight.constant = 1.0f;
+		lights.spotLight.linear = 0.09f;
+		lights.spotLight.quadratic = 0.032f;
+		lights.spotLight.cutOff = glm::cos(glm::radians(12.5f));
+		lights.spotLight.outerCutOff = glm::cos(glm::radians(15.0f));
+		lightUniforms.update(lights);
 
 		/*lightingShader.setVec3("dirLight.diffuse", spotlightColor1[0] * 1.0f, spotlightColor1[1] * 1.0f, spotlightColor1[2] * 1.0f);
 		lightingShader.setVec3("dirLight.specular", spotlightColor1[0] * 1.0f, spotlightColor1[1] * 1.0f, spotlightColor1[2] * 1.0f);
@@ -779,46 +742,37 @@ int main(int, char**)
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 		
 		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
+		lodSelector().setProjection(glm::radians(camera.Zoom), SCREEN_HEIGHT);
 		glm::mat4 view = camera.GetViewMatrix();
 		model = glm::mat4(1);
 		model = glm::scale(model, glm::vec3(0.006f, 0.006f, 0.006f));
-		lightingShader.setMat4("projection", projection);
-		lightingShader.setMat4("view", view);
-		lightingShader.setVec3("cameraPos", camera.Position);
-		
-		// reflex model
-		reflexShader.use();
-		
-		reflexShader.setMat4("view", view);
-		reflexShader.setMat4("projection", projection);
-		reflexShader.setVec3("cameraPos", camera.Position);
-
-		//refract model
-		refractShader.use();
-		refractShader.setMat4("view", view);
-		refractShader.setMat4("projection", projection);
-		refractShader.setVec3("cameraPos", camera.Position);
-
-		bulletShader.use();
-		bulletShader.setMat4("view", view);
-		bulletShader.setMat4("projection", projection);
-						
+		FrameUniforms frame;
+		frame.view = view;
+		frame.projection = projection;
+		frame.cameraPos = camera.Position;
+		frame.padding = 0.0f;
+		frameUniforms.update(frame);
 
 		// draw skybox as last
-		glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+		glState().depthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
 		skyboxShader.use();
-		view = glm::mat4(glm::mat3(camera.GetViewMatrix())); // remove translation from the view matrix
-		skyboxShader.setMat4("view", view);
-		skyboxShader.setMat4("projection", projection);
 		// skybox cube
-		glBindVertexArray(skyboxVAO);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+		glState().bindVertexArray(skyboxVAO);
+		glState().bindTexture(SKYBOX_TEXTURE_UNIT, GL_TEXTURE_CUBE_MAP, *cubemapTexture); // stays bound for the reflective asteroids
 		glDrawArrays(GL_TRIANGLES, 0, 36);
-		glBindVertexArray(0);
-		glDepthFunc(GL_LESS); // set depth function back to default
+		glState().depthFunc(GL_LESS); // set depth function back to default
 
 		game->play(deltaTime, camera.Position);
+
+		// a level switch brings its own skybox; then the previous level's skybox and anything else
+		// the new level doesn't use can go
+		shared_ptr<GLTexture> levelSkybox = game->getSkybox();
+		if (levelSkybox && levelSkybox != cubemapTexture) {
+			cubemapTexture = levelSkybox;
+			assets().unloadUnused();
+			FractureCache::collect();
+			glResources().report("after level load");
+		}
 							  //scene->update(deltaTime);
 
 		
@@ -840,7 +794,7 @@ int main(int, char**)
 		
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, woodTexture);
-		glActiveTexture(GL_TEXTURE1);
+		glActiveTexture(GL_TEXTURE0 + SHADOW_MAP_TEXTURE_UNIT);
 		glBindTexture(GL_TEXTURE_2D, depthMap);		
 		renderScene(shadowMapping);
 		asteroid->setShader(lightingShader.ID);
@@ -866,6 +820,18 @@ int main(int, char**)
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
 
+	// the file scope handles outlive main, they go while the context is still there
+	VAO.reset();
+	VBO.reset();
+	planeVAO.reset();
+	planeVBO.reset();
+	cubeVAO.reset();
+	cubeVBO.reset();
+	quadVAO.reset();
+	quadVBO.reset();
+
+	asyncLoader().shutdown();
+	glResources().shutdown();
 	glfwTerminate();
 	return 0;
 }
@@ -874,9 +840,10 @@ void RenderText(Shader &shader, std::string text, GLfloat x, GLfloat y, GLfloat
 {
 	// Activate corresponding render state	
 	shader.use();
-	glUniform3f(glGetUniformLocation(shader.ID, "textColor"), color.x, color.y, color.z);
-	glActiveTexture(GL_TEXTURE0);
-	glBindVertexArray(VAO);
+	shader.setVec3("textColor", color);
+	glState().activeTexture(0);
+	glState().bindVertexArray(VAO);
+	glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
 
 	// Iterate through all characters
 	std::string::const_iterator c;
@@ -900,27 +867,21 @@ void RenderText(Shader &shader, std::string text, GLfloat x, GLfloat y, GLfloat
 		{ xpos + w, ypos + h,   1.0, 0.0 }
 		};
 		// Render glyph texture over quad
-		glBindTexture(GL_TEXTURE_2D, ch.TextureID);
+		glState().bindTexture(0, GL_TEXTURE_2D, ch.TextureID);
 		// Update content of VBO memory
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
 		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // Be sure to use glBufferSubData and not glBufferData
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		// Render quad
 		glDrawArrays(GL_TRIANGLES, 0, 6);
 		// Now advance cursors for next glyph (note that advance is number of 1/64 pixels)
 		x += (ch.Advance >> 6) * scale; // Bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
 	}
-	glBindVertexArray(0);
-	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 
 
 // renderCube() renders a 1x1 3D cube in NDC.
 // -------------------------------------------------
-unsigned int cubeVAO = 0;
-unsigned int cubeVBO = 0;
 void renderCube()
 {
 	// initialize (if necessary)
@@ -970,26 +931,27 @@ void renderCube()
 			-1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
 			-1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f  // bottom-left        
 		};
-		glGenVertexArrays(1, &cubeVAO);
-		glGenBuffers(1, &cubeVBO);
+		cubeVAO = GLVertexArray::create();
+		cubeVBO = GLBuffer::create();
 		// fill buffer
-		glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+		glState().bindBuffer(GL_ARRAY_BUFFER, cubeVBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+		cubeVBO.setSize(sizeof(vertices));
 		// link vertex attributes
-		glBindVertexArray(cubeVAO);
+		glState().bindVertexArray(cubeVAO);
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(1);
 		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
 		glEnableVertexAttribArray(2);
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		glState().bindBuffer(GL_ARRAY_BUFFER, 0);
+		glState().bindVertexArray(0);
 	}
 	// render Cube
-	glBindVertexArray(cubeVAO);
+	glState().bindVertexArray(cubeVAO);
 	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
+	glState().bindVertexArray(0);
 }
 
 
@@ -999,7 +961,7 @@ void renderScene(const Shader &shader)
 	glm::mat4 model = glm::mat4(1.0f);
 	//model = glm::rotate(model, 3.14f, glm::vec3(1.0f, 0.0f, 0.0f));
 	shader.setMat4("model", model);
-	glBindVertexArray(planeVAO);
+	glState().bindVertexArray(planeVAO);
 	glDrawArrays(GL_TRIANGLES, 0, 6);
 	// cubes
 	/*model = glm::mat4(1.0f);
@@ -1022,8 +984,6 @@ void renderScene(const Shader &shader)
 
 // renderQuad() renders a 1x1 XY quad in NDC
 // -----------------------------------------
-unsigned int quadVAO = 0;
-unsigned int quadVBO;
 void renderQuad()
 {
 	if (quadVAO == 0)
@@ -1036,17 +996,18 @@ void renderQuad()
 			1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
 		};
 		// setup plane VAO
-		glGenVertexArrays(1, &quadVAO);
-		glGenBuffers(1, &quadVBO);
-		glBindVertexArray(quadVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+		quadVAO = GLVertexArray::create();
+		quadVBO = GLBuffer::create();
+		glState().bindVertexArray(quadVAO);
+		glState().bindBuffer(GL_ARRAY_BUFFER, quadVBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+		quadVBO.setSize(sizeof(quadVertices));
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(1);
 		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 	}
-	glBindVertexArray(quadVAO);
+	glState().bindVertexArray(quadVAO);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-	glBindVertexArray(0);
+	glState().bindVertexArray(0);
 }
\ No newline at end of file
@@ -0,0 +1,145 @@
+#pragma once
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+// Read-only view of a whole file mapped into memory. The OS pages it in on first touch, so
+// handing a range of it to glBufferData reads the file straight into the upload. An empty file
+// can't be mapped, it opens as a valid view of no bytes.
+class MappedFile {
+private:
+	const unsigned char *data;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+
+	MappedFile(const MappedFile &other);
+	MappedFile &operator=(const MappedFile &other);
+
+	static const unsigned char *emptyView() {
+		static const unsigned char empty = 0;
+		return &empty;
+	}
+
+public:
+	MappedFile() {
+		data = NULL;
+		size = 0;
+#ifdef _WIN32
+		file = INVALID_HANDLE_VALUE;
+		mapping = NULL;
+#endif
+	}
+
+	~MappedFile() {
+		close();
+	}
+
+	bool open(const string &path) {
+		close();
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize)) {
+			close();
+			return false;
+		}
+		if (fileSize.QuadPart == 0) {
+			data = emptyView();
+			return true;
+		}
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) {
+			close();
+			return false;
+		}
+		data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (data == NULL) {
+			close();
+			return false;
+		}
+		size = (size_t)fileSize.QuadPart;
+#else
+		int descriptor = ::open(path.c_str(), O_RDONLY);
+		if (descriptor < 0) {
+			return false;
+		}
+		struct stat status;
+		if (fstat(descriptor, &status) != 0) {
+			::close(descriptor);
+			return false;
+		}
+		if (status.st_size == 0) {
+			::close(descriptor);
+			data = emptyView();
+			return true;
+		}
+		void *view = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		::close(descriptor); // the mapping keeps the file alive
+		if (view == MAP_FAILED) {
+			return false;
+		}
+		data = (const unsigned char*)view;
+		size = status.st_size;
+#endif
+		return true;
+	}
+
+	void close() {
+#ifdef _WIN32
+		if (data != NULL && size > 0) {
+			UnmapViewOfFile(data);
+		}
+		if (mapping != NULL) {
+			CloseHandle(mapping);
+		}
+		if (file != INVALID_HANDLE_VALUE) {
+			CloseHandle(file);
+		}
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (data != NULL && size > 0) {
+			munmap((void*)data, size);
+		}
+#endif
+		data = NULL;
+		size = 0;
+	}
+
+	bool isOpen() const {
+		return data != NULL;
+	}
+
+	const unsigned char *getData() const {
+		return data;
+	}
+
+	size_t getSize() const {
+		return size;
+	}
+};
+#endif
@@ -7,113 +7,216 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <vector>
+
+#include "shader.h"
+#include "glResource.h"
+#include "meshData.h"
 using namespace std;
 
-struct Vertex {
-	// position
-	glm::vec3 Position;
-	// normal
-	glm::vec3 Normal;
-	// texCoords
-	glm::vec2 TexCoords;
-	// tangent
-	glm::vec3 Tangent;
-	// bitangent
-	glm::vec3 Bitangent;
+// texture unit (index, not GL_TEXTUREi) and texture a mesh binds for every draw
+struct TextureBinding {
+	GLuint unit;
+	unsigned int id;
 };
 
-struct Texture {
-	unsigned int id;
-	string type;
-	string path;
+// one level of detail in a mesh's index buffer, level 0 being the full mesh
+struct MeshLodRange {
+	unsigned int first; // in indices
+	unsigned int count;
+	float error;        // how far the level may be from the full mesh, in model units
 };
 
+// owns its VAO and buffers, so a Mesh can be moved (into a vector) but not copied
 class Mesh {
 public:
 	/*  Mesh Data  */
 	vector<Vertex> vertices;
-	vector<unsigned int> indices;
+	vector<unsigned int> indices; // the full mesh only, the coarser levels live on the GPU
 	vector<Texture> textures;
-	unsigned int VAO;
+	vector<MeshLodRange> lodRanges;
+	GLVertexArray VAO;
+	CompactId sortId; // see meshIds()
 
 	/*  Functions  */
-	// constructor
-	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+	// constructor, the levels of detail (if any) share the vertices and follow the full mesh in the index buffer
+	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, const vector<MeshLod> &lods = vector<MeshLod>())
 	{
-		this->vertices = vertices;
-		this->indices = indices;
-		this->textures = textures;
+		this->vertices = std::move(vertices);
+		this->indices = std::move(indices);
+		this->textures = std::move(textures);
+		this->sortId = CompactId(meshIds());
+
+		addLodRange(this->indices.size(), 0.0f);
+		vector<unsigned int> levels;
+		if (!lods.empty())
+		{
+			levels = this->indices;
+			for (unsigned int i = 0; i < lods.size(); i++)
+			{
+				addLodRange(lods[i].indices.size(), lods[i].error);
+				levels.insert(levels.end(), lods[i].indices.begin(), lods[i].indices.end());
+			}
+			checkLodIndices(&levels[0], this->vertices.size());
+		}
+		const vector<unsigned int> &uploaded = lodRanges.size() > 1 ? levels : this->indices;
 
 		// now that we have all the required data, set the vertex buffers and its attribute pointers.
-		setupMesh();
+		setupMesh(this->vertices.empty() ? NULL : &this->vertices[0], this->vertices.size(),
+			uploaded.empty() ? NULL : &uploaded[0], uploaded.size());
+		resolveTextures();
 	}
 
-	// render the mesh
-	void Draw(GLuint shaderID)
+	// uploads straight from memory the caller owns (e.g. a mapped mesh cache), indexData holding the
+	// levels of detail back to back; the CPU copy of the full mesh is only kept if something needs
+	// the geometry later, like fracturing or picking
+	Mesh(const Vertex *vertexData, unsigned int vertexCount, const unsigned int *indexData, const vector<unsigned int> &lodIndexCounts, const vector<float> &lodErrors, vector<Texture> textures, bool keepGeometry)
 	{
-		// bind appropriate textures
-		unsigned int diffuseNr = 1;
-		unsigned int specularNr = 1;
-		unsigned int normalNr = 1;
-		unsigned int heightNr = 1;
-		for (unsigned int i = 0; i < textures.size(); i++)
+		for (unsigned int i = 0; i < lodIndexCounts.size(); i++)
+			addLodRange(lodIndexCounts[i], lodErrors[i]);
+		checkLodIndices(indexData, vertexCount);
+		if (keepGeometry)
 		{
-			glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-											  // retrieve texture number (the N in diffuse_textureN)
-			string number;
-			string name = textures[i].type;
-			if (name == "texture_diffuse")
-				number = std::to_string(diffuseNr++);
-			else if (name == "texture_specular")
-				number = std::to_string(specularNr++); // transfer unsigned int to stream
-			else if (name == "texture_normal")
-				number = std::to_string(normalNr++); // transfer unsigned int to stream
-			else if (name == "texture_height")
-				number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-													 // now set the sampler to the correct texture unit
-			glUniform1i(glGetUniformLocation(shaderID, (name + number).c_str()), i);
-			// and finally bind the texture
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
+			this->vertices.assign(vertexData, vertexData + vertexCount);
+			this->indices.assign(indexData, indexData + lodRanges[0].count);
 		}
+		this->textures = std::move(textures);
+		this->sortId = CompactId(meshIds());
+
+		setupMesh(vertexData, vertexCount, indexData, lodRanges.back().first + lodRanges.back().count);
+		resolveTextures();
+	}
+
+	// render the mesh, or one of its coarser levels
+	void Draw(GLuint shaderID, int lod = 0)
+	{
+		bindTextures();
+
+		// draw mesh, bindings are left in place so the next draw of the same mesh skips them
+		const MeshLodRange &range = lodRanges[min(lod, getLodCount() - 1)];
+		glState().bindVertexArray(VAO);
+		glDrawElements(GL_TRIANGLES, range.count, GL_UNSIGNED_INT, (void*)(range.first * sizeof(unsigned int)));
+	}
+
+	// render instanceCount copies, per-instance data has to be attached to the VAO beforehand (see InstanceBuffer);
+	// baseInstance is the first instance read, so one buffer can feed several draws
+	void DrawInstanced(GLuint shaderID, int instanceCount, int lod = 0, int baseInstance = 0)
+	{
+		bindTextures();
+
+		const MeshLodRange &range = lodRanges[min(lod, getLodCount() - 1)];
+		glState().bindVertexArray(VAO);
+		glDrawElementsInstancedBaseInstance(GL_TRIANGLES, range.count, GL_UNSIGNED_INT, (void*)(range.first * sizeof(unsigned int)), instanceCount, baseInstance);
+	}
+
+	int getLodCount() const
+	{
+		return lodRanges.size();
+	}
+
+	unsigned int getTriangleCount(int lod = 0) const
+	{
+		return lodRanges[min(lod, getLodCount() - 1)].count / 3;
+	}
 
-		// draw mesh
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
+	// drops the CPU copy, the GPU buffers are all drawing needs
+	void releaseGeometry()
+	{
+		vector<Vertex>().swap(vertices);
+		vector<unsigned int>().swap(indices);
+	}
 
-		// always good practice to set everything back to defaults once configured.
-		glActiveTexture(GL_TEXTURE0);
+	// texture the render queue groups draws by
+	GLuint getMaterialTexture() const
+	{
+		return textureBindings.empty() ? 0 : textureBindings[0].id;
 	}
 
 private:
 	/*  Render data  */
-	unsigned int VBO, EBO;
+	GLBuffer VBO, EBO;
+	vector<TextureBinding> textureBindings;
 
 	/*  Functions    */
+	void addLodRange(unsigned int count, float error)
+	{
+		MeshLodRange range;
+		range.first = lodRanges.empty() ? 0 : lodRanges.back().first + lodRanges.back().count;
+		range.count = count;
+		range.error = error;
+		lodRanges.push_back(range);
+	}
+
+	// every coarser level has to index the full mesh's vertices; one that doesn't would read past
+	// the vertex buffer, so the mesh loudly falls back to drawing only the full mesh
+	void checkLodIndices(const unsigned int *indexData, unsigned int vertexCount)
+	{
+		for (unsigned int l = 1; l < lodRanges.size(); l++)
+		{
+			for (unsigned int i = lodRanges[l].first; i < lodRanges[l].first + lodRanges[l].count; i++)
+			{
+				if (indexData[i] >= vertexCount)
+				{
+					logError(CATEGORY_ASSETS, "level of detail {} indexes vertex {} of {}, drawing the full mesh only", l, indexData[i], vertexCount);
+					lodRanges.resize(1);
+					return;
+				}
+			}
+		}
+	}
+
+	void bindTextures()
+	{
+		for (unsigned int i = 0; i < textureBindings.size(); i++)
+			glState().bindTexture(textureBindings[i].unit, GL_TEXTURE_2D, textureBindings[i].id);
+	}
+
+	// maps the N-th texture of a type to its unit from the convention in shader.h, once per mesh
+	void resolveTextures()
+	{
+		int typeCount[MATERIAL_TEXTURE_TYPE_COUNT] = { 0 };
+		for (unsigned int i = 0; i < textures.size(); i++)
+		{
+			int type = materialTextureType(textures[i].type);
+			if (type < 0)
+				continue;
+			if (typeCount[type] >= MATERIAL_TEXTURES_PER_TYPE)
+			{
+				logWarning(CATEGORY_ASSETS, "mesh has more than {} {} textures, {} is not bound", MATERIAL_TEXTURES_PER_TYPE, textures[i].type, textures[i].path);
+				continue;
+			}
+			TextureBinding binding;
+			binding.unit = type * MATERIAL_TEXTURES_PER_TYPE + typeCount[type]++;
+			binding.id = textures[i].id;
+			textureBindings.push_back(binding);
+		}
+	}
+
 	// initializes all the buffer objects/arrays
-	void setupMesh()
+	void setupMesh(const Vertex *vertexData, unsigned int vertexCount, const unsigned int *indexData, unsigned int indexCount)
 	{
 		// create buffers/arrays
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &VBO);
-		glGenBuffers(1, &EBO);
+		VAO = GLVertexArray::create();
+		VBO = GLBuffer::create();
+		EBO = GLBuffer::create();
 
-		glBindVertexArray(VAO);
+		glState().bindVertexArray(VAO);
 		// load data into vertex buffers
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
 		// A great thing about structs is that their memory layout is sequential for all its items.
 		// The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
 		// again translates to 3/2 floats which translates to a byte array.
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertexData, GL_STATIC_DRAW);
+		VBO.setSize(vertexCount * sizeof(Vertex));
 
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
+		EBO.setSize(indexCount * sizeof(unsigned int));
 
 		// set the vertex attribute pointers
 		// vertex Positions
@@ -132,7 +235,7 @@ private:
 		glEnableVertexAttribArray(4);
 		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
 
-		glBindVertexArray(0);
+		glState().bindVertexArray(0);
 	}
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,308 @@
+#pragma once
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <glm/glm.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include "meshData.h"
+#include "vfs.h"
+#include "assetPath.h"
+#include "contentHash.h"
+#include "logger.h"
+using namespace std;
+
+// Imported models saved as ready-to-upload blobs, one file per source model in meshcache/:
+//   header | mesh records | material references | 16-byte aligned vertex and index blobs
+// A mesh's index blob holds its levels of detail back to back, the full mesh first.
+// The header pins the format version, the Vertex layout and the source file's size and time,
+// so an edited model, a changed import or a changed vertex struct simply misses. The game writes
+// a cache on every miss; the cook tool (tools/cook) writes them all ahead of time. Builds with
+// ASSETS_COOKED_ONLY trust the cooked files and don't need the sources at all.
+const unsigned int MESH_CACHE_MAGIC = 0x48534D41; // "AMSH"
+const unsigned int MESH_CACHE_VERSION = 4;        // bump when the import or layout changes
+
+struct MeshCacheHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int vertexSize;
+	unsigned int meshCount;
+	unsigned long long sourceSize;
+	unsigned long long sourceTime;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+struct MeshCacheRecord {
+	unsigned int vertexCount;
+	unsigned int indexCount; // all levels of detail
+	unsigned int lodCount;
+	unsigned int lodIndexCounts[MESH_LOD_COUNT_MAX];
+	float lodErrors[MESH_LOD_COUNT_MAX];
+	unsigned int textureCount;
+	unsigned int firstTexture;
+	unsigned long long vertexOffset;
+	unsigned long long indexOffset;
+};
+
+struct MeshCacheTexture {
+	char type[32];
+	char path[224];
+};
+
+class MeshCache {
+private:
+	VfsFile file;
+	const MeshCacheHeader *header;
+	const MeshCacheRecord *records;
+	const MeshCacheTexture *textures;
+
+	static const char *directory() {
+		return "meshcache";
+	}
+
+	static size_t align(size_t offset) {
+		return (offset + 15) & ~(size_t)15;
+	}
+
+	// from the asset archive when the source is packed, so packed caches check against packed sources
+	static bool sourceStamp(const string &sourcePath, unsigned long long &size, unsigned long long &time) {
+		return vfs().stat(sourcePath, size, time);
+	}
+
+	// every offset and count is checked against the mapping, a truncated or foreign file just misses
+	bool validate(const string &sourcePath) {
+		size_t fileSize = file.getSize();
+		if (fileSize < sizeof(MeshCacheHeader)) {
+			return false;
+		}
+		header = (const MeshCacheHeader*)file.getData();
+		if (header->magic != MESH_CACHE_MAGIC || header->version != MESH_CACHE_VERSION || header->vertexSize != sizeof(Vertex)) {
+			return false;
+		}
+#ifndef ASSETS_COOKED_ONLY
+		unsigned long long size, time;
+		if (!sourceStamp(sourcePath, size, time) || header->sourceSize != size || header->sourceTime != time) {
+			return false;
+		}
+#endif
+		size_t recordsEnd = sizeof(MeshCacheHeader) + (size_t)header->meshCount * sizeof(MeshCacheRecord);
+		if (recordsEnd > fileSize) {
+			return false;
+		}
+		records = (const MeshCacheRecord*)(file.getData() + sizeof(MeshCacheHeader));
+		unsigned int textureCount = 0;
+		for (unsigned int i = 0; i < header->meshCount; i++) {
+			const MeshCacheRecord &record = records[i];
+			if (record.lodCount < 1 || record.lodCount > MESH_LOD_COUNT_MAX) {
+				return false;
+			}
+			unsigned long long lodIndices = 0;
+			for (unsigned int l = 0; l < record.lodCount; l++) {
+				lodIndices += record.lodIndexCounts[l];
+			}
+			if (lodIndices != record.indexCount
+				|| record.firstTexture != textureCount
+				|| record.vertexOffset + (unsigned long long)record.vertexCount * sizeof(Vertex) > fileSize
+				|| record.indexOffset + (unsigned long long)record.indexCount * sizeof(unsigned int) > fileSize) {
+				return false;
+			}
+			textureCount += record.textureCount;
+		}
+		if (recordsEnd + (size_t)textureCount * sizeof(MeshCacheTexture) > fileSize) {
+			return false;
+		}
+		textures = (const MeshCacheTexture*)(file.getData() + recordsEnd);
+		return true;
+	}
+
+public:
+	MeshCache() {
+		header = NULL;
+		records = NULL;
+		textures = NULL;
+	}
+
+	// the name only depends on the path the game loads the model by, so a cook run and the game agree
+	static string path(const string &sourcePath) {
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.mesh", contentHash(canonicalAssetPath(sourcePath)));
+		return string(directory()) + "/" + name;
+	}
+
+	// maps the cache of sourcePath; false if there is none or it's stale
+	bool open(const string &sourcePath) {
+		if (!vfs().open(path(sourcePath), file)) {
+			return false;
+		}
+		if (!validate(sourcePath)) {
+			logInfo(CATEGORY_ASSETS, "mesh cache {} of {} is stale", path(sourcePath), sourcePath);
+			file.close();
+			return false;
+		}
+		return true;
+	}
+
+	// the model has been uploaded, the pages can go
+	void close() {
+		file.close();
+		header = NULL;
+	}
+
+	int getMeshCount() const {
+		return header->meshCount;
+	}
+
+	const Vertex *getVertices(int mesh) const {
+		return (const Vertex*)(file.getData() + records[mesh].vertexOffset);
+	}
+
+	unsigned int getVertexCount(int mesh) const {
+		return records[mesh].vertexCount;
+	}
+
+	const unsigned int *getIndices(int mesh) const {
+		return (const unsigned int*)(file.getData() + records[mesh].indexOffset);
+	}
+
+	unsigned int getIndexCount(int mesh) const {
+		return records[mesh].indexCount;
+	}
+
+	// level 0 is the full mesh
+	int getLodCount(int mesh) const {
+		return records[mesh].lodCount;
+	}
+
+	unsigned int getLodIndexCount(int mesh, int lod) const {
+		return records[mesh].lodIndexCounts[lod];
+	}
+
+	// how far the level may be from the full mesh, in model units
+	float getLodError(int mesh, int lod) const {
+		return records[mesh].lodErrors[lod];
+	}
+
+	// material references as they were imported: type ("texture_diffuse"...) and path relative to the model
+	vector<Texture> getTextureReferences(int mesh) const {
+		vector<Texture> references;
+		for (unsigned int i = 0; i < records[mesh].textureCount; i++) {
+			const MeshCacheTexture &stored = textures[records[mesh].firstTexture + i];
+			Texture texture;
+			texture.id = 0;
+			texture.type = string(stored.type, strnlen(stored.type, sizeof(stored.type)));
+			texture.path = string(stored.path, strnlen(stored.path, sizeof(stored.path)));
+			references.push_back(texture);
+		}
+		return references;
+	}
+
+	glm::vec3 getBoundsMin() const {
+		return glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+	}
+
+	glm::vec3 getBoundsMax() const {
+		return glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+	}
+
+	// writes the imported meshes, paths are relative to the directory the game runs in
+	static bool store(const string &sourcePath, const vector<MeshData> &meshes, glm::vec3 boundsMin, glm::vec3 boundsMax) {
+		MeshCacheHeader header;
+		memset(&header, 0, sizeof(header));
+		header.magic = MESH_CACHE_MAGIC;
+		header.version = MESH_CACHE_VERSION;
+		header.vertexSize = sizeof(Vertex);
+		header.meshCount = meshes.size();
+		if (!sourceStamp(sourcePath, header.sourceSize, header.sourceTime)) {
+			return false;
+		}
+		for (int k = 0; k < 3; k++) {
+			header.boundsMin[k] = boundsMin[k];
+			header.boundsMax[k] = boundsMax[k];
+		}
+
+		vector<MeshCacheRecord> records(meshes.size());
+		vector<MeshCacheTexture> textures;
+		for (int i = 0; i < meshes.size(); i++) {
+			memset(&records[i], 0, sizeof(MeshCacheRecord));
+			records[i].vertexCount = meshes[i].vertices.size();
+			records[i].indexCount = meshes[i].indices.size();
+			records[i].lodCount = 1 + meshes[i].lods.size();
+			records[i].lodIndexCounts[0] = meshes[i].indices.size();
+			for (int l = 0; l < meshes[i].lods.size(); l++) {
+				records[i].indexCount += meshes[i].lods[l].indices.size();
+				records[i].lodIndexCounts[l + 1] = meshes[i].lods[l].indices.size();
+				records[i].lodErrors[l + 1] = meshes[i].lods[l].error;
+			}
+			records[i].textureCount = meshes[i].textures.size();
+			records[i].firstTexture = textures.size();
+			for (int t = 0; t < meshes[i].textures.size(); t++) {
+				MeshCacheTexture stored;
+				memset(&stored, 0, sizeof(stored));
+				if (meshes[i].textures[t].type.size() >= sizeof(stored.type) || meshes[i].textures[t].path.size() >= sizeof(stored.path)) {
+					logWarning(CATEGORY_ASSETS, "texture reference {} too long for the mesh cache, {} not cached", meshes[i].textures[t].path, sourcePath);
+					return false;
+				}
+				strncpy(stored.type, meshes[i].textures[t].type.c_str(), sizeof(stored.type) - 1);
+				strncpy(stored.path, meshes[i].textures[t].path.c_str(), sizeof(stored.path) - 1);
+				textures.push_back(stored);
+			}
+		}
+		size_t offset = align(sizeof(MeshCacheHeader) + records.size() * sizeof(MeshCacheRecord) + textures.size() * sizeof(MeshCacheTexture));
+		for (int i = 0; i < meshes.size(); i++) {
+			records[i].vertexOffset = offset;
+			offset = align(offset + records[i].vertexCount * sizeof(Vertex));
+			records[i].indexOffset = offset;
+			offset = align(offset + records[i].indexCount * sizeof(unsigned int));
+		}
+
+#ifdef _WIN32
+		_mkdir(directory());
+#else
+		mkdir(directory(), 0755);
+#endif
+		string target = path(sourcePath);
+		ofstream out(target.c_str(), ios::binary | ios::trunc);
+		out.write((const char*)&header, sizeof(header));
+		if (!records.empty()) {
+			out.write((const char*)&records[0], records.size() * sizeof(MeshCacheRecord));
+		}
+		if (!textures.empty()) {
+			out.write((const char*)&textures[0], textures.size() * sizeof(MeshCacheTexture));
+		}
+		const char padding[16] = { 0 };
+		for (int i = 0; i < meshes.size(); i++) {
+			out.write(padding, records[i].vertexOffset - (size_t)out.tellp());
+			if (!meshes[i].vertices.empty()) {
+				out.write((const char*)&meshes[i].vertices[0], meshes[i].vertices.size() * sizeof(Vertex));
+			}
+			out.write(padding, records[i].indexOffset - (size_t)out.tellp());
+			if (!meshes[i].indices.empty()) {
+				out.write((const char*)&meshes[i].indices[0], meshes[i].indices.size() * sizeof(unsigned int));
+			}
+			for (int l = 0; l < meshes[i].lods.size(); l++) {
+				if (!meshes[i].lods[l].indices.empty()) {
+					out.write((const char*)&meshes[i].lods[l].indices[0], meshes[i].lods[l].indices.size() * sizeof(unsigned int));
+				}
+			}
+		}
+		if (!out) {
+			logWarning(CATEGORY_ASSETS, "could not write mesh cache {}", target);
+			out.close();
+			remove(target.c_str());
+			return false;
+		}
+		return true;
+	}
+};
+#endif
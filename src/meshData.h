@@ -0,0 +1,63 @@
+#pragma once
+#ifndef MESH_DATA_H
+#define MESH_DATA_H
+
+#include <glm/glm.hpp>
+
+#include <limits>
+#include <string>
+#include <vector>
+using namespace std;
+
+struct Vertex {
+	// position
+	glm::vec3 Position;
+	// normal
+	glm::vec3 Normal;
+	// texCoords
+	glm::vec2 TexCoords;
+	// tangent
+	glm::vec3 Tangent;
+	// bitangent
+	glm::vec3 Bitangent;
+};
+
+struct Texture {
+	unsigned int id;
+	string type;
+	string path;
+};
+
+const int MESH_LOD_COUNT_MAX = 5; // levels of detail per mesh, the full one included
+
+// A coarser version of a mesh: its own triangles over the full mesh's vertices, and how far (in
+// model units) its surface may be from the full one
+struct MeshLod {
+	vector<unsigned int> indices;
+	float error;
+};
+
+// One imported mesh before anything is uploaded. Texture references carry no ids yet, they are
+// resolved when the GL side builds a Mesh from it (or never, in the cook tool).
+struct MeshData {
+	vector<Vertex> vertices;
+	vector<unsigned int> indices;
+	vector<Texture> textures;
+	vector<MeshLod> lods; // coarsest last, at most MESH_LOD_COUNT_MAX - 1
+};
+
+// model space box around every vertex of every mesh, zero sized for an empty model
+inline void computeBounds(const vector<MeshData> &meshes, glm::vec3 &boundsMin, glm::vec3 &boundsMax) {
+	boundsMin = glm::vec3(numeric_limits<float>::max());
+	boundsMax = glm::vec3(-numeric_limits<float>::max());
+	for (int i = 0; i < meshes.size(); i++) {
+		for (int j = 0; j < meshes[i].vertices.size(); j++) {
+			boundsMin = glm::min(boundsMin, meshes[i].vertices[j].Position);
+			boundsMax = glm::max(boundsMax, meshes[i].vertices[j].Position);
+		}
+	}
+	if (boundsMin.x > boundsMax.x) {
+		boundsMin = boundsMax = glm::vec3(0.0f);
+	}
+}
+#endif
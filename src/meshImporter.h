@@ -0,0 +1,251 @@
+#pragma once
+#ifndef MESH_IMPORTER_H
+#define MESH_IMPORTER_H
+
+#include <glm/glm.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "meshData.h"
+#include "objImporter.h"
+#include "meshSimplifier.h"
+#include "meshOptimizer.h"
+#include "vfs.h"
+#include "logger.h"
+using namespace std;
+
+// Read-only ASSIMP stream over a file from the VFS; the importer reads the packed bytes in place.
+class VfsIOStream : public Assimp::IOStream
+{
+public:
+	VfsFile file;
+	size_t position;
+
+	VfsIOStream()
+	{
+		position = 0;
+	}
+
+	size_t Read(void *buffer, size_t size, size_t count) override
+	{
+		if (size == 0)
+			return 0;
+		count = min(count, (file.getSize() - position) / size);
+		memcpy(buffer, file.getData() + position, size * count);
+		position += size * count;
+		return count;
+	}
+
+	size_t Write(const void *, size_t, size_t) override
+	{
+		return 0;
+	}
+
+	aiReturn Seek(size_t offset, aiOrigin origin) override
+	{
+		size_t target = origin == aiOrigin_SET ? offset : origin == aiOrigin_CUR ? position + offset : file.getSize() + offset;
+		if (target > file.getSize())
+			return aiReturn_FAILURE;
+		position = target;
+		return aiReturn_SUCCESS;
+	}
+
+	size_t Tell() const override
+	{
+		return position;
+	}
+
+	size_t FileSize() const override
+	{
+		return file.getSize();
+	}
+
+	void Flush() override
+	{
+	}
+};
+
+// Lets ASSIMP open the model and the files it references (material libraries) through the VFS.
+class VfsIOSystem : public Assimp::IOSystem
+{
+public:
+	bool Exists(const char *path) const override
+	{
+		return vfs().exists(path);
+	}
+
+	char getOsSeparator() const override
+	{
+		return '/';
+	}
+
+	Assimp::IOStream *Open(const char *path, const char *mode) override
+	{
+		if (strchr(mode, 'w') != NULL || strchr(mode, 'a') != NULL)
+			return NULL;
+		VfsIOStream *stream = new VfsIOStream();
+		if (!vfs().open(path, stream->file))
+		{
+			delete stream;
+			return NULL;
+		}
+		return stream;
+	}
+
+	void Close(Assimp::IOStream *stream) override
+	{
+		delete stream;
+	}
+};
+
+// Reads a model into plain MeshData: OBJ with its own parser (objImporter.h), everything else
+// with ASSIMP, then builds its levels of detail (meshSimplifier.h) and reorders it all for
+// drawing (meshOptimizer.h). Nothing here touches GL, so the game (on a cache miss) and the cook
+// tool (on its worker threads, one importer each) share the same import.
+class MeshImporter
+{
+public:
+	static bool import(string const &path, vector<MeshData> &meshes)
+	{
+		size_t first = meshes.size();
+		bool imported = ObjImporter::handles(path) ? ObjImporter::import(path, meshes) : importWithAssimp(path, meshes);
+		if (imported)
+		{
+			MeshSimplifier::buildLods(path, meshes, first);
+			MeshOptimizer::optimize(path, meshes, first);
+		}
+		return imported;
+	}
+
+	// loads a model with supported ASSIMP extensions from file and appends its meshes.
+	static bool importWithAssimp(string const &path, vector<MeshData> &meshes)
+	{
+		// read file via ASSIMP
+		Assimp::Importer importer;
+		importer.SetIOHandler(new VfsIOSystem()); // the importer owns it
+		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+		// check for errors
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+		{
+			logError(CATEGORY_ASSETS, "ERROR::ASSIMP:: {}", importer.GetErrorString());
+			return false;
+		}
+		// process ASSIMP's root node recursively
+		processNode(scene->mRootNode, scene, meshes);
+		return true;
+	}
+
+private:
+	// processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
+	static void processNode(aiNode *node, const aiScene *scene, vector<MeshData> &meshes)
+	{
+		// process each mesh located at the current node
+		for (unsigned int i = 0; i < node->mNumMeshes; i++)
+		{
+			// the node object only contains indices to index the actual objects in the scene. 
+			// the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
+			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+			meshes.push_back(MeshData());
+			processMesh(mesh, scene, meshes.back());
+		}
+		// after we've processed all of the meshes (if any) we then recursively process each of the children nodes
+		for (unsigned int i = 0; i < node->mNumChildren; i++)
+		{
+			processNode(node->mChildren[i], scene, meshes);
+		}
+
+	}
+
+	static void processMesh(aiMesh *mesh, const aiScene *scene, MeshData &data)
+	{
+		// Walk through each of the mesh's vertices
+		data.vertices.reserve(mesh->mNumVertices);
+		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+		{
+			Vertex vertex;
+			glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
+							  // positions
+			vector.x = mesh->mVertices[i].x;
+			vector.y = mesh->mVertices[i].y;
+			vector.z = mesh->mVertices[i].z;
+			vertex.Position = vector;
+			// normals
+			vector.x = mesh->mNormals[i].x;
+			vector.y = mesh->mNormals[i].y;
+			vector.z = mesh->mNormals[i].z;
+			vertex.Normal = vector;
+			// texture coordinates
+			if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+			{
+				glm::vec2 vec;
+				// a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
+				// use models where a vertex can have multiple texture coordinates so we always take the first set (0).
+				vec.x = mesh->mTextureCoords[0][i].x;
+				vec.y = mesh->mTextureCoords[0][i].y;
+				vertex.TexCoords = vec;
+			}
+			else
+				vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+			// tangent
+			vector.x = mesh->mTangents[i].x;
+			vector.y = mesh->mTangents[i].y;
+			vector.z = mesh->mTangents[i].z;
+			vertex.Tangent = vector;
+			// bitangent
+			vector.x = mesh->mBitangents[i].x;
+			vector.y = mesh->mBitangents[i].y;
+			vector.z = mesh->mBitangents[i].z;
+			vertex.Bitangent = vector;
+			data.vertices.push_back(vertex);
+		}
+		// now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+		for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+		{
+			aiFace face = mesh->mFaces[i];
+			// retrieve all indices of the face and store them in the indices vector
+			for (unsigned int j = 0; j < face.mNumIndices; j++)
+				data.indices.push_back(face.mIndices[j]);
+		}
+		// process materials
+		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+		// we assume a convention for sampler names in the shaders. Each diffuse texture should be named
+		// as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
+		// Same applies to other texture as the following list summarizes:
+		// diffuse: texture_diffuseN
+		// specular: texture_specularN
+		// normal: texture_normalN
+
+		// 1. diffuse maps
+		materialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", data.textures);
+		// 2. specular maps
+		materialTextures(material, aiTextureType_SPECULAR, "texture_specular", data.textures);
+		// 3. normal maps
+		materialTextures(material, aiTextureType_HEIGHT, "texture_normal", data.textures);
+		// 4. height maps
+		materialTextures(material, aiTextureType_AMBIENT, "texture_height", data.textures);
+	}
+
+	// appends the material's textures of a given type; paths stay relative to the model's directory
+	static void materialTextures(aiMaterial *mat, aiTextureType type, string typeName, vector<Texture> &textures)
+	{
+		for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+		{
+			aiString str;
+			mat->GetTexture(type, i, &str);
+			Texture texture;
+			texture.id = 0;
+			texture.type = typeName;
+			texture.path = str.C_Str();
+			textures.push_back(texture);
+		}
+	}
+};
+#endif
@@ -0,0 +1,286 @@
+#pragma once
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "meshData.h"
+#include "logger.h"
+using namespace std;
+
+const int VERTEX_CACHE_SIZE = 16;             // post-transform cache entries the triangle order is tuned for
+const float OVERDRAW_CACHE_THRESHOLD = 1.05f; // how much worse the ACMR may get for the overdraw order
+
+// How an index buffer uses the post-transform vertex cache, simulated as a FIFO of VERTEX_CACHE_SIZE.
+struct VertexCacheStats {
+	unsigned long long transforms; // cache misses, each one runs the vertex shader
+	unsigned long long triangles;
+	unsigned long long vertices;
+
+	VertexCacheStats() {
+		transforms = 0;
+		triangles = 0;
+		vertices = 0;
+	}
+
+	// average cache miss ratio, transforms per triangle: about 0.5 at best for a closed mesh, 3 at worst
+	float acmr() const {
+		return triangles == 0 ? 0.0f : (float)transforms / triangles;
+	}
+
+	// average transform to vertex ratio, 1 at best
+	float atvr() const {
+		return vertices == 0 ? 0.0f : (float)transforms / vertices;
+	}
+
+	void add(const VertexCacheStats &other) {
+		transforms += other.transforms;
+		triangles += other.triangles;
+		vertices += other.vertices;
+	}
+};
+
+// Reorders imported meshes so they are cheaper to draw, without changing what is drawn:
+//  - triangles for vertex cache hits with Tipsify (Sander, Nehab and Barczak 2007), which walks
+//    fans around the vertices still in the cache and jumps back to a recent one at a dead end
+//  - the runs between those jumps for overdraw, outward facing runs first, so on the mostly
+//    convex rocks the near side fills the depth buffer before the far side is shaded; kept only
+//    if the cache doesn't lose more than OVERDRAW_CACHE_THRESHOLD over it
+//  - vertices in the order the full mesh's triangles first use them, so vertex fetch reads memory
+//    in order; vertices no triangle uses are dropped
+// The levels of detail (meshSimplifier.h) get the same triangle orders over the shared vertices.
+// Runs at import, so the mesh cache stores the optimized buffers and loading costs nothing extra.
+class MeshOptimizer {
+private:
+	static VertexCacheStats analyze(const vector<unsigned int> &indices, size_t vertexCount) {
+		VertexCacheStats stats;
+		stats.triangles = indices.size() / 3;
+		stats.vertices = vertexCount;
+		vector<long long> inserted(vertexCount, -1); // when the vertex last entered the cache, in transforms
+		for (int i = 0; i < indices.size(); i++) {
+			long long &entered = inserted[indices[i]];
+			if (entered < 0 || (long long)stats.transforms - entered >= VERTEX_CACHE_SIZE) {
+				entered = stats.transforms;
+				stats.transforms++;
+			}
+		}
+		return stats;
+	}
+
+	// the triangle order in ordered, and the first triangle of every run Tipsify started at a dead end in runs
+	static void tipsify(const vector<unsigned int> &indices, size_t vertexCount, vector<unsigned int> &ordered, vector<size_t> &runs) {
+		size_t triangleCount = indices.size() / 3;
+		// triangles around every vertex
+		vector<unsigned int> adjacencyStart(vertexCount + 1, 0);
+		for (int i = 0; i < indices.size(); i++) {
+			adjacencyStart[indices[i] + 1]++;
+		}
+		for (int v = 0; v < vertexCount; v++) {
+			adjacencyStart[v + 1] += adjacencyStart[v];
+		}
+		vector<unsigned int> adjacency(indices.size());
+		vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (int i = 0; i < indices.size(); i++) {
+			adjacency[fill[indices[i]]++] = i / 3;
+		}
+
+		vector<int> live(vertexCount); // triangles around the vertex not yet emitted
+		for (int v = 0; v < vertexCount; v++) {
+			live[v] = adjacencyStart[v + 1] - adjacencyStart[v];
+		}
+		vector<int> cacheTime(vertexCount, 0);
+		vector<bool> emitted(triangleCount, false);
+		vector<unsigned int> deadEnds; // recently emitted vertices, to resume from
+		vector<unsigned int> candidates;
+		int time = VERTEX_CACHE_SIZE + 1;
+		size_t cursor = 0;
+
+		ordered.clear();
+		ordered.reserve(indices.size());
+		runs.clear();
+		int fan = nextLive(live, cursor);
+		while (fan >= 0) {
+			runs.push_back(ordered.size() / 3);
+			while (fan >= 0) {
+				candidates.clear();
+				for (unsigned int a = adjacencyStart[fan]; a < adjacencyStart[fan + 1]; a++) {
+					unsigned int triangle = adjacency[a];
+					if (emitted[triangle]) {
+						continue;
+					}
+					for (int k = 0; k < 3; k++) {
+						unsigned int v = indices[triangle * 3 + k];
+						ordered.push_back(v);
+						deadEnds.push_back(v);
+						candidates.push_back(v);
+						live[v]--;
+						if (time - cacheTime[v] > VERTEX_CACHE_SIZE) {
+							cacheTime[v] = time++;
+						}
+					}
+					emitted[triangle] = true;
+				}
+				// the candidate that stays in the cache while its remaining fan is drawn, the oldest such first
+				fan = -1;
+				int best = -1;
+				for (int i = 0; i < candidates.size(); i++) {
+					unsigned int v = candidates[i];
+					if (live[v] <= 0) {
+						continue;
+					}
+					int priority = time - cacheTime[v] + 2 * live[v] <= VERTEX_CACHE_SIZE ? time - cacheTime[v] : 0;
+					if (priority > best) {
+						best = priority;
+						fan = v;
+					}
+				}
+			}
+			// dead end: the most recent vertex with triangles left, or the next one in index order
+			while (fan < 0 && !deadEnds.empty()) {
+				unsigned int v = deadEnds.back();
+				deadEnds.pop_back();
+				if (live[v] > 0) {
+					fan = v;
+				}
+			}
+			if (fan < 0) {
+				fan = nextLive(live, cursor);
+			}
+		}
+	}
+
+	static int nextLive(const vector<int> &live, size_t &cursor) {
+		while (cursor < live.size()) {
+			if (live[cursor] > 0) {
+				return cursor;
+			}
+			cursor++;
+		}
+		return -1;
+	}
+
+	// runs sorted by how far they face away from the mesh centre, each weighted by its area
+	static void reorderForOverdraw(const vector<Vertex> &vertices, const vector<unsigned int> &indices, const vector<size_t> &runs, vector<unsigned int> &ordered) {
+		size_t triangleCount = indices.size() / 3;
+		vector<glm::vec3> runCentroids(runs.size(), glm::vec3(0.0f));
+		vector<glm::vec3> runNormals(runs.size(), glm::vec3(0.0f));
+		vector<float> runAreas(runs.size(), 0.0f);
+		glm::vec3 centroid(0.0f);
+		float area = 0.0f;
+		for (int r = 0; r < runs.size(); r++) {
+			size_t end = r + 1 < runs.size() ? runs[r + 1] : triangleCount;
+			for (size_t t = runs[r]; t < end; t++) {
+				glm::vec3 a = vertices[indices[t * 3]].Position;
+				glm::vec3 b = vertices[indices[t * 3 + 1]].Position;
+				glm::vec3 c = vertices[indices[t * 3 + 2]].Position;
+				glm::vec3 normal = glm::cross(b - a, c - a);
+				float triangleArea = glm::length(normal);
+				runCentroids[r] += (a + b + c) * (triangleArea / 3.0f);
+				runNormals[r] += normal;
+				runAreas[r] += triangleArea;
+			}
+			centroid += runCentroids[r];
+			area += runAreas[r];
+		}
+		if (area > 0.0f) {
+			centroid /= area;
+		}
+		vector<pair<float, int> > order(runs.size());
+		for (int r = 0; r < runs.size(); r++) {
+			float facing = 0.0f;
+			float normalLength = glm::length(runNormals[r]);
+			if (runAreas[r] > 0.0f && normalLength > 0.0f) {
+				facing = glm::dot(runCentroids[r] / runAreas[r] - centroid, runNormals[r] / normalLength);
+			}
+			order[r] = make_pair(-facing, r);
+		}
+		stable_sort(order.begin(), order.end());
+
+		ordered.clear();
+		ordered.reserve(indices.size());
+		for (int i = 0; i < order.size(); i++) {
+			int r = order[i].second;
+			size_t end = r + 1 < runs.size() ? runs[r + 1] : triangleCount;
+			ordered.insert(ordered.end(), indices.begin() + runs[r] * 3, indices.begin() + end * 3);
+		}
+	}
+
+	// the levels of detail only use vertices of the full mesh, so they are remapped after it
+	static void reorderForFetch(vector<Vertex> &vertices, vector<unsigned int> &indices, vector<MeshLod> &lods) {
+		const unsigned int unused = ~0u;
+		vector<unsigned int> remap(vertices.size(), unused);
+		unsigned int next = 0;
+		for (int i = 0; i < indices.size(); i++) {
+			unsigned int &target = remap[indices[i]];
+			if (target == unused) {
+				target = next++;
+			}
+			indices[i] = target;
+		}
+		for (int l = 0; l < lods.size(); l++) {
+			for (int i = 0; i < lods[l].indices.size(); i++) {
+				lods[l].indices[i] = remap[lods[l].indices[i]];
+			}
+		}
+		vector<Vertex> ordered(next);
+		for (int v = 0; v < vertices.size(); v++) {
+			if (remap[v] != unused) {
+				ordered[remap[v]] = vertices[v];
+			}
+		}
+		vertices.swap(ordered);
+	}
+
+	static void reorderTriangles(const vector<Vertex> &vertices, vector<unsigned int> &indices) {
+		vector<unsigned int> cacheOrder;
+		vector<size_t> runs;
+		tipsify(indices, vertices.size(), cacheOrder, runs);
+		vector<unsigned int> overdrawOrder;
+		reorderForOverdraw(vertices, cacheOrder, runs, overdrawOrder);
+		float cacheAcmr = analyze(cacheOrder, vertices.size()).acmr();
+		if (analyze(overdrawOrder, vertices.size()).acmr() <= cacheAcmr * OVERDRAW_CACHE_THRESHOLD) {
+			indices.swap(overdrawOrder);
+		}
+		else {
+			indices.swap(cacheOrder);
+		}
+	}
+
+	static float rounded(float value) {
+		return floor(value * 1000.0f + 0.5f) / 1000.0f;
+	}
+
+public:
+	static VertexCacheStats analyze(const MeshData &mesh) {
+		return analyze(mesh.indices, mesh.vertices.size());
+	}
+
+	static void optimize(MeshData &mesh) {
+		if (mesh.indices.empty() || mesh.indices.size() % 3 != 0) {
+			return;
+		}
+		reorderTriangles(mesh.vertices, mesh.indices);
+		for (int l = 0; l < mesh.lods.size(); l++) {
+			reorderTriangles(mesh.vertices, mesh.lods[l].indices);
+		}
+		reorderForFetch(mesh.vertices, mesh.indices, mesh.lods);
+	}
+
+	// optimizes the meshes from first on and logs how the model's vertex cache use changed
+	static void optimize(const string &path, vector<MeshData> &meshes, size_t first) {
+		VertexCacheStats before, after;
+		for (size_t i = first; i < meshes.size(); i++) {
+			before.add(analyze(meshes[i]));
+			optimize(meshes[i]);
+			after.add(analyze(meshes[i]));
+		}
+		logInfo(CATEGORY_ASSETS, "optimized {}: ACMR {} -> {}, ATVR {} -> {}", path,
+			rounded(before.acmr()), rounded(after.acmr()), rounded(before.atvr()), rounded(after.atvr()));
+	}
+};
+#endif
@@ -0,0 +1,643 @@
+#pragma once
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "meshData.h"
+#include "logger.h"
+using namespace std;
+
+const float LOD_TRIANGLE_RATIO = 0.4f; // each level aims for this share of the previous level's triangles
+const float LOD_MIN_REDUCTION = 0.8f;  // a level keeping more than this share of the previous one ends the chain
+const int LOD_MIN_TRIANGLES = 16;      // no mesh is simplified below this
+const float LOD_MAX_ERROR = 0.05f;     // largest error a level may reach, as a share of the model's bounding box diagonal
+const unsigned int NO_OPEN_EDGE = ~0u;
+
+// Builds the coarser levels of detail of imported meshes with quadric error metrics (Garland and
+// Heckbert 1997): every position sums the squared distances to the planes of its triangles, and
+// the edge whose collapse adds the least to that goes first. Collapses move a vertex onto an
+// existing one, so a level is only a new index buffer over the full mesh's vertices.
+// Vertices that share a position across a UV or normal seam only collapse along the seam and take
+// their twin with them; border vertices only collapse along the border, and positions shared by
+// more than two vertices stay put, so levels don't tear at seams or between meshes.
+// Those corners can hold a level above its target. Such a level is simplified again by position
+// alone, and each moved corner then takes the vertex at its new position whose texture coordinates
+// and normal are closest to the ones it had, and that version is kept if it has fewer triangles.
+// Texture seams may smear in the second, which is acceptable at the distances it is drawn from.
+// A level's error is measured after simplifying: the largest distance from a full mesh position to
+// the level's triangles where it and its neighbours collapsed into.
+class MeshSimplifier {
+private:
+	enum VertexKind { KIND_MANIFOLD, KIND_BORDER, KIND_SEAM, KIND_LOCKED };
+
+	// area weighted sum of squared plane distances: v'Av + 2b'v + c, over the total weight
+	struct Quadric {
+		double a00, a11, a22, a10, a20, a21;
+		double b0, b1, b2;
+		double c;
+		double weight;
+	};
+
+	// what every level of one mesh starts from
+	struct Topology {
+		bool byPosition;               // seams ignored: indices are remapped, wedges left out
+		vector<unsigned int> source;   // the full mesh without degenerate triangles
+		vector<unsigned int> indices;  // what is simplified: source, or its positions
+		vector<unsigned int> remap;    // the first vertex at the same position
+		vector<unsigned int> wedge;    // the next vertex at the same position, around a loop
+		vector<unsigned int> openOut;  // where the vertex's open edge leads: NO_OPEN_EDGE, or itself if several do
+		vector<unsigned int> openIn;   // where its open edge comes from, likewise
+		vector<unsigned char> kind;
+		vector<Quadric> quadrics;      // by remapped vertex
+	};
+
+	// one simplified level and how it came about
+	struct Simplified {
+		vector<unsigned int> indices;
+		vector<unsigned int> origins; // the source triangle every triangle was
+		vector<unsigned int> moved;   // the position every position collapsed into, by remapped vertex
+	};
+
+	struct Collapse {
+		unsigned int from;
+		unsigned int to;
+		double error;
+
+		bool operator<(const Collapse &other) const {
+			return error < other.error;
+		}
+	};
+
+	static void addPlane(Quadric &quadric, glm::dvec3 normal, double distance, double weight) {
+		quadric.a00 += weight * normal.x * normal.x;
+		quadric.a11 += weight * normal.y * normal.y;
+		quadric.a22 += weight * normal.z * normal.z;
+		quadric.a10 += weight * normal.y * normal.x;
+		quadric.a20 += weight * normal.z * normal.x;
+		quadric.a21 += weight * normal.z * normal.y;
+		quadric.b0 += weight * normal.x * distance;
+		quadric.b1 += weight * normal.y * distance;
+		quadric.b2 += weight * normal.z * distance;
+		quadric.c += weight * distance * distance;
+		quadric.weight += weight;
+	}
+
+	static void addQuadric(Quadric &quadric, const Quadric &other) {
+		quadric.a00 += other.a00;
+		quadric.a11 += other.a11;
+		quadric.a22 += other.a22;
+		quadric.a10 += other.a10;
+		quadric.a20 += other.a20;
+		quadric.a21 += other.a21;
+		quadric.b0 += other.b0;
+		quadric.b1 += other.b1;
+		quadric.b2 += other.b2;
+		quadric.c += other.c;
+		quadric.weight += other.weight;
+	}
+
+	// mean squared distance of point to the quadric's planes
+	static double quadricError(const Quadric &quadric, glm::vec3 point) {
+		double x = point.x, y = point.y, z = point.z;
+		double rx = quadric.a00 * x + quadric.a10 * y + quadric.a20 * z;
+		double ry = quadric.a10 * x + quadric.a11 * y + quadric.a21 * z;
+		double rz = quadric.a20 * x + quadric.a21 * y + quadric.a22 * z;
+		double error = rx * x + ry * y + rz * z + 2.0 * (quadric.b0 * x + quadric.b1 * y + quadric.b2 * z) + quadric.c;
+		return quadric.weight > 0.0 ? fabs(error) / quadric.weight : 0.0;
+	}
+
+	static bool samePosition(const Vertex &a, const Vertex &b) {
+		return a.Position.x == b.Position.x && a.Position.y == b.Position.y && a.Position.z == b.Position.z;
+	}
+
+	static void buildRemap(const vector<Vertex> &vertices, Topology &topology) {
+		vector<unsigned int> order(vertices.size());
+		for (unsigned int v = 0; v < vertices.size(); v++) {
+			order[v] = v;
+		}
+		sort(order.begin(), order.end(), [&vertices](unsigned int a, unsigned int b) {
+			const glm::vec3 &p = vertices[a].Position, &q = vertices[b].Position;
+			return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z != q.z ? p.z < q.z : a < b;
+		});
+		topology.remap.resize(vertices.size());
+		topology.wedge.resize(vertices.size());
+		for (size_t start = 0; start < order.size();) {
+			size_t end = start + 1;
+			while (end < order.size() && samePosition(vertices[order[start]], vertices[order[end]])) {
+				end++;
+			}
+			for (size_t i = start; i < end; i++) {
+				topology.remap[order[i]] = order[start];
+				topology.wedge[order[i]] = order[i + 1 < end ? i + 1 : start];
+			}
+			start = end;
+		}
+	}
+
+	// an edge is open if no triangle runs it the other way: a border, or one side of a seam
+	static void classify(size_t vertexCount, Topology &topology) {
+		const vector<unsigned int> &indices = topology.indices;
+		vector<unsigned int> edgeStart(vertexCount + 1, 0);
+		for (size_t i = 0; i < indices.size(); i++) {
+			edgeStart[indices[i] + 1]++;
+		}
+		for (size_t v = 0; v < vertexCount; v++) {
+			edgeStart[v + 1] += edgeStart[v];
+		}
+		vector<unsigned int> edges(indices.size());
+		vector<unsigned int> fill(edgeStart.begin(), edgeStart.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++) {
+			edges[fill[indices[i]]++] = indices[i - i % 3 + (i + 1) % 3];
+		}
+
+		topology.openOut.assign(vertexCount, NO_OPEN_EDGE);
+		topology.openIn.assign(vertexCount, NO_OPEN_EDGE);
+		for (unsigned int a = 0; a < vertexCount; a++) {
+			for (unsigned int e = edgeStart[a]; e < edgeStart[a + 1]; e++) {
+				unsigned int b = edges[e];
+				bool opposite = false;
+				for (unsigned int back = edgeStart[b]; back < edgeStart[b + 1] && !opposite; back++) {
+					opposite = edges[back] == a;
+				}
+				if (!opposite) {
+					topology.openOut[a] = topology.openOut[a] == NO_OPEN_EDGE ? b : a;
+					topology.openIn[b] = topology.openIn[b] == NO_OPEN_EDGE ? a : b;
+				}
+			}
+		}
+
+		topology.kind.resize(vertexCount);
+		for (unsigned int v = 0; v < vertexCount; v++) {
+			unsigned int in = topology.openIn[v], out = topology.openOut[v];
+			bool singleOpen = in != NO_OPEN_EDGE && in != v && out != NO_OPEN_EDGE && out != v;
+			unsigned int twin = topology.byPosition ? v : topology.wedge[v];
+			if (twin == v) {
+				topology.kind[v] = in == NO_OPEN_EDGE && out == NO_OPEN_EDGE ? KIND_MANIFOLD : singleOpen ? KIND_BORDER : KIND_LOCKED;
+			}
+			else if (topology.wedge[twin] == v && singleOpen) {
+				// two vertices at one position whose open edges run along the same positions, opposite ways
+				unsigned int twinIn = topology.openIn[twin], twinOut = topology.openOut[twin];
+				bool twinSingleOpen = twinIn != NO_OPEN_EDGE && twinIn != twin && twinOut != NO_OPEN_EDGE && twinOut != twin;
+				bool seam = twinSingleOpen && topology.remap[in] == topology.remap[twinOut] && topology.remap[out] == topology.remap[twinIn]
+					&& topology.remap[in] != topology.remap[out];
+				topology.kind[v] = seam ? KIND_SEAM : KIND_LOCKED;
+			}
+			else {
+				topology.kind[v] = KIND_LOCKED;
+			}
+		}
+	}
+
+	// triangle planes, and planes standing on open edges so borders and seams keep their shape
+	static void buildQuadrics(const vector<Vertex> &vertices, Topology &topology) {
+		Quadric zero;
+		memset(&zero, 0, sizeof(zero));
+		topology.quadrics.assign(vertices.size(), zero);
+		const vector<unsigned int> &indices = topology.indices;
+		for (size_t t = 0; t < indices.size(); t += 3) {
+			glm::dvec3 p[3];
+			for (int k = 0; k < 3; k++) {
+				p[k] = glm::dvec3(vertices[indices[t + k]].Position);
+			}
+			glm::dvec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+			double length = glm::length(normal);
+			if (length == 0.0) {
+				continue;
+			}
+			normal /= length;
+			Quadric face;
+			memset(&face, 0, sizeof(face));
+			addPlane(face, normal, -glm::dot(normal, p[0]), 0.5 * length);
+			for (int k = 0; k < 3; k++) {
+				addQuadric(topology.quadrics[topology.remap[indices[t + k]]], face);
+			}
+
+			for (int k = 0; k < 3; k++) {
+				unsigned int a = indices[t + k], b = indices[t + (k + 1) % 3];
+				if (topology.openOut[a] != b || (topology.kind[a] != KIND_BORDER && topology.kind[a] != KIND_SEAM)) {
+					continue;
+				}
+				// both sides of a seam run the edge, one of them is enough
+				if (topology.kind[a] == KIND_SEAM && topology.remap[a] > topology.remap[b]) {
+					continue;
+				}
+				glm::dvec3 edge = p[(k + 1) % 3] - p[k];
+				glm::dvec3 edgeNormal = glm::cross(edge, normal);
+				double edgeLength = glm::length(edge);
+				if (edgeLength == 0.0) {
+					continue;
+				}
+				edgeNormal = glm::normalize(edgeNormal);
+				Quadric side;
+				memset(&side, 0, sizeof(side));
+				addPlane(side, edgeNormal, -glm::dot(edgeNormal, p[k]), edgeLength * edgeLength * (topology.kind[a] == KIND_BORDER ? 10.0 : 1.0));
+				addQuadric(topology.quadrics[topology.remap[a]], side);
+				addQuadric(topology.quadrics[topology.remap[b]], side);
+			}
+		}
+	}
+
+	static void buildTopology(const MeshData &mesh, bool byPosition, Topology &topology) {
+		topology.byPosition = byPosition;
+		buildRemap(mesh.vertices, topology);
+		for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+			unsigned int a = mesh.indices[t], b = mesh.indices[t + 1], c = mesh.indices[t + 2];
+			unsigned int pa = topology.remap[a], pb = topology.remap[b], pc = topology.remap[c];
+			if (pa != pb && pb != pc && pa != pc) {
+				topology.source.push_back(a);
+				topology.source.push_back(b);
+				topology.source.push_back(c);
+				topology.indices.push_back(byPosition ? pa : a);
+				topology.indices.push_back(byPosition ? pb : b);
+				topology.indices.push_back(byPosition ? pc : c);
+			}
+		}
+		classify(mesh.vertices.size(), topology);
+		buildQuadrics(mesh.vertices, topology);
+	}
+
+	static bool canCollapse(const Topology &topology, unsigned int from, unsigned int to) {
+		switch (topology.kind[from]) {
+		case KIND_MANIFOLD:
+			return true;
+		case KIND_BORDER:
+		case KIND_SEAM:
+			return topology.kind[to] == topology.kind[from] && (topology.openOut[from] == to || topology.openIn[from] == to);
+		}
+		return false;
+	}
+
+	// first index of every triangle around each position, by remapped vertex
+	static void buildAdjacency(const Topology &topology, const vector<unsigned int> &indices, vector<unsigned int> &adjacencyStart, vector<unsigned int> &adjacency) {
+		size_t vertexCount = topology.remap.size();
+		adjacencyStart.assign(vertexCount + 1, 0);
+		for (size_t i = 0; i < indices.size(); i++) {
+			adjacencyStart[topology.remap[indices[i]] + 1]++;
+		}
+		for (size_t v = 0; v < vertexCount; v++) {
+			adjacencyStart[v + 1] += adjacencyStart[v];
+		}
+		adjacency.resize(indices.size());
+		vector<unsigned int> fillPosition(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++) {
+			adjacency[fillPosition[topology.remap[indices[i]]]++] = i - i % 3;
+		}
+	}
+
+	// whether moving from onto to turns any triangle around it by more than about 75 degrees;
+	// the other corners are where this pass's earlier collapses put them
+	static bool flips(const vector<Vertex> &vertices, const Topology &topology, const vector<unsigned int> &indices,
+		const vector<unsigned int> &adjacencyStart, const vector<unsigned int> &adjacency, const vector<unsigned int> &collapse,
+		unsigned int from, unsigned int to) {
+		unsigned int fromPosition = topology.remap[from], toPosition = topology.remap[to];
+		glm::vec3 before = vertices[from].Position, after = vertices[to].Position;
+		for (unsigned int a = adjacencyStart[fromPosition]; a < adjacencyStart[fromPosition + 1]; a++) {
+			size_t t = adjacency[a];
+			int corner = -1;
+			bool collapses = false;
+			for (int k = 0; k < 3; k++) {
+				unsigned int position = topology.remap[collapse[indices[t + k]]];
+				if (topology.remap[indices[t + k]] == fromPosition) {
+					corner = k;
+				}
+				else if (position == toPosition) {
+					collapses = true;
+				}
+			}
+			if (collapses || corner < 0) {
+				continue;
+			}
+			glm::vec3 b = vertices[collapse[indices[t + (corner + 1) % 3]]].Position;
+			glm::vec3 c = vertices[collapse[indices[t + (corner + 2) % 3]]].Position;
+			glm::vec3 normalBefore = glm::cross(b - before, c - before);
+			glm::vec3 normalAfter = glm::cross(b - after, c - after);
+			if (glm::dot(normalBefore, normalAfter) < 0.25f * glm::length(normalBefore) * glm::length(normalAfter)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// collapses edges of the full mesh, cheapest first, in passes that each touch a position at most
+	// once, until targetIndexCount is reached or the next collapse would cost more than maxError
+	// (squared, in the quadrics' terms)
+	static void simplify(const vector<Vertex> &vertices, const Topology &topology, size_t targetIndexCount, double maxError, Simplified &level) {
+		size_t vertexCount = vertices.size();
+		vector<unsigned int> &result = level.indices;
+		vector<unsigned int> &origins = level.origins;
+		result = topology.indices;
+		origins.resize(result.size() / 3);
+		for (size_t t = 0; t < origins.size(); t++) {
+			origins[t] = t;
+		}
+		level.moved.resize(vertexCount);
+		for (unsigned int v = 0; v < vertexCount; v++) {
+			level.moved[v] = v;
+		}
+		vector<Quadric> quadrics = topology.quadrics;
+		vector<unsigned int> collapse(vertexCount);
+		vector<bool> locked(vertexCount);
+		vector<unsigned int> adjacencyStart, adjacency;
+		vector<Collapse> candidates;
+
+		while (result.size() > targetIndexCount) {
+			buildAdjacency(topology, result, adjacencyStart, adjacency);
+
+			// the cheaper way to collapse every edge; an edge between manifold vertices shows up in
+			// both its triangles, only the one running it forwards counts
+			candidates.clear();
+			for (size_t i = 0; i < result.size(); i++) {
+				unsigned int a = result[i], b = result[i - i % 3 + (i + 1) % 3];
+				if (topology.kind[a] == KIND_MANIFOLD && topology.kind[b] == KIND_MANIFOLD && topology.remap[a] > topology.remap[b]) {
+					continue;
+				}
+				Collapse candidate;
+				candidate.error = DBL_MAX;
+				if (canCollapse(topology, a, b)) {
+					candidate.from = a;
+					candidate.to = b;
+					candidate.error = quadricError(quadrics[topology.remap[a]], vertices[b].Position);
+				}
+				if (canCollapse(topology, b, a)) {
+					double error = quadricError(quadrics[topology.remap[b]], vertices[a].Position);
+					if (error < candidate.error) {
+						candidate.from = b;
+						candidate.to = a;
+						candidate.error = error;
+					}
+				}
+				if (candidate.error < DBL_MAX) {
+					candidates.push_back(candidate);
+				}
+			}
+			if (candidates.empty()) {
+				break;
+			}
+			sort(candidates.begin(), candidates.end());
+
+			// a pass takes about as many collapses as still needed, but none much worse than the
+			// collapse that would finish it, so the cheap ones later passes find still go first
+			size_t triangleGoal = (result.size() - targetIndexCount) / 3;
+			size_t edgeGoal = triangleGoal / 2;
+			double errorGoal = edgeGoal < candidates.size() ? 1.5 * candidates[edgeGoal].error : DBL_MAX;
+			for (unsigned int v = 0; v < vertexCount; v++) {
+				collapse[v] = v;
+			}
+			fill(locked.begin(), locked.end(), false);
+			size_t removed = 0;
+			for (size_t c = 0; c < candidates.size() && removed < triangleGoal; c++) {
+				const Collapse &candidate = candidates[c];
+				if (candidate.error > maxError || candidate.error > errorGoal) {
+					break;
+				}
+				unsigned int fromPosition = topology.remap[candidate.from], toPosition = topology.remap[candidate.to];
+				if (locked[fromPosition] || locked[toPosition]) {
+					continue;
+				}
+				if (flips(vertices, topology, result, adjacencyStart, adjacency, collapse, candidate.from, candidate.to)) {
+					continue;
+				}
+				collapse[candidate.from] = candidate.to;
+				if (topology.kind[candidate.from] == KIND_SEAM) {
+					// the twin moves along its side of the seam to the target's twin
+					unsigned int twin = topology.wedge[candidate.from];
+					collapse[twin] = topology.openOut[candidate.from] == candidate.to ? topology.openIn[twin] : topology.openOut[twin];
+				}
+				addQuadric(quadrics[toPosition], quadrics[fromPosition]);
+				locked[fromPosition] = true;
+				locked[toPosition] = true;
+				removed += topology.kind[candidate.from] == KIND_BORDER ? 1 : 2;
+			}
+			if (removed == 0) {
+				break;
+			}
+			for (unsigned int v = 0; v < vertexCount; v++) {
+				level.moved[v] = topology.remap[collapse[level.moved[v]]];
+			}
+
+			size_t kept = 0;
+			for (size_t t = 0; t < result.size(); t += 3) {
+				unsigned int a = collapse[result[t]], b = collapse[result[t + 1]], c = collapse[result[t + 2]];
+				unsigned int pa = topology.remap[a], pb = topology.remap[b], pc = topology.remap[c];
+				if (pa != pb && pb != pc && pa != pc) {
+					origins[kept / 3] = origins[t / 3];
+					result[kept++] = a;
+					result[kept++] = b;
+					result[kept++] = c;
+				}
+			}
+			result.resize(kept);
+			origins.resize(kept / 3);
+		}
+	}
+
+	static float pointTriangleDistance(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+		// closest point by the region p projects into (Ericson, Real-Time Collision Detection 5.1.5)
+		glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+		float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f) {
+			return glm::length(ap);
+		}
+		glm::vec3 bp = p - b;
+		float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3) {
+			return glm::length(bp);
+		}
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+			return glm::length(p - (a + ab * (d1 / (d1 - d3))));
+		}
+		glm::vec3 cp = p - c;
+		float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6) {
+			return glm::length(cp);
+		}
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+			return glm::length(p - (a + ac * (d2 / (d2 - d6))));
+		}
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+			return glm::length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+		}
+		float denominator = 1.0f / (va + vb + vc);
+		return glm::length(p - (a + ab * (vb * denominator) + ac * (vc * denominator)));
+	}
+
+	// the largest distance from a moved full mesh position to the level's triangles around where it
+	// and its neighbours went, which is where the surface it was on ended up
+	static float measureError(const vector<Vertex> &vertices, const Topology &topology, const Simplified &level) {
+		vector<unsigned int> sourceStart, sourceAdjacency, levelStart, levelAdjacency;
+		buildAdjacency(topology, topology.indices, sourceStart, sourceAdjacency);
+		buildAdjacency(topology, level.indices, levelStart, levelAdjacency);
+
+		float error = 0.0f;
+		vector<unsigned int> targets;
+		vector<unsigned int> checked(level.indices.size() / 3, ~0u); // the position a triangle was last measured against
+		for (unsigned int v = 0; v < vertices.size(); v++) {
+			if (topology.remap[v] != v || level.moved[v] == v) {
+				continue;
+			}
+			targets.clear();
+			for (unsigned int s = sourceStart[v]; s < sourceStart[v + 1]; s++) {
+				for (int k = 0; k < 3; k++) {
+					unsigned int target = level.moved[topology.remap[topology.indices[sourceAdjacency[s] + k]]];
+					if (find(targets.begin(), targets.end(), target) == targets.end()) {
+						targets.push_back(target);
+					}
+				}
+			}
+			float distance = FLT_MAX;
+			for (int i = 0; i < targets.size(); i++) {
+				for (unsigned int a = levelStart[targets[i]]; a < levelStart[targets[i] + 1]; a++) {
+					unsigned int first = levelAdjacency[a];
+					if (checked[first / 3] == v) {
+						continue;
+					}
+					checked[first / 3] = v;
+					const unsigned int *triangle = &level.indices[first];
+					distance = min(distance, pointTriangleDistance(vertices[v].Position,
+						vertices[triangle[0]].Position, vertices[triangle[1]].Position, vertices[triangle[2]].Position));
+				}
+			}
+			if (distance < FLT_MAX) {
+				error = max(error, distance);
+			}
+		}
+		return error;
+	}
+
+	// turns a level simplified by position back into vertices: a corner that stayed keeps its
+	// vertex, a moved one takes the vertex at its new position closest to its old attributes.
+	// Only vertices the full mesh draws qualify, the rest get dropped when it's reordered; with
+	// none at the new position the corner keeps its own vertex
+	static void resolveWedges(const vector<Vertex> &vertices, const Topology &topology, Simplified &level) {
+		vector<bool> drawn(vertices.size(), false);
+		for (size_t i = 0; i < topology.source.size(); i++) {
+			drawn[topology.source[i]] = true;
+		}
+		vector<unsigned int> &result = level.indices;
+		for (size_t i = 0; i < result.size(); i++) {
+			unsigned int original = topology.source[level.origins[i / 3] * 3 + i % 3];
+			if (topology.remap[original] == result[i]) {
+				result[i] = original;
+				continue;
+			}
+			const Vertex &wanted = vertices[original];
+			unsigned int best = original;
+			float bestDistance = FLT_MAX;
+			unsigned int candidate = result[i];
+			do {
+				glm::vec2 uv = vertices[candidate].TexCoords - wanted.TexCoords;
+				glm::vec3 normal = vertices[candidate].Normal - wanted.Normal;
+				float distance = glm::dot(uv, uv) + glm::dot(normal, normal);
+				if (drawn[candidate] && distance < bestDistance) {
+					best = candidate;
+					bestDistance = distance;
+				}
+				candidate = topology.wedge[candidate];
+			} while (candidate != result[i]);
+			result[i] = best;
+		}
+	}
+
+	// the candidate levels of one mesh, each aiming at LOD_TRIANGLE_RATIO of the one before
+	static void buildChain(const MeshData &mesh, double maxError, vector<MeshLod> &chain) {
+		Topology topology, byPosition; // the second built when a level first needs it
+		buildTopology(mesh, false, topology);
+		float ratio = 1.0f;
+		for (int level = 1; level < MESH_LOD_COUNT_MAX; level++) {
+			ratio *= LOD_TRIANGLE_RATIO;
+			size_t target = max((size_t)LOD_MIN_TRIANGLES, (size_t)(topology.indices.size() / 3 * ratio)) * 3;
+			Simplified simplified;
+			simplify(mesh.vertices, topology, target, maxError, simplified);
+			float error = measureError(mesh.vertices, topology, simplified);
+			if (simplified.indices.size() > target) {
+				if (byPosition.source.empty()) {
+					buildTopology(mesh, true, byPosition);
+				}
+				Simplified positional;
+				simplify(mesh.vertices, byPosition, target, maxError, positional);
+				if (positional.indices.size() < simplified.indices.size()) {
+					error = measureError(mesh.vertices, byPosition, positional);
+					resolveWedges(mesh.vertices, byPosition, positional);
+					simplified.indices.swap(positional.indices);
+				}
+			}
+			chain.push_back(MeshLod());
+			chain.back().indices.swap(simplified.indices);
+			// a coarser level never claims less error than the one before
+			chain.back().error = max(error, level > 1 ? chain[level - 2].error : 0.0f);
+		}
+	}
+
+	static void buildChains(const vector<MeshData> &meshes, size_t first, double maxError, vector<vector<MeshLod> > &chains, atomic<size_t> &next) {
+		for (size_t m = next++; m < chains.size(); m = next++) {
+			buildChain(meshes[first + m], maxError, chains[m]);
+		}
+	}
+
+public:
+	// adds the coarser levels to every mesh from first on, simplifying the meshes in parallel. A
+	// model's meshes get the same levels, with the same triangle ratios, so they switch together;
+	// the chain ends once a level stops paying off
+	static void buildLods(const string &path, vector<MeshData> &meshes, size_t first) {
+		glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+		size_t fullTriangles = 0;
+		for (size_t i = first; i < meshes.size(); i++) {
+			for (size_t v = 0; v < meshes[i].vertices.size(); v++) {
+				boundsMin = glm::min(boundsMin, meshes[i].vertices[v].Position);
+				boundsMax = glm::max(boundsMax, meshes[i].vertices[v].Position);
+			}
+			meshes[i].lods.clear();
+			fullTriangles += meshes[i].indices.size() / 3;
+		}
+		if (fullTriangles == 0) {
+			return;
+		}
+		double maxError = LOD_MAX_ERROR * glm::length(boundsMax - boundsMin);
+		maxError *= maxError;
+
+		vector<vector<MeshLod> > chains(meshes.size() - first);
+		atomic<size_t> next(0);
+		int workerCount = (int)min((size_t)max(1u, thread::hardware_concurrency()), chains.size());
+		vector<thread> workers;
+		for (int i = 0; i < workerCount; i++) {
+			workers.push_back(thread(buildChains, cref(meshes), first, maxError, ref(chains), ref(next)));
+		}
+		for (int i = 0; i < workers.size(); i++) {
+			workers[i].join();
+		}
+
+		size_t previousTriangles = fullTriangles;
+		for (int level = 1; level < MESH_LOD_COUNT_MAX; level++) {
+			size_t triangles = 0;
+			float error = 0.0f;
+			for (size_t m = 0; m < chains.size(); m++) {
+				triangles += chains[m][level - 1].indices.size() / 3;
+				error = max(error, chains[m][level - 1].error);
+			}
+			if (triangles > previousTriangles * LOD_MIN_REDUCTION) {
+				break;
+			}
+			for (size_t m = 0; m < chains.size(); m++) {
+				meshes[first + m].lods.push_back(MeshLod());
+				meshes[first + m].lods.back().indices.swap(chains[m][level - 1].indices);
+				meshes[first + m].lods.back().error = chains[m][level - 1].error;
+			}
+			logInfo(CATEGORY_ASSETS, "{} level of detail {}: {} of {} triangles, error {}", path, level, triangles, fullTriangles, error);
+			previousTriangles = triangles;
+		}
+	}
+};
+#endif
@@ -6,12 +6,17 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <stb_image.h>
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
+#include <glm/gtc/matrix_inverse.hpp>
 
 #include "mesh.h"
+#include "renderQueue.h"
+#include "lodSelector.h"
+#include "logger.h"
+#include "assetRegistry.h"
+#include "meshCache.h"
+#include "meshImporter.h"
+#include "textureCache.h"
+#include "textureBaker.h"
 
 #include <string>
 #include <fstream>
@@ -21,236 +26,348 @@
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+GLTexture TextureFromFile(const char *path, const string &directory, bool gamma = false);
+GLTexture TextureFromFile(const string &filename);
 
 class Model
 {
 public:
 	/*  Model Data */
-	vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+	vector<shared_ptr<GLTexture> > textureHandles;	// keeps the model's textures resident, they're shared through the asset registry
 	vector<Mesh> meshes;
 	string directory;
+	string path;
 	bool gammaCorrection;
+	bool keepGeometry; // the meshes keep a CPU copy of the full geometry, for fracturing or picking
+	glm::vec3 boundsMin; // model space box around every vertex, computed at import and stored in the mesh cache
+	glm::vec3 boundsMax;
+	vector<float> lodErrors; // per level of detail, the largest of its meshes' error bounds
 
 	/*  Functions   */
 	// constructor, expects a filepath to a 3D model.
-	Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+	Model(string const &path, bool gamma = false, bool keepGeometry = false) : path(path), gammaCorrection(gamma), keepGeometry(keepGeometry), boundsMin(0.0f), boundsMax(0.0f)
 	{
 		loadModel(path);
 	}
 
+	// brings back the CPU copy of the geometry for a model loaded without it, once someone needs it
+	bool retainGeometry()
+	{
+		if (keepGeometry)
+			return true;
+		MeshCache cache;
+		if (cache.open(path) && cache.getMeshCount() == meshes.size())
+		{
+			for (unsigned int i = 0; i < meshes.size(); i++)
+			{
+				meshes[i].vertices.assign(cache.getVertices(i), cache.getVertices(i) + cache.getVertexCount(i));
+				meshes[i].indices.assign(cache.getIndices(i), cache.getIndices(i) + cache.getLodIndexCount(i, 0));
+			}
+		}
+		else
+		{
+#ifdef ASSETS_COOKED_ONLY
+			return false;
+#else
+			vector<MeshData> imported;
+			if (!MeshImporter::import(path, imported) || imported.size() != meshes.size())
+				return false;
+			for (unsigned int i = 0; i < meshes.size(); i++)
+			{
+				meshes[i].vertices.swap(imported[i].vertices);
+				meshes[i].indices.swap(imported[i].indices);
+			}
+#endif
+		}
+		keepGeometry = true;
+		return true;
+	}
+
+	glm::vec3 getBoundsSize()
+	{
+		return boundsMax - boundsMin;
+	}
+
 	// draws the model, and thus all its meshes
-	void Draw(GLuint shaderID)
+	void Draw(GLuint shaderID, int lod = 0)
 	{
 		for (unsigned int i = 0; i < meshes.size(); i++)
-			meshes[i].Draw(shaderID);
+			meshes[i].Draw(shaderID, lod);
+	}
+
+	// the level of detail to draw the model with under transform, seen from eye; distance is
+	// taken to the nearest the model's bounds can get, so a level never pops in up close
+	int selectLod(const glm::mat4 &transform, glm::vec3 eye)
+	{
+		if (lodErrors.size() < 2)
+			return 0;
+		float scale = max(glm::length(glm::vec3(transform[0])), max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+		glm::vec3 center = glm::vec3(transform * glm::vec4(0.5f * (boundsMin + boundsMax), 1.0f));
+		float radius = 0.5f * glm::length(boundsMax - boundsMin) * scale;
+		return lodSelector().select(lodErrors, scale, glm::length(center - eye) - radius);
+	}
+
+	// triangles drawn for the model at a level of detail
+	unsigned int getTriangleCount(int lod = 0)
+	{
+		unsigned int triangles = 0;
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			triangles += meshes[i].getTriangleCount(lod);
+		return triangles;
 	}
 
 private:
 	/*  Functions   */
-	// loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+	// loads a model from its mesh cache if that's current, otherwise imports it and writes the cache
 	void loadModel(string const &path)
 	{
-		// read file via ASSIMP
-		Assimp::Importer importer;
-		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-		// check for errors
-		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
-		{
-			cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-			return;
-		}
 		// retrieve the directory path of the filepath
 		directory = path.substr(0, path.find_last_of('/'));
-
-		// process ASSIMP's root node recursively
-		processNode(scene->mRootNode, scene);
+		if (loadCached(path))
+			return;
+		importModel(path);
 	}
 
-	// processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-	void processNode(aiNode *node, const aiScene *scene)
+	// the cache is mapped and every mesh uploads straight from the mapping, nothing is parsed
+	bool loadCached(string const &path)
 	{
-		// process each mesh located at the current node
-		for (unsigned int i = 0; i < node->mNumMeshes; i++)
+		MeshCache cache;
+		if (!cache.open(path))
+			return false;
+		for (int i = 0; i < cache.getMeshCount(); i++)
 		{
-			// the node object only contains indices to index the actual objects in the scene. 
-			// the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-			meshes.push_back(processMesh(mesh, scene));
-		}
-		// after we've processed all of the meshes (if any) we then recursively process each of the children nodes
-		for (unsigned int i = 0; i < node->mNumChildren; i++)
-		{
-			processNode(node->mChildren[i], scene);
+			vector<Texture> textures = cache.getTextureReferences(i);
+			for (unsigned int t = 0; t < textures.size(); t++)
+				textures[t].id = acquireTexture(textures[t].path);
+			vector<unsigned int> lodIndexCounts;
+			vector<float> lodErrors;
+			for (int l = 0; l < cache.getLodCount(i); l++)
+			{
+				lodIndexCounts.push_back(cache.getLodIndexCount(i, l));
+				lodErrors.push_back(cache.getLodError(i, l));
+			}
+			meshes.push_back(Mesh(cache.getVertices(i), cache.getVertexCount(i), cache.getIndices(i), lodIndexCounts, lodErrors, textures, keepGeometry));
 		}
-
+		collectLodErrors();
+		boundsMin = cache.getBoundsMin();
+		boundsMax = cache.getBoundsMax();
+		return true;
 	}
 
-	Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+	// imports the source through MeshImporter (OBJ with ObjImporter, the rest with ASSIMP); the meshes
+	// are built from the imported data, which moves into them
+	bool importModel(string const &path)
 	{
-		// data to fill
-		vector<Vertex> vertices;
-		vector<unsigned int> indices;
-		vector<Texture> textures;
-
-		// Walk through each of the mesh's vertices
-		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+#ifdef ASSETS_COOKED_ONLY
+		logError(CATEGORY_ASSETS, "{} has not been cooked, run asteroids-cook", path);
+		return false;
+#else
+		vector<MeshData> imported;
+		if (!MeshImporter::import(path, imported))
+			return false;
+		computeBounds(imported, boundsMin, boundsMax);
+		MeshCache::store(path, imported, boundsMin, boundsMax);
+		for (unsigned int i = 0; i < imported.size(); i++)
 		{
-			Vertex vertex;
-			glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-							  // positions
-			vector.x = mesh->mVertices[i].x;
-			vector.y = mesh->mVertices[i].y;
-			vector.z = mesh->mVertices[i].z;
-			vertex.Position = vector;
-			// normals
-			vector.x = mesh->mNormals[i].x;
-			vector.y = mesh->mNormals[i].y;
-			vector.z = mesh->mNormals[i].z;
-			vertex.Normal = vector;
-			// texture coordinates
-			if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
-			{
-				glm::vec2 vec;
-				// a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
-				// use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-				vec.x = mesh->mTextureCoords[0][i].x;
-				vec.y = mesh->mTextureCoords[0][i].y;
-				vertex.TexCoords = vec;
-			}
-			else
-				vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-			// tangent
-			vector.x = mesh->mTangents[i].x;
-			vector.y = mesh->mTangents[i].y;
-			vector.z = mesh->mTangents[i].z;
-			vertex.Tangent = vector;
-			// bitangent
-			vector.x = mesh->mBitangents[i].x;
-			vector.y = mesh->mBitangents[i].y;
-			vector.z = mesh->mBitangents[i].z;
-			vertex.Bitangent = vector;
-			vertices.push_back(vertex);
+			for (unsigned int t = 0; t < imported[i].textures.size(); t++)
+				imported[i].textures[t].id = acquireTexture(imported[i].textures[t].path);
+			meshes.push_back(Mesh(std::move(imported[i].vertices), std::move(imported[i].indices), std::move(imported[i].textures), imported[i].lods));
+			if (!keepGeometry)
+				meshes.back().releaseGeometry();
 		}
-		// now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
-		for (unsigned int i = 0; i < mesh->mNumFaces; i++)
-		{
-			aiFace face = mesh->mFaces[i];
-			// retrieve all indices of the face and store them in the indices vector
-			for (unsigned int j = 0; j < face.mNumIndices; j++)
-				indices.push_back(face.mIndices[j]);
-		}
-		// process materials
-		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-		// we assume a convention for sampler names in the shaders. Each diffuse texture should be named
-		// as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
-		// Same applies to other texture as the following list summarizes:
-		// diffuse: texture_diffuseN
-		// specular: texture_specularN
-		// normal: texture_normalN
-
-		// 1. diffuse maps
-		vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-		// 2. specular maps
-		vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-		// 3. normal maps
-		std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-		// 4. height maps
-		std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
-		// return a mesh object created from the extracted mesh data
-		return Mesh(vertices, indices, textures);
+		collectLodErrors();
+		return true;
+#endif
 	}
 
-	// checks all material textures of a given type and loads the textures if they're not loaded yet.
-	// the required info is returned as a Texture struct.
-	vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+	// the importer gives every mesh of a model the same levels, so they switch together
+	void collectLodErrors()
 	{
-		vector<Texture> textures;
-		for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+		lodErrors.clear();
+		for (unsigned int i = 0; i < meshes.size(); i++)
 		{
-			aiString str;
-			mat->GetTexture(type, i, &str);
-			// check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-			bool skip = false;
-			for (unsigned int j = 0; j < textures_loaded.size(); j++)
+			for (unsigned int l = 0; l < meshes[i].lodRanges.size(); l++)
 			{
-				if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-				{
-					textures.push_back(textures_loaded[j]);
-					skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-					break;
-				}
-			}
-			if (!skip)
-			{   // if texture hasn't been loaded already, load it
-				Texture texture;
-				texture.id = TextureFromFile(str.C_Str(), this->directory);
-				texture.type = typeName;
-				texture.path = str.C_Str();
-				textures.push_back(texture);
-				textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+				if (l >= lodErrors.size())
+					lodErrors.push_back(0.0f);
+				lodErrors[l] = max(lodErrors[l], meshes[i].lodRanges[l].error);
 			}
 		}
-		return textures;
+	}
+
+	// path is relative to the model's directory
+	GLuint acquireTexture(const string &path)
+	{
+		shared_ptr<GLTexture> handle = assets().texture(this->directory + '/' + path);
+		textureHandles.push_back(handle);
+		return *handle;
 	}
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+GLTexture TextureFromFile(const char *path, const string &directory, bool gamma)
 {
 	string filename = string(path);
 	filename = directory + '/' + filename;
+	return TextureFromFile(filename);
+}
 
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
+// S3TC is an extension, though every desktop driver exposes it
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
 
-	int width, height, nrComponents;
-	unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-	if (!data) {
-		cout << "ERROR: " << stbi_failure_reason() << endl;
-		//throw stbi_failure_reason();
+bool textureCompressionSupported()
+{
+	static int supported = -1;
+	if (supported < 0)
+	{
+		supported = 0;
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+			if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), "GL_EXT_texture_compression_s3tc") == 0)
+				supported = 1;
 	}
-		
-	if (data)
+	return supported == 1;
+}
+
+// one precomputed level of a baked texture into target, GL_TEXTURE_2D or a cubemap face
+void uploadTextureLevel(GLenum target, int level, int format, int width, int height, const unsigned char *data, size_t size)
+{
+	static const GLenum formats[TEXTURE_FORMAT_COUNT] = { GL_RED, GL_RGB, GL_RGBA, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT };
+	if (isCompressedTextureFormat(format))
+		glCompressedTexImage2D(target, level, formats[format], width, height, 0, (GLsizei)size, data);
+	else
+		glTexImage2D(target, level, formats[format], width, height, 0, formats[format], GL_UNSIGNED_BYTE, data);
+}
+
+// uploads every level of filename's baked copy into target, returns the bytes uploaded. A current
+// cache uploads straight from its mapping; without one the image is baked (uncompressed) and
+// stored first, so that happens only once.
+size_t uploadBakedTexture(GLenum target, const string &filename, int &levelCount)
+{
+	levelCount = 0;
+	size_t size = 0;
+	TextureCache cache;
+	TextureImage image;
+	if (!TextureBaker::load(filename, textureCompressionSupported(), cache, image))
+		return 0;
+	GLint alignment = glState().unpackAlignment(1); // levels are tightly packed, small ones have odd row sizes
+	if (cache.isOpen())
 	{
-		GLenum format;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
+		for (levelCount = 0; levelCount < cache.getLevelCount(); levelCount++)
+		{
+			uploadTextureLevel(target, levelCount, cache.getFormat(), cache.getLevelWidth(levelCount), cache.getLevelHeight(levelCount),
+				cache.getLevelData(levelCount), cache.getLevelSize(levelCount));
+			size += cache.getLevelSize(levelCount);
+		}
 	}
 	else
 	{
-		std::cout << "Texture failed to load at path: " << filename << std::endl;
-		stbi_image_free(data);
+		for (levelCount = 0; levelCount < image.levels.size(); levelCount++)
+		{
+			const TextureLevel &level = image.levels[levelCount];
+			uploadTextureLevel(target, levelCount, image.format, level.width, level.height, &level.data[0], level.data.size());
+			size += level.data.size();
+		}
+	}
+	glState().unpackAlignment(alignment);
+	return size;
+}
+
+// sampling of a texture with levelCount baked levels; 2D textures repeat, cubemaps clamp
+void setBakedTextureParameters(GLenum target, int levelCount)
+{
+	levelCount = max(levelCount, 1);
+	GLint wrap = target == GL_TEXTURE_CUBE_MAP ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, wrap);
+	if (target == GL_TEXTURE_CUBE_MAP)
+		glTexParameteri(target, GL_TEXTURE_WRAP_R, wrap);
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+GLTexture TextureFromFile(const string &filename)
+{
+	GLTexture textureID = GLTexture::create();
+	glState().bindTexture(0, GL_TEXTURE_2D, textureID);
+
+	int levelCount;
+	size_t size = uploadBakedTexture(GL_TEXTURE_2D, filename, levelCount);
+	if (levelCount > 0)
+	{
+		textureID.setSize(size);
+		setBakedTextureParameters(GL_TEXTURE_2D, levelCount);
 	}
 
 	return textureID;
 }
 
+// loads a cubemap texture from 6 individual texture faces, each with its baked mip chain
+// order:
+// +X (right)
+// -X (left)
+// +Y (top)
+// -Y (bottom)
+// +Z (front) 
+// -Z (back)
+// -------------------------------------------------------
+GLTexture loadCubemap(const vector<std::string> &faces)
+{
+	GLTexture textureID = GLTexture::create();
+	glState().bindTexture(0, GL_TEXTURE_CUBE_MAP, textureID);
+
+	size_t size = 0;
+	int levelCount = TEXTURE_CACHE_MAX_LEVELS;
+	for (unsigned int i = 0; i < faces.size(); i++)
+	{
+		int faceLevels;
+		size += uploadBakedTexture(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, faces[i], faceLevels);
+		levelCount = min(levelCount, faceLevels);
+	}
+	setBakedTextureParameters(GL_TEXTURE_CUBE_MAP, levelCount);
+	textureID.setSize(size);
+
+	return textureID;
+}
+
+// the registry's loaders, defined here where the types they load are complete
+inline shared_ptr<Model> AssetRegistry::model(const string &path, bool keepGeometry)
+{
+	shared_ptr<Model> model = models.get(canonicalAssetPath(path), [&path, keepGeometry]() {
+		logInfo(CATEGORY_ASSETS, "loading model {}", path);
+		return make_shared<Model>(path, false, keepGeometry);
+	});
+	// loaded earlier by someone who only draws it
+	if (keepGeometry && !model->retainGeometry())
+		logError(CATEGORY_ASSETS, "could not reload the geometry of {}", path);
+	return model;
+}
+
+inline shared_ptr<GLTexture> AssetRegistry::texture(const string &path)
+{
+	return textures.get(canonicalAssetPath(path), [&path]() {
+		return make_shared<GLTexture>(TextureFromFile(path));
+	});
+}
+
+inline shared_ptr<GLTexture> AssetRegistry::cubemap(const vector<string> &faces)
+{
+	return cubemaps.get(cubemapKey(faces), [&faces]() {
+		return make_shared<GLTexture>(loadCubemap(faces));
+	});
+}
+
 
 class DrawObject {
 
 	public :
 		virtual void draw() = 0;
+		virtual void submit(RenderQueue &queue, const glm::mat4 &transform, GLuint shaderProgram, GLint modelLocation, GLint normalMatrixLocation) {}
 };
 
 class DrawModel : public DrawObject {
@@ -265,6 +382,12 @@ class DrawModel : public DrawObject {
 	void draw(){
 		this->model->Draw(shaderProgram);
 	}
+	void submit(RenderQueue &queue, const glm::mat4 &transform, GLuint shaderProgram, GLint modelLocation, GLint normalMatrixLocation) {
+		int lod = this->model->selectLod(transform, queue.getEye());
+		for (unsigned int i = 0; i < this->model->meshes.size(); i++) {
+			queue.submit(PASS_OPAQUE, shaderProgram, modelLocation, normalMatrixLocation, &this->model->meshes[i], transform, lod);
+		}
+	}
 };
 
 class DrawGeneratedObject : public DrawObject {
@@ -293,6 +416,7 @@ class GraphNode
 		glm::mat4 localTransform;
 		DrawObject *model;
 		GLuint modelUniformLoc;
+		GLint normalMatrixUniformLoc;
 		GLuint shaderProgram;
 
 	public:
@@ -301,6 +425,7 @@ class GraphNode
 			this->localTransform = localTransform;
 			this->parentTransform = glm::mat4(1);
 			this->modelUniformLoc = glGetUniformLocation(shaderProgram, "model");;
+			this->normalMatrixUniformLoc = glGetUniformLocation(shaderProgram, "normalMatrix");
 			this->shaderProgram = shaderProgram;
 		}
 		void addChildren(GraphNode *children) {
@@ -308,8 +433,12 @@ class GraphNode
 			this->children.push_back(children);	
 		}
 		void draw() {
-			glUseProgram(this->shaderProgram);
-			glUniformMatrix4fv(modelUniformLoc, 1, GL_FALSE, glm::value_ptr(parentTransform * localTransform));
+			glState().useProgram(this->shaderProgram);
+			glm::mat4 transform = parentTransform * localTransform;
+			glUniformMatrix4fv(modelUniformLoc, 1, GL_FALSE, glm::value_ptr(transform));
+			if (normalMatrixUniformLoc >= 0) {
+				glUniformMatrix3fv(normalMatrixUniformLoc, 1, GL_FALSE, glm::value_ptr(glm::inverseTranspose(glm::mat3(transform))));
+			}
 			this->model->draw();
 			for each (GraphNode *child in this->children)
 			{
@@ -317,14 +446,16 @@ class GraphNode
 				child->draw();
 			}
 		}
-		glm::mat4 getLocalTransform() {
-			for (int i = 0; i < 4; i++) {
-				for (int j = 0; j < 4; j++) {
-					std::cout << parentTransform[i][j] << " ";
-				}
-				cout << endl;
+		// same traversal as draw(), but the draws go to the queue to be sorted
+		void submit(RenderQueue &queue) {
+			this->model->submit(queue, parentTransform * localTransform, this->shaderProgram, this->modelUniformLoc, this->normalMatrixUniformLoc);
+			for each (GraphNode *child in this->children)
+			{
+				child->parentTransform = this->parentTransform * this->localTransform;
+				child->submit(queue);
 			}
-			
+		}
+		glm::mat4 getLocalTransform() {
 			return localTransform;
 		}
 		glm::mat4 getTransform() {
@@ -341,6 +472,7 @@ class GraphNode
 		void setShader(GLuint shaderProgram) {
 			this->shaderProgram = shaderProgram;
 			this->modelUniformLoc = glGetUniformLocation(shaderProgram, "model");
+			this->normalMatrixUniformLoc = glGetUniformLocation(shaderProgram, "normalMatrix");
 		}
 
 
@@ -0,0 +1,782 @@
+#pragma once
+#ifndef OBJ_IMPORTER_H
+#define OBJ_IMPORTER_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "meshData.h"
+#include "vfs.h"
+#include "logger.h"
+using namespace std;
+
+const size_t OBJ_CHUNK_MIN_SIZE = 256 * 1024; // smaller files parse on one thread
+
+// Wavefront OBJ/MTL straight into MeshData, for the one format nearly every model of ours is in.
+// The file is split at line breaks into one chunk per core and the chunks are parsed in parallel;
+// a short sequential pass resolves their indices and cuts the faces into meshes, which are then
+// deduplicated and given tangents in parallel too. The result is what MeshImporter gets from
+// ASSIMP with Triangulate, FlipUVs and CalcTangentSpace: same meshes, same triangles in the same
+// order, same materials, except that corners sharing position, texture coordinates and normal
+// share one vertex.
+class ObjImporter {
+private:
+	// attribute indices of one triangle corner, 0-based; -1 when the face doesn't give one
+	struct Corner {
+		int position;
+		int texCoord;
+		int normal;
+
+		bool operator==(const Corner &other) const {
+			return position == other.position && texCoord == other.texCoord && normal == other.normal;
+		}
+	};
+
+	struct CornerHash {
+		size_t operator()(const Corner &corner) const {
+			unsigned long long key = (unsigned long long)(unsigned int)corner.position * 0x9E3779B97F4A7C15ull;
+			key ^= ((unsigned long long)(unsigned int)corner.texCoord + (key << 6) + (key >> 2)) * 0xC2B2AE3D27D4EB4Full;
+			key ^= ((unsigned long long)(unsigned int)corner.normal + (key << 6) + (key >> 2)) * 0x165667B19E3779F9ull;
+			return (size_t)(key ^ (key >> 29));
+		}
+	};
+
+	// corner to vertex id, open addressing with linear probing. A node per corner, as in an
+	// unordered_map, made the dedup of a large file slower than all of the parsing.
+	class CornerTable {
+	private:
+		vector<Corner> keys; // position -1 marks a free slot
+		vector<unsigned int> ids;
+		size_t count;
+
+		size_t find(const Corner &corner) const {
+			size_t mask = keys.size() - 1;
+			size_t slot = CornerHash()(corner) & mask;
+			while (keys[slot].position != -1 && !(keys[slot] == corner)) {
+				slot = (slot + 1) & mask;
+			}
+			return slot;
+		}
+
+		void grow() {
+			vector<Corner> oldKeys;
+			vector<unsigned int> oldIds;
+			oldKeys.swap(keys);
+			oldIds.swap(ids);
+			Corner free = { -1, -1, -1 };
+			keys.assign(oldKeys.size() * 2, free);
+			ids.resize(oldKeys.size() * 2);
+			for (size_t i = 0; i < oldKeys.size(); i++) {
+				if (oldKeys[i].position != -1) {
+					size_t slot = find(oldKeys[i]);
+					keys[slot] = oldKeys[i];
+					ids[slot] = oldIds[i];
+				}
+			}
+		}
+
+	public:
+		CornerTable() {
+			clear();
+		}
+
+		void clear() {
+			Corner free = { -1, -1, -1 };
+			keys.assign(1024, free);
+			ids.resize(1024);
+			count = 0;
+		}
+
+		// the id the corner already has, or id if it's new, which added then says
+		unsigned int insert(const Corner &corner, unsigned int id, bool &added) {
+			if ((count + 1) * 2 > keys.size()) {
+				grow();
+			}
+			size_t slot = find(corner);
+			added = keys[slot].position == -1;
+			if (added) {
+				keys[slot] = corner;
+				ids[slot] = id;
+				count++;
+			}
+			return ids[slot];
+		}
+	};
+
+	enum EventType { EVENT_OBJECT, EVENT_MATERIAL, EVENT_LIBRARY };
+
+	// a statement that changes what the following faces belong to
+	struct Event {
+		EventType type;
+		string name;
+		size_t face; // faces before it in its chunk
+	};
+
+	// everything one chunk of lines declares. Relative (negative) indices can only be resolved
+	// once the earlier chunks are counted, they are local until then and listed in fixups.
+	struct Chunk {
+		const char *begin;
+		const char *end;
+		vector<glm::vec3> positions;
+		vector<glm::vec2> texCoords;
+		vector<glm::vec3> normals;
+		vector<Corner> corners;    // every face's, in order
+		vector<size_t> faceStarts; // where each face's corners start
+		vector<size_t> fixups;     // corner * 3 + attribute
+		vector<Event> events;
+		bool failed;
+		int failedLine;
+	};
+
+	struct Material {
+		vector<Texture> textures;
+	};
+
+	static bool isBlank(char c) {
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	static void skipBlanks(const char *&cursor, const char *end) {
+		while (cursor < end && isBlank(*cursor)) {
+			cursor++;
+		}
+	}
+
+	// exact for up to 15 significant digits and a decimal exponent within 22, which is every
+	// number exporters write; the rest goes through strtod
+	static bool parseFloat(const char *&cursor, const char *end, float &value) {
+		static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+		skipBlanks(cursor, end);
+		const char *start = cursor;
+		bool negative = false;
+		if (cursor < end && (*cursor == '-' || *cursor == '+')) {
+			negative = *cursor == '-';
+			cursor++;
+		}
+		unsigned long long mantissa = 0;
+		int digits = 0, exponent = 0;
+		bool any = false;
+		for (; cursor < end && *cursor >= '0' && *cursor <= '9'; cursor++, any = true) {
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*cursor - '0');
+				digits += mantissa != 0;
+			}
+			else {
+				exponent++;
+			}
+		}
+		if (cursor < end && *cursor == '.') {
+			for (cursor++; cursor < end && *cursor >= '0' && *cursor <= '9'; cursor++, any = true) {
+				if (digits < 19) {
+					mantissa = mantissa * 10 + (*cursor - '0');
+					digits += mantissa != 0;
+					exponent--;
+				}
+			}
+		}
+		if (any && cursor < end && (*cursor == 'e' || *cursor == 'E')) {
+			const char *exponentStart = cursor++;
+			bool negativeExponent = false;
+			if (cursor < end && (*cursor == '-' || *cursor == '+')) {
+				negativeExponent = *cursor == '-';
+				cursor++;
+			}
+			if (cursor < end && *cursor >= '0' && *cursor <= '9') {
+				int written = 0;
+				for (; cursor < end && *cursor >= '0' && *cursor <= '9'; cursor++) {
+					written = min(written * 10 + (*cursor - '0'), 100000);
+				}
+				exponent += negativeExponent ? -written : written;
+			}
+			else {
+				cursor = exponentStart;
+			}
+		}
+		if (any && digits <= 15 && exponent >= -22 && exponent <= 22) {
+			double result = (double)mantissa;
+			result = exponent < 0 ? result / powers[-exponent] : result * powers[exponent];
+			value = (float)(negative ? -result : result);
+			return true;
+		}
+		// long mantissas, huge exponents, inf and nan
+		char token[64];
+		size_t length = 0;
+		for (cursor = start; cursor < end && !isBlank(*cursor) && length < sizeof(token) - 1; cursor++) {
+			token[length++] = *cursor;
+		}
+		token[length] = '\0';
+		char *parsed;
+		value = (float)strtod(token, &parsed);
+		return parsed != token;
+	}
+
+	static bool parseInt(const char *&cursor, const char *end, int &value) {
+		bool negative = false;
+		if (cursor < end && (*cursor == '-' || *cursor == '+')) {
+			negative = *cursor == '-';
+			cursor++;
+		}
+		if (cursor == end || *cursor < '0' || *cursor > '9') {
+			return false;
+		}
+		int result = 0, digits = 0;
+		for (; cursor < end && *cursor >= '0' && *cursor <= '9'; cursor++) {
+			result = result * 10 + (*cursor - '0');
+			if (++digits > 9) {
+				return false; // past 999999999 vertices
+			}
+		}
+		value = negative ? -result : result;
+		return true;
+	}
+
+	// the rest of the line without surrounding blanks
+	static string restOfLine(const char *cursor, const char *end) {
+		skipBlanks(cursor, end);
+		while (end > cursor && isBlank(end[-1])) {
+			end--;
+		}
+		return string(cursor, end);
+	}
+
+	static bool startsWith(const char *cursor, const char *end, const char *keyword) {
+		size_t length = strlen(keyword);
+		return (size_t)(end - cursor) > length && memcmp(cursor, keyword, length) == 0 && isBlank(cursor[length]);
+	}
+
+	// "v", "v/t", "v//n" or "v/t/n"; 1-based from the start of the file, or negative from the end so far
+	static bool parseCorner(const char *&cursor, const char *end, const Chunk &chunk, Corner &corner, int &relative) {
+		int *attributes[3] = { &corner.position, &corner.texCoord, &corner.normal };
+		size_t counts[3] = { chunk.positions.size(), chunk.texCoords.size(), chunk.normals.size() };
+		corner.position = corner.texCoord = corner.normal = -1;
+		relative = 0;
+		for (int a = 0; a < 3; a++) {
+			if (a > 0) {
+				if (cursor == end || *cursor != '/') {
+					break;
+				}
+				cursor++;
+				if (cursor == end || *cursor == '/' || isBlank(*cursor)) {
+					continue; // "v//n", or "v/" with nothing after it
+				}
+			}
+			int index;
+			if (!parseInt(cursor, end, index) || index == 0) {
+				return false;
+			}
+			if (index > 0) {
+				*attributes[a] = index - 1;
+			}
+			else {
+				*attributes[a] = (int)counts[a] + index;
+				relative |= 1 << a;
+			}
+		}
+		return cursor == end || isBlank(*cursor);
+	}
+
+	static bool parseLine(const char *cursor, const char *end, Chunk &chunk) {
+		skipBlanks(cursor, end);
+		if (cursor == end || *cursor == '#') {
+			return true;
+		}
+		// the statements every line of a large file is, checked first
+		bool vertex = end - cursor > 1 && cursor[0] == 'v';
+		if (vertex && isBlank(cursor[1])) {
+			glm::vec3 position;
+			cursor += 1;
+			bool parsed = parseFloat(cursor, end, position.x) && parseFloat(cursor, end, position.y) && parseFloat(cursor, end, position.z);
+			chunk.positions.push_back(position); // a trailing w or vertex colour is ignored
+			return parsed;
+		}
+		if (vertex && cursor[1] == 't' && startsWith(cursor, end, "vt")) {
+			glm::vec2 texCoord(0.0f);
+			cursor += 2;
+			bool parsed = parseFloat(cursor, end, texCoord.x);
+			skipBlanks(cursor, end);
+			if (parsed && cursor < end) {
+				parsed = parseFloat(cursor, end, texCoord.y);
+			}
+			texCoord.y = 1.0f - texCoord.y; // aiProcess_FlipUVs
+			chunk.texCoords.push_back(texCoord);
+			return parsed;
+		}
+		if (vertex && cursor[1] == 'n' && startsWith(cursor, end, "vn")) {
+			glm::vec3 normal;
+			cursor += 2;
+			bool parsed = parseFloat(cursor, end, normal.x) && parseFloat(cursor, end, normal.y) && parseFloat(cursor, end, normal.z);
+			chunk.normals.push_back(normal);
+			return parsed;
+		}
+		if (end - cursor > 1 && cursor[0] == 'f' && isBlank(cursor[1])) {
+			cursor += 1;
+			size_t faceStart = chunk.corners.size();
+			for (skipBlanks(cursor, end); cursor < end; skipBlanks(cursor, end)) {
+				Corner corner;
+				int relative;
+				if (!parseCorner(cursor, end, chunk, corner, relative)) {
+					return false;
+				}
+				for (int a = 0; a < 3; a++) {
+					if (relative & (1 << a)) {
+						chunk.fixups.push_back(chunk.corners.size() * 3 + a);
+					}
+				}
+				chunk.corners.push_back(corner);
+			}
+			if (chunk.corners.size() - faceStart < 3) {
+				return false;
+			}
+			chunk.faceStarts.push_back(faceStart);
+			return true;
+		}
+		if (startsWith(cursor, end, "o") || startsWith(cursor, end, "g")) {
+			Event event = { EVENT_OBJECT, restOfLine(cursor + 1, end), chunk.faceStarts.size() };
+			chunk.events.push_back(event);
+			return true;
+		}
+		if (startsWith(cursor, end, "usemtl")) {
+			Event event = { EVENT_MATERIAL, restOfLine(cursor + 6, end), chunk.faceStarts.size() };
+			chunk.events.push_back(event);
+			return true;
+		}
+		if (startsWith(cursor, end, "mtllib")) {
+			Event event = { EVENT_LIBRARY, restOfLine(cursor + 6, end), chunk.faceStarts.size() };
+			chunk.events.push_back(event);
+			return true;
+		}
+		return true; // smoothing groups, lines, points and free-form geometry aren't imported
+	}
+
+	static void parseChunk(Chunk &chunk) {
+		chunk.failed = false;
+		int line = 1;
+		for (const char *cursor = chunk.begin; cursor < chunk.end; line++) {
+			const char *lineEnd = (const char*)memchr(cursor, '\n', chunk.end - cursor);
+			if (lineEnd == NULL) {
+				lineEnd = chunk.end;
+			}
+			if (!parseLine(cursor, lineEnd, chunk) && !chunk.failed) {
+				chunk.failed = true;
+				chunk.failedLine = line;
+			}
+			cursor = lineEnd + 1;
+		}
+	}
+
+	static string directoryOf(const string &path) {
+		size_t slash = path.find_last_of("/\\");
+		return slash == string::npos ? "" : path.substr(0, slash + 1);
+	}
+
+	// the texture types MeshImporter reads from ASSIMP's materials, in its order: map_Kd, map_Ks,
+	// bump (ASSIMP's height) and map_Ka (ambient). A map's options come before its file name.
+	static void loadLibrary(const string &path, map<string, Material> &materials) {
+		VfsFile file;
+		if (!vfs().open(path, file)) {
+			logWarning(CATEGORY_ASSETS, "material library {} not found", path);
+			return;
+		}
+		static const char *const keywords[] = { "map_Kd", "map_Ks", "map_bump", "map_Bump", "bump", "map_Ka" };
+		static const char *const types[] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_normal", "texture_normal", "texture_height" };
+		static const int order[] = { 0, 1, 2, 2, 2, 3 };
+		Material *material = NULL;
+		const char *cursor = (const char*)file.getData(), *end = cursor + file.getSize();
+		while (cursor < end) {
+			const char *lineEnd = (const char*)memchr(cursor, '\n', end - cursor);
+			if (lineEnd == NULL) {
+				lineEnd = end;
+			}
+			const char *line = cursor;
+			skipBlanks(line, lineEnd);
+			if (startsWith(line, lineEnd, "newmtl")) {
+				material = &materials[restOfLine(line + 6, lineEnd)];
+				material->textures.clear();
+			}
+			for (int k = 0; k < 6 && material != NULL; k++) {
+				if (startsWith(line, lineEnd, keywords[k])) {
+					string arguments = restOfLine(line + strlen(keywords[k]), lineEnd);
+					size_t blank = arguments.find_last_of(" \t");
+					Texture texture;
+					texture.id = 0;
+					texture.type = types[k];
+					texture.path = blank == string::npos ? arguments : arguments.substr(blank + 1);
+					// keep the four types in order whatever order the library lists them in
+					vector<Texture>::iterator at = material->textures.begin();
+					while (at != material->textures.end() && typeOrder(at->type) <= order[k]) {
+						++at;
+					}
+					material->textures.insert(at, texture);
+				}
+			}
+			cursor = lineEnd + 1;
+		}
+	}
+
+	static int typeOrder(const string &type) {
+		return type == "texture_diffuse" ? 0 : type == "texture_specular" ? 1 : type == "texture_normal" ? 2 : 3;
+	}
+
+	// per-face tangent and bitangent the way CalcTangentSpace computes them, made orthogonal to
+	// each corner's normal. CalcTangentSpace then averages them at a vertex only where they are
+	// within 45 degrees of each other; here too, and a vertex whose faces disagree more (a mirrored
+	// UV seam) is split, one copy per direction.
+	static void computeTangents(MeshData &mesh) {
+		const float limit = cos(glm::radians(45.0f));
+		vector<glm::vec3> cornerTangents(mesh.indices.size()), cornerBitangents(mesh.indices.size());
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+			const Vertex &v0 = mesh.vertices[mesh.indices[i]], &v1 = mesh.vertices[mesh.indices[i + 1]], &v2 = mesh.vertices[mesh.indices[i + 2]];
+			glm::vec3 v = v1.Position - v0.Position, w = v2.Position - v0.Position;
+			float sx = v1.TexCoords.x - v0.TexCoords.x, sy = v1.TexCoords.y - v0.TexCoords.y;
+			float tx = v2.TexCoords.x - v0.TexCoords.x, ty = v2.TexCoords.y - v0.TexCoords.y;
+			float direction = (tx * sy - ty * sx) < 0.0f ? -1.0f : 1.0f;
+			if (sx * ty == sy * tx) {
+				sx = 0.0f;
+				sy = 1.0f;
+				tx = 1.0f;
+				ty = 0.0f;
+			}
+			glm::vec3 tangent = (w * sy - v * ty) * direction;
+			glm::vec3 bitangent = (w * sx - v * tx) * direction;
+			for (int c = 0; c < 3; c++) {
+				glm::vec3 normal = mesh.vertices[mesh.indices[i + c]].Normal;
+				glm::vec3 localTangent = tangent - normal * glm::dot(tangent, normal);
+				glm::vec3 localBitangent = bitangent - normal * glm::dot(bitangent, normal);
+				float tangentLength = glm::length(localTangent), bitangentLength = glm::length(localBitangent);
+				bool validTangent = tangentLength > 0.0f && tangentLength == tangentLength;
+				bool validBitangent = bitangentLength > 0.0f && bitangentLength == bitangentLength;
+				localTangent = validTangent ? localTangent / tangentLength : glm::vec3(0.0f);
+				localBitangent = validBitangent ? localBitangent / bitangentLength : glm::vec3(0.0f);
+				// one of them degenerate: rebuilt from the normal and the other one
+				if (validTangent && !validBitangent) {
+					localBitangent = glm::normalize(glm::cross(localTangent, normal));
+				}
+				else if (validBitangent && !validTangent) {
+					localTangent = glm::normalize(glm::cross(normal, localBitangent));
+				}
+				cornerTangents[i + c] = localTangent;
+				cornerBitangents[i + c] = localBitangent;
+			}
+		}
+
+		// each vertex's corners, grouped by vertex
+		vector<unsigned int> firstCorner(mesh.vertices.size() + 1, 0), corners(mesh.indices.size());
+		for (size_t i = 0; i < mesh.indices.size(); i++) {
+			firstCorner[mesh.indices[i] + 1]++;
+		}
+		for (size_t v = 0; v < mesh.vertices.size(); v++) {
+			firstCorner[v + 1] += firstCorner[v];
+		}
+		vector<unsigned int> filled(firstCorner.begin(), firstCorner.end() - 1);
+		for (size_t i = 0; i < mesh.indices.size(); i++) {
+			corners[filled[mesh.indices[i]]++] = (unsigned int)i;
+		}
+
+		size_t vertexCount = mesh.vertices.size();
+		vector<unsigned int> groups; // seed corners
+		for (size_t v = 0; v < vertexCount; v++) {
+			// greedy groups in corner order, each seeded by its first corner; group 0 keeps the
+			// vertex, the others get copies from base on
+			groups.clear();
+			size_t base = mesh.vertices.size();
+			for (unsigned int k = firstCorner[v]; k < firstCorner[v + 1]; k++) {
+				unsigned int corner = corners[k];
+				size_t g = 0;
+				while (g < groups.size() && (glm::dot(cornerTangents[groups[g]], cornerTangents[corner]) < limit
+					|| glm::dot(cornerBitangents[groups[g]], cornerBitangents[corner]) < limit)) {
+					g++;
+				}
+				if (g == groups.size()) {
+					groups.push_back(corner);
+					if (g > 0) {
+						mesh.vertices.push_back(mesh.vertices[v]);
+					}
+				}
+				mesh.indices[corner] = (unsigned int)(g == 0 ? v : base + g - 1);
+			}
+			for (size_t g = 0; g < groups.size(); g++) {
+				Vertex &vertex = mesh.vertices[g == 0 ? v : base + g - 1];
+				vertex.Tangent = glm::vec3(0.0f);
+				vertex.Bitangent = glm::vec3(0.0f);
+			}
+			for (unsigned int k = firstCorner[v]; k < firstCorner[v + 1]; k++) {
+				Vertex &vertex = mesh.vertices[mesh.indices[corners[k]]];
+				vertex.Tangent += cornerTangents[corners[k]];
+				vertex.Bitangent += cornerBitangents[corners[k]];
+			}
+			for (size_t g = 0; g < groups.size(); g++) {
+				Vertex &vertex = mesh.vertices[g == 0 ? v : base + g - 1];
+				float tangentLength = glm::length(vertex.Tangent), bitangentLength = glm::length(vertex.Bitangent);
+				vertex.Tangent = tangentLength > 0.0f ? vertex.Tangent / tangentLength : glm::vec3(0.0f);
+				vertex.Bitangent = bitangentLength > 0.0f ? vertex.Bitangent / bitangentLength : glm::vec3(0.0f);
+			}
+		}
+	}
+
+	// corners without a normal get the normalized sum of their faces' normals
+	static void computeMissingNormals(MeshData &mesh, const vector<bool> &missing) {
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+			const glm::vec3 &p0 = mesh.vertices[mesh.indices[i]].Position;
+			glm::vec3 faceNormal = glm::cross(mesh.vertices[mesh.indices[i + 1]].Position - p0, mesh.vertices[mesh.indices[i + 2]].Position - p0);
+			float length = glm::length(faceNormal);
+			for (int c = 0; c < 3 && length > 0.0f; c++) {
+				if (missing[mesh.indices[i + c]]) {
+					mesh.vertices[mesh.indices[i + c]].Normal += faceNormal / length;
+				}
+			}
+		}
+		for (size_t i = 0; i < mesh.vertices.size(); i++) {
+			float length = glm::length(mesh.vertices[i].Normal);
+			if (missing[i] && length > 0.0f) {
+				mesh.vertices[i].Normal /= length;
+			}
+		}
+	}
+
+	// one mesh to build: runs of faces, possibly in several chunks, and its material
+	struct MeshJob {
+		struct Segment {
+			const Chunk *chunk;
+			size_t begin;
+			size_t end;
+		};
+		vector<Segment> segments;
+		const Material *material;
+		MeshData mesh;
+		bool valid;
+	};
+
+	// every chunk's attributes, in file order
+	struct Attributes {
+		vector<glm::vec3> positions;
+		vector<glm::vec2> texCoords;
+		vector<glm::vec3> normals;
+	};
+
+	// triangles the way ASSIMP's Triangulate cuts a polygon: a quad is fanned from its concave
+	// corner if it has one, others from their first corner (ASSIMP ear-clips polygons of five
+	// or more corners, which cuts the same surface differently)
+	static void triangulate(const vector<unsigned int> &polygon, MeshData &mesh) {
+		size_t start = 0;
+		if (polygon.size() == 4) {
+			for (size_t i = 0; i < 4; i++) {
+				glm::vec3 corner = mesh.vertices[polygon[i]].Position;
+				glm::vec3 left = glm::normalize(mesh.vertices[polygon[(i + 3) % 4]].Position - corner);
+				glm::vec3 diagonal = glm::normalize(mesh.vertices[polygon[(i + 2) % 4]].Position - corner);
+				glm::vec3 right = glm::normalize(mesh.vertices[polygon[(i + 1) % 4]].Position - corner);
+				if (acos(glm::dot(left, diagonal)) + acos(glm::dot(right, diagonal)) > glm::pi<float>()) {
+					start = i;
+					break;
+				}
+			}
+		}
+		for (size_t k = 2; k < polygon.size(); k++) {
+			mesh.indices.push_back(polygon[start]);
+			mesh.indices.push_back(polygon[(start + k - 1) % polygon.size()]);
+			mesh.indices.push_back(polygon[(start + k) % polygon.size()]);
+		}
+	}
+
+	// deduplicates the job's corners into vertices, triangulates its faces and completes them
+	static void buildMesh(MeshJob &job, const Attributes &attributes) {
+		CornerTable vertexIds;
+		vector<bool> missingNormals;
+		vector<unsigned int> polygon;
+		MeshData &mesh = job.mesh;
+		job.valid = true;
+		for (size_t s = 0; s < job.segments.size(); s++) {
+			const MeshJob::Segment &segment = job.segments[s];
+			const Chunk &chunk = *segment.chunk;
+			for (size_t f = segment.begin; f < segment.end; f++) {
+				size_t cornerEnd = f + 1 < chunk.faceStarts.size() ? chunk.faceStarts[f + 1] : chunk.corners.size();
+				polygon.clear();
+				for (size_t c = chunk.faceStarts[f]; c < cornerEnd; c++) {
+					const Corner &corner = chunk.corners[c];
+					if (corner.position < 0 || corner.position >= (int)attributes.positions.size() || corner.texCoord < -1
+						|| corner.texCoord >= (int)attributes.texCoords.size() || corner.normal < -1 || corner.normal >= (int)attributes.normals.size()) {
+						job.valid = false;
+						return;
+					}
+					bool added;
+					polygon.push_back(vertexIds.insert(corner, (unsigned int)mesh.vertices.size(), added));
+					if (added) {
+						Vertex vertex;
+						vertex.Position = attributes.positions[corner.position];
+						vertex.Normal = corner.normal >= 0 ? attributes.normals[corner.normal] : glm::vec3(0.0f);
+						vertex.TexCoords = corner.texCoord >= 0 ? attributes.texCoords[corner.texCoord] : glm::vec2(0.0f);
+						mesh.vertices.push_back(vertex);
+						missingNormals.push_back(corner.normal < 0);
+					}
+				}
+				triangulate(polygon, mesh);
+			}
+		}
+		if (mesh.indices.empty()) {
+			return;
+		}
+		computeMissingNormals(mesh, missingNormals);
+		computeTangents(mesh);
+		if (job.material != NULL) {
+			mesh.textures = job.material->textures;
+		}
+	}
+
+	static void buildMeshes(vector<MeshJob> &jobs, const Attributes &attributes, atomic<size_t> &next) {
+		for (size_t j = next++; j < jobs.size(); j = next++) {
+			buildMesh(jobs[j], attributes);
+		}
+	}
+
+public:
+	static bool handles(const string &path) {
+		size_t dot = path.find_last_of('.');
+		if (dot == string::npos || path.size() - dot != 4) {
+			return false;
+		}
+		string extension = path.substr(dot + 1);
+		transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		return extension == "obj";
+	}
+
+	// parses an OBJ file (and the material libraries it names) and appends its meshes
+	static bool import(const string &path, vector<MeshData> &meshes) {
+		VfsFile file;
+		if (!vfs().open(path, file)) {
+			logError(CATEGORY_ASSETS, "could not read {}", path);
+			return false;
+		}
+		const char *data = (const char*)file.getData(), *dataEnd = data + file.getSize();
+
+		// one chunk per core, each ending after a line break
+		int chunkCount = (int)max((size_t)1, min((size_t)max(1u, thread::hardware_concurrency()), file.getSize() / OBJ_CHUNK_MIN_SIZE));
+		vector<Chunk> chunks(chunkCount);
+		const char *cursor = data;
+		for (int i = 0; i < chunkCount; i++) {
+			chunks[i].begin = cursor;
+			const char *split = i == chunkCount - 1 ? dataEnd : data + file.getSize() / chunkCount * (i + 1);
+			split = max(split, cursor);
+			const char *lineEnd = split < dataEnd ? (const char*)memchr(split, '\n', dataEnd - split) : NULL;
+			cursor = i == chunkCount - 1 || lineEnd == NULL ? dataEnd : lineEnd + 1;
+			chunks[i].end = cursor;
+		}
+		vector<thread> workers;
+		for (int i = 1; i < chunkCount; i++) {
+			workers.push_back(thread(parseChunk, ref(chunks[i])));
+		}
+		parseChunk(chunks[0]);
+		for (int i = 0; i < workers.size(); i++) {
+			workers[i].join();
+		}
+
+		// every attribute in file order; each chunk's relative indices become absolute
+		Attributes attributes;
+		for (int i = 0; i < chunkCount; i++) {
+			Chunk &chunk = chunks[i];
+			if (chunk.failed) {
+				logError(CATEGORY_ASSETS, "{}:{}: can't parse this line", path, (int)count(data, chunk.begin, '\n') + chunk.failedLine);
+				return false;
+			}
+			int offsets[3] = { (int)attributes.positions.size(), (int)attributes.texCoords.size(), (int)attributes.normals.size() };
+			for (size_t f = 0; f < chunk.fixups.size(); f++) {
+				Corner &corner = chunk.corners[chunk.fixups[f] / 3];
+				int *attribute = chunk.fixups[f] % 3 == 0 ? &corner.position : chunk.fixups[f] % 3 == 1 ? &corner.texCoord : &corner.normal;
+				*attribute += offsets[chunk.fixups[f] % 3];
+			}
+			attributes.positions.insert(attributes.positions.end(), chunk.positions.begin(), chunk.positions.end());
+			attributes.texCoords.insert(attributes.texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+			attributes.normals.insert(attributes.normals.end(), chunk.normals.begin(), chunk.normals.end());
+			vector<glm::vec3>().swap(chunk.positions);
+			vector<glm::vec2>().swap(chunk.texCoords);
+			vector<glm::vec3>().swap(chunk.normals);
+		}
+
+		map<string, Material> materials;
+		for (int i = 0; i < chunkCount; i++) {
+			for (size_t e = 0; e < chunks[i].events.size(); e++) {
+				const Event &event = chunks[i].events[e];
+				size_t start = 0;
+				while (event.type == EVENT_LIBRARY && start < event.name.size()) {
+					size_t blank = event.name.find_first_of(" \t", start);
+					blank = blank == string::npos ? event.name.size() : blank;
+					if (blank > start) {
+						loadLibrary(directoryOf(path) + event.name.substr(start, blank - start), materials);
+					}
+					start = blank + 1;
+				}
+			}
+		}
+
+		// a new object or material starts a new mesh, like ASSIMP's; empty ones are dropped
+		vector<MeshJob> jobs(1);
+		jobs[0].material = NULL;
+		string materialName;
+		for (int i = 0; i < chunkCount; i++) {
+			const Chunk &chunk = chunks[i];
+			size_t start = 0;
+			for (size_t e = 0; e <= chunk.events.size(); e++) {
+				size_t face = e < chunk.events.size() ? chunk.events[e].face : chunk.faceStarts.size();
+				if (face > start) {
+					MeshJob::Segment segment = { &chunk, start, face };
+					jobs.back().segments.push_back(segment);
+					start = face;
+				}
+				if (e == chunk.events.size()) {
+					break;
+				}
+				const Event &event = chunk.events[e];
+				if (event.type == EVENT_LIBRARY || (event.type == EVENT_MATERIAL && event.name == materialName)) {
+					continue;
+				}
+				const Material *material = jobs.back().material;
+				if (event.type == EVENT_MATERIAL) {
+					materialName = event.name;
+					map<string, Material>::const_iterator found = materials.find(event.name);
+					material = found == materials.end() ? NULL : &found->second;
+				}
+				if (!jobs.back().segments.empty()) {
+					jobs.push_back(MeshJob());
+				}
+				jobs.back().material = material;
+			}
+		}
+
+		// meshes don't depend on each other, a field of separate objects builds on every core
+		atomic<size_t> next(0);
+		int builderCount = (int)min((size_t)max(1u, thread::hardware_concurrency()), jobs.size());
+		vector<thread> builders;
+		for (int i = 1; i < builderCount; i++) {
+			builders.push_back(thread(buildMeshes, ref(jobs), cref(attributes), ref(next)));
+		}
+		buildMeshes(jobs, attributes, next);
+		for (int i = 0; i < builders.size(); i++) {
+			builders[i].join();
+		}
+		for (size_t j = 0; j < jobs.size(); j++) {
+			if (!jobs[j].valid) {
+				logError(CATEGORY_ASSETS, "{} has a face index out of range", path);
+				return false;
+			}
+		}
+		for (size_t j = 0; j < jobs.size(); j++) {
+			if (!jobs[j].mesh.indices.empty()) {
+				meshes.push_back(MeshData());
+				meshes.back().vertices.swap(jobs[j].mesh.vertices);
+				meshes.back().indices.swap(jobs[j].mesh.indices);
+				meshes.back().textures.swap(jobs[j].mesh.textures);
+			}
+		}
+		return true;
+	}
+};
+#endif
@@ -0,0 +1,166 @@
+#pragma once
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "glState.h"
+#include "compactId.h"
+#include "mesh.h"
+using namespace std;
+
+enum RenderPass {
+	PASS_OPAQUE,      // front to back, so early-z rejects hidden fragments
+	PASS_TRANSPARENT, // back to front
+	RENDER_PASS_COUNT
+};
+
+// Sort key layout, most significant first:
+// | pass 2 | program 10 | material 12 | mesh 16 | depth 24 |
+// Programs, materials (textures) and meshes go in by the compact ids they got when they were
+// created (compactId.h); past the field's range they share its last value, which only costs
+// grouping, never order.
+const int SORT_KEY_DEPTH_BITS = 24;
+const int SORT_KEY_MESH_BITS = 16;
+const int SORT_KEY_MATERIAL_BITS = 12;
+const int SORT_KEY_PROGRAM_BITS = 10;
+
+struct DrawPacket {
+	unsigned long long key;
+	GLuint program;
+	GLint modelLocation;
+	GLint normalMatrixLocation; // -1 if the program doesn't light anything
+	Mesh *mesh;
+	int lod;
+	glm::mat4 model;
+};
+
+// Collects the frame's draws, radix-sorts them by key and issues them in that order, so draws sharing
+// a program, textures and mesh run back to back and the state cache skips the rebinds between them.
+class RenderQueue {
+private:
+	struct SortItem {
+		unsigned long long key;
+		unsigned int packet;
+	};
+
+	vector<DrawPacket> packets;
+	vector<SortItem> items;
+	vector<SortItem> sortBuffer;
+	glm::vec3 eye;
+	float farDistance;
+	unsigned int triangleCount;
+
+	static unsigned long long keyField(unsigned int id, int bits) {
+		return min(id, (1u << bits) - 1);
+	}
+
+	unsigned long long depthBits(const glm::mat4 &model, RenderPass pass) {
+		const unsigned long long maxDepth = (1ull << SORT_KEY_DEPTH_BITS) - 1;
+		float distance = glm::length(glm::vec3(model[3]) - eye) / farDistance;
+		distance = glm::clamp(distance, 0.0f, 1.0f);
+		unsigned long long depth = (unsigned long long)(distance * maxDepth);
+		return pass == PASS_TRANSPARENT ? maxDepth - depth : depth;
+	}
+
+	// LSD radix sort, one byte per pass; passes where every key has the same byte are skipped
+	void radixSort() {
+		sortBuffer.resize(items.size());
+		for (int shift = 0; shift < 64; shift += 8) {
+			unsigned int counts[256] = { 0 };
+			for (int i = 0; i < items.size(); i++) {
+				counts[(items[i].key >> shift) & 0xFF]++;
+			}
+			if (counts[(items[0].key >> shift) & 0xFF] == items.size()) {
+				continue;
+			}
+			unsigned int offset = 0;
+			for (int digit = 0; digit < 256; digit++) {
+				unsigned int count = counts[digit];
+				counts[digit] = offset;
+				offset += count;
+			}
+			for (int i = 0; i < items.size(); i++) {
+				sortBuffer[counts[(items[i].key >> shift) & 0xFF]++] = items[i];
+			}
+			items.swap(sortBuffer);
+		}
+	}
+
+public:
+	RenderQueue() {
+		eye = glm::vec3(0.0f);
+		farDistance = 1.0f;
+		triangleCount = 0;
+	}
+
+	// depth is measured from eye and quantised over [0, farDistance]
+	void begin(glm::vec3 eye, float farDistance) {
+		this->eye = eye;
+		this->farDistance = farDistance > 0.0f ? farDistance : 1.0f;
+		packets.clear();
+		items.clear();
+		triangleCount = 0;
+	}
+
+	void submit(RenderPass pass, GLuint program, GLint modelLocation, GLint normalMatrixLocation, Mesh *mesh, const glm::mat4 &model, int lod = 0) {
+		unsigned long long key = (unsigned long long)pass << (SORT_KEY_PROGRAM_BITS + SORT_KEY_MATERIAL_BITS + SORT_KEY_MESH_BITS + SORT_KEY_DEPTH_BITS);
+		key |= keyField(programIds().get(program), SORT_KEY_PROGRAM_BITS) << (SORT_KEY_MATERIAL_BITS + SORT_KEY_MESH_BITS + SORT_KEY_DEPTH_BITS);
+		key |= keyField(textureIds().get(mesh->getMaterialTexture()), SORT_KEY_MATERIAL_BITS) << (SORT_KEY_MESH_BITS + SORT_KEY_DEPTH_BITS);
+		key |= keyField(mesh->sortId.get(), SORT_KEY_MESH_BITS) << SORT_KEY_DEPTH_BITS;
+		key |= depthBits(model, pass);
+
+		DrawPacket packet;
+		packet.key = key;
+		packet.program = program;
+		packet.modelLocation = modelLocation;
+		packet.normalMatrixLocation = normalMatrixLocation;
+		packet.mesh = mesh;
+		packet.lod = lod;
+		packet.model = model;
+		SortItem item;
+		item.key = key;
+		item.packet = packets.size();
+		packets.push_back(packet);
+		items.push_back(item);
+		triangleCount += mesh->getTriangleCount(lod);
+	}
+
+	void execute() {
+		if (items.empty()) {
+			return;
+		}
+		radixSort();
+		for (int i = 0; i < items.size(); i++) {
+			const DrawPacket &packet = packets[items[i].packet];
+			glState().useProgram(packet.program);
+			glUniformMatrix4fv(packet.modelLocation, 1, GL_FALSE, glm::value_ptr(packet.model));
+			if (packet.normalMatrixLocation >= 0) {
+				glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(packet.model));
+				glUniformMatrix3fv(packet.normalMatrixLocation, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+			}
+			packet.mesh->Draw(packet.program, packet.lod);
+		}
+	}
+
+	int getPacketCount() {
+		return packets.size();
+	}
+
+	// triangles in the draws submitted since begin
+	unsigned int getTriangleCount() {
+		return triangleCount;
+	}
+
+	glm::vec3 getEye() {
+		return eye;
+	}
+};
+#endif
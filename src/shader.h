@@ -4,177 +4,604 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <cstdio>
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include "logger.h"
+#include "uniformBuffers.h"
+#include "glState.h"
+#include "glResource.h"
+#include "contentHash.h"
+#include "vfs.h"
+
+// Material maps sample fixed texture units: texture_diffuse1..3 use units 0-2, texture_specularN 3-5,
+// texture_normalN 6-8 and texture_heightN 9-11. The samplers are pointed at them once after linking,
+// so drawing a mesh only has to bind its textures.
+enum MaterialTextureType { TEXTURE_DIFFUSE, TEXTURE_SPECULAR, TEXTURE_NORMAL, TEXTURE_HEIGHT, MATERIAL_TEXTURE_TYPE_COUNT };
+const int MATERIAL_TEXTURES_PER_TYPE = 3;
+const int SHADOW_MAP_TEXTURE_UNIT = MATERIAL_TEXTURE_TYPE_COUNT * MATERIAL_TEXTURES_PER_TYPE;
+const int SKYBOX_TEXTURE_UNIT = SHADOW_MAP_TEXTURE_UNIT + 1; // a cube sampler can't share a unit with texture_diffuse1 in one program
+static const char *const materialTextureNames[MATERIAL_TEXTURE_TYPE_COUNT] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+
+// -1 for texture types no shader samples
+inline int materialTextureType(const std::string &name)
+{
+	for (int type = 0; type < MATERIAL_TEXTURE_TYPE_COUNT; type++)
+	{
+		if (name == materialTextureNames[type])
+			return type;
+	}
+	return -1;
+}
+
+// FNV-1a; constexpr so string literal names hash at compile time
+constexpr unsigned int uniformHash(const char *name, unsigned int hash = 2166136261u)
+{
+	return *name ? uniformHash(name + 1, (hash ^ (unsigned char)*name) * 16777619u) : hash;
+}
+
+// Uniform name reduced to its hash. Setters take this instead of std::string,
+// so passing a literal costs neither an allocation nor a driver lookup.
+struct UniformId
+{
+	unsigned int hash;
+
+	constexpr UniformId(const char *name) : hash(uniformHash(name)) {}
+	UniformId(const std::string &name) : hash(uniformHash(name.c_str())) {}
+};
+
+// KHR_parallel_shader_compile isn't in the generated loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// 64-bit FNV-1a, for cache keys where a 32-bit collision would load the wrong program
+inline unsigned long long programHash(const std::string &text, unsigned long long hash = CONTENT_HASH_SEED)
+{
+	return contentHash(text, hash);
+}
+
+// Linked programs saved with glGetProgramBinary, one file per program in PROGRAM_CACHE_DIRECTORY.
+// The key covers the sources and the driver strings, so an edited shader or a driver update
+// simply misses; a binary the driver rejects is deleted and the program is compiled again.
+class ProgramBinaryCache
+{
+public:
+	static unsigned long long key(const std::string &vertexCode, const std::string &fragmentCode, const std::string &geometryCode)
+	{
+		unsigned long long hash = programHash(vertexCode);
+		hash = programHash(fragmentCode, hash);
+		hash = programHash(geometryCode, hash);
+		hash = programHash(glString(GL_VENDOR), hash);
+		hash = programHash(glString(GL_RENDERER), hash);
+		return programHash(glString(GL_VERSION), hash);
+	}
+
+	static bool load(unsigned long long key, GLuint program)
+	{
+		if (!supported())
+			return false;
+		std::ifstream file(path(key).c_str(), std::ios::binary);
+		if (!file)
+			return false;
+		Header header;
+		std::vector<char> binary;
+		if (file.read((char*)&header, sizeof(header)) && header.magic == MAGIC && header.key == key && header.length > 0)
+		{
+			binary.resize(header.length);
+			file.read(&binary[0], header.length);
+		}
+		file.close();
+		if (binary.empty() || !file)
+		{
+			discard(key);
+			return false;
+		}
+		glProgramBinary(program, header.format, &binary[0], header.length);
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (!linked)
+		{
+			logInfo(CATEGORY_SHADER, "cached program {} rejected by the driver, recompiling", path(key));
+			discard(key);
+			return false;
+		}
+		return true;
+	}
+
+	static void store(unsigned long long key, GLuint program)
+	{
+		if (!supported())
+			return;
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+		Header header;
+		header.magic = MAGIC;
+		header.key = key;
+		std::vector<char> binary(length);
+		glGetProgramBinary(program, length, &length, &header.format, &binary[0]);
+		header.length = length;
+		makeDirectory();
+		std::ofstream file(path(key).c_str(), std::ios::binary | std::ios::trunc);
+		file.write((const char*)&header, sizeof(header));
+		file.write(&binary[0], length);
+		if (!file)
+			logWarning(CATEGORY_SHADER, "could not write program cache {}", path(key));
+	}
+
+private:
+	static const unsigned int MAGIC = 0x31435053; // "SPC1"
+
+	struct Header
+	{
+		unsigned int magic;
+		GLenum format;
+		GLint length;
+		unsigned long long key;
+	};
+
+	static const char *directory()
+	{
+		return "shadercache";
+	}
+
+	static std::string path(unsigned long long key)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.bin", key);
+		return std::string(directory()) + "/" + name;
+	}
+
+	static std::string glString(GLenum name)
+	{
+		const GLubyte *value = glGetString(name);
+		return value ? (const char*)value : "";
+	}
+
+	// some drivers expose the entry points but no binary formats
+	static bool supported()
+	{
+		static GLint formats = -1;
+		if (formats < 0)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		return formats > 0;
+	}
+
+	static void makeDirectory()
+	{
+#ifdef _WIN32
+		_mkdir(directory());
+#else
+		mkdir(directory(), 0755);
+#endif
+	}
+
+	static void discard(unsigned long long key)
+	{
+		remove(path(key).c_str());
+	}
+};
 
 class Shader
 {
 public:
-	unsigned int ID;
-	// constructor generates the shader on the fly
+	GLProgram ID; // deleted with the Shader
+	// constructor reads the sources and starts building the program: from the binary cache when
+	// it has this program, otherwise compile and link are only issued, so the driver can work on
+	// several programs at once. The program is finished by finishPending() or on first use.
 	// ------------------------------------------------------------------------
-	Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+	// defines ("#define X\n" lines) are inserted after #version to build a variant, see ShaderVariants
+	Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const std::string &defines = "")
 	{
-		// 1. retrieve the vertex/fragment source code from filePath
+		// 1. retrieve the vertex/fragment source code from the asset archive or filePath
 		std::string vertexCode;
 		std::string fragmentCode;
 		std::string geometryCode;
-		std::ifstream vShaderFile;
-		std::ifstream fShaderFile;
-		std::ifstream gShaderFile;
-		// ensure ifstream objects can throw exceptions:
-		vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		try
-		{
-			// open files
-			vShaderFile.open(vertexPath);
-			fShaderFile.open(fragmentPath);
-			std::stringstream vShaderStream, fShaderStream;
-			// read file's buffer contents into streams
-			vShaderStream << vShaderFile.rdbuf();
-			fShaderStream << fShaderFile.rdbuf();
-			// close file handlers
-			vShaderFile.close();
-			fShaderFile.close();
-			// convert stream into string
-			vertexCode = vShaderStream.str();
-			fragmentCode = fShaderStream.str();
-			// if geometry shader path is present, also load a geometry shader
+		// if geometry shader path is present, also load a geometry shader
+		if (!readSource(vertexPath, vertexCode) || !readSource(fragmentPath, fragmentCode)
+			|| (geometryPath != nullptr && !readSource(geometryPath, geometryCode)))
+		{
+			logError(CATEGORY_SHADER, "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ {} {}", vertexPath, fragmentPath);
+		}
+		if (!defines.empty())
+		{
+			vertexCode = injectDefines(vertexCode, defines);
+			fragmentCode = injectDefines(fragmentCode, defines);
+			if (!geometryCode.empty())
+				geometryCode = injectDefines(geometryCode, defines);
+		}
+		enableParallelCompile();
+		cacheKey = ProgramBinaryCache::key(vertexCode, fragmentCode, geometryCode);
+		vertex = fragment = geometry = 0;
+		pending = true;
+		ID = GLProgram::create();
+		fromCache = ProgramBinaryCache::load(cacheKey, ID);
+		if (!fromCache)
+		{
+			const char* vShaderCode = vertexCode.c_str();
+			const char * fShaderCode = fragmentCode.c_str();
+			// 2. compile shaders, errors are checked in finish()
+			vertex = glCreateShader(GL_VERTEX_SHADER);
+			glShaderSource(vertex, 1, &vShaderCode, NULL);
+			glCompileShader(vertex);
+			fragment = glCreateShader(GL_FRAGMENT_SHADER);
+			glShaderSource(fragment, 1, &fShaderCode, NULL);
+			glCompileShader(fragment);
 			if (geometryPath != nullptr)
 			{
-				gShaderFile.open(geometryPath);
-				std::stringstream gShaderStream;
-				gShaderStream << gShaderFile.rdbuf();
-				gShaderFile.close();
-				geometryCode = gShaderStream.str();
+				const char * gShaderCode = geometryCode.c_str();
+				geometry = glCreateShader(GL_GEOMETRY_SHADER);
+				glShaderSource(geometry, 1, &gShaderCode, NULL);
+				glCompileShader(geometry);
 			}
+			// shader Program
+			glAttachShader(ID, vertex);
+			glAttachShader(ID, fragment);
+			if (geometry != 0)
+				glAttachShader(ID, geometry);
+			glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+			glLinkProgram(ID);
+		}
+		pendingShaders().push_back(this);
+	}
+
+	~Shader()
+	{
+		if (!pending)
+			return;
+		forgetPending();
+		if (!fromCache && glResources().isContextAlive())
+		{
+			glDeleteShader(vertex);
+			glDeleteShader(fragment);
+			if (geometry != 0)
+				glDeleteShader(geometry);
 		}
-		catch (std::ifstream::failure e)
-		{
-			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-		}
-		const char* vShaderCode = vertexCode.c_str();
-		const char * fShaderCode = fragmentCode.c_str();
-		// 2. compile shaders
-		unsigned int vertex, fragment;
-		// vertex shader
-		vertex = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertex, 1, &vShaderCode, NULL);
-		glCompileShader(vertex);
-		checkCompileErrors(vertex, "VERTEX");
-		// fragment Shader
-		fragment = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragment, 1, &fShaderCode, NULL);
-		glCompileShader(fragment);
-		checkCompileErrors(fragment, "FRAGMENT");
-		// if geometry shader is given, compile geometry shader
-		unsigned int geometry;
-		if (geometryPath != nullptr)
-		{
-			const char * gShaderCode = geometryCode.c_str();
-			geometry = glCreateShader(GL_GEOMETRY_SHADER);
-			glShaderSource(geometry, 1, &gShaderCode, NULL);
-			glCompileShader(geometry);
-			checkCompileErrors(geometry, "GEOMETRY");
-		}
-		// shader Program
-		ID = glCreateProgram();
-		glAttachShader(ID, vertex);
-		glAttachShader(ID, fragment);
-		if (geometryPath != nullptr)
-			glAttachShader(ID, geometry);
-		glLinkProgram(ID);
-		checkCompileErrors(ID, "PROGRAM");
-		// delete the shaders as they're linked into our program now and no longer necessery
-		glDeleteShader(vertex);
-		glDeleteShader(fragment);
-		if (geometryPath != nullptr)
-			glDeleteShader(geometry);
+	}
 
+	// blocks until the program is linked, then reports errors, stores the binary and reflects uniforms
+	void finish()
+	{
+		if (!pending)
+			return;
+		pending = false;
+		forgetPending();
+		if (!fromCache)
+		{
+			checkCompileErrors(vertex, "VERTEX");
+			checkCompileErrors(fragment, "FRAGMENT");
+			if (geometry != 0)
+				checkCompileErrors(geometry, "GEOMETRY");
+			bool linked = checkCompileErrors(ID, "PROGRAM");
+			// delete the shaders as they're linked into our program now and no longer necessery
+			glDeleteShader(vertex);
+			glDeleteShader(fragment);
+			if (geometry != 0)
+				glDeleteShader(geometry);
+			if (linked)
+				ProgramBinaryCache::store(cacheKey, ID);
+		}
+
+		reflectUniforms();
+		bindUniformBlocks();
+		bindSamplers();
+	}
+
+	// true once finish() won't block; without KHR_parallel_shader_compile that can't be known
+	bool isReady() const
+	{
+		if (!pending || fromCache || !parallelCompile())
+			return true;
+		GLint done = GL_FALSE;
+		glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+		return done == GL_TRUE;
+	}
+
+	// finishes every program still being built, the ones the driver is done with first
+	static void finishPending()
+	{
+		int finished = 0, cached = 0;
+		while (!pendingShaders().empty())
+		{
+			std::vector<Shader*> shaders = pendingShaders();
+			bool progress = false;
+			for (unsigned int i = 0; i < shaders.size(); i++)
+			{
+				if (shaders[i]->isReady())
+				{
+					cached += shaders[i]->fromCache ? 1 : 0;
+					shaders[i]->finish();
+					finished++;
+					progress = true;
+				}
+			}
+			if (!progress)
+			{
+				cached += shaders[0]->fromCache ? 1 : 0;
+				shaders[0]->finish();
+				finished++;
+			}
+		}
+		if (finished > 0)
+			logInfo(CATEGORY_SHADER, "{} programs ready, {} from the binary cache", finished, cached);
 	}
 	// activate the shader
 	// ------------------------------------------------------------------------
 	void use()
 	{
-		glUseProgram(ID);
+		if (pending)
+			finish();
+		glState().useProgram(ID);
 	}
 	// utility uniform functions
 	// ------------------------------------------------------------------------
-	void setBool(const std::string &name, bool value) const
+	GLint location(UniformId id) const
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+		if (pending)
+			const_cast<Shader*>(this)->finish();
+		for (unsigned int i = id.hash & uniformMask; uniformTable[i].used; i = (i + 1) & uniformMask)
+		{
+			if (uniformTable[i].hash == id.hash)
+				return uniformTable[i].location;
+		}
+		return -1; // not active in this program, glUniform* ignores it like before
 	}
 	// ------------------------------------------------------------------------
-	void setInt(const std::string &name, int value) const
+	void setBool(UniformId id, bool value) const
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1i(location(id), (int)value);
 	}
 	// ------------------------------------------------------------------------
-	void setFloat(const std::string &name, float value) const
+	void setInt(UniformId id, int value) const
 	{
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1i(location(id), value);
 	}
 	// ------------------------------------------------------------------------
-	void setVec2(const std::string &name, const glm::vec2 &value) const
+	void setFloat(UniformId id, float value) const
 	{
-		glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform1f(location(id), value);
 	}
-	void setVec2(const std::string &name, float x, float y) const
+	// ------------------------------------------------------------------------
+	void setVec2(UniformId id, const glm::vec2 &value) const
 	{
-		glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+		glUniform2fv(location(id), 1, &value[0]);
+	}
+	void setVec2(UniformId id, float x, float y) const
+	{
+		glUniform2f(location(id), x, y);
 	}
 	// ------------------------------------------------------------------------
-	void setVec3(const std::string &name, const glm::vec3 &value) const
+	void setVec3(UniformId id, const glm::vec3 &value) const
 	{
-		glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform3fv(location(id), 1, &value[0]);
 	}
-	void setVec3(const std::string &name, float x, float y, float z) const
+	void setVec3(UniformId id, float x, float y, float z) const
 	{
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+		glUniform3f(location(id), x, y, z);
 	}
 	// ------------------------------------------------------------------------
-	void setVec4(const std::string &name, const glm::vec4 &value) const
+	void setVec4(UniformId id, const glm::vec4 &value) const
 	{
-		glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform4fv(location(id), 1, &value[0]);
 	}
-	void setVec4(const std::string &name, float x, float y, float z, float w)
+	void setVec4(UniformId id, float x, float y, float z, float w)
 	{
-		glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+		glUniform4f(location(id), x, y, z, w);
 	}
 	// ------------------------------------------------------------------------
-	void setMat2(const std::string &name, const glm::mat2 &mat) const
+	void setMat2(UniformId id, const glm::mat2 &mat) const
 	{
-		glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix2fv(location(id), 1, GL_FALSE, &mat[0][0]);
 	}
 	// ------------------------------------------------------------------------
-	void setMat3(const std::string &name, const glm::mat3 &mat) const
+	void setMat3(UniformId id, const glm::mat3 &mat) const
 	{
-		glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix3fv(location(id), 1, GL_FALSE, &mat[0][0]);
 	}
 	// ------------------------------------------------------------------------
-	void setMat4(const std::string &name, const glm::mat4 &mat) const
+	void setMat4(UniformId id, const glm::mat4 &mat) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix4fv(location(id), 1, GL_FALSE, &mat[0][0]);
 	}
 
 private:
+	unsigned long long cacheKey;
+	bool pending;   // compiled/linked but not finished yet
+	bool fromCache; // loaded with glProgramBinary, no shader objects
+	unsigned int vertex, fragment, geometry;
+
+	static bool readSource(const char *path, std::string &code)
+	{
+		VfsFile file;
+		if (!vfs().open(path, file))
+			return false;
+		code.assign((const char*)file.getData(), file.getSize());
+		return true;
+	}
+
+	// #version has to stay the first line
+	static std::string injectDefines(const std::string &code, const std::string &defines)
+	{
+		std::string::size_type version = code.find("#version");
+		std::string::size_type lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+		if (lineEnd == std::string::npos)
+			return defines + code;
+		return code.substr(0, lineEnd + 1) + defines + code.substr(lineEnd + 1);
+	}
+
+	static std::vector<Shader*> &pendingShaders()
+	{
+		static std::vector<Shader*> shaders;
+		return shaders;
+	}
+
+	void forgetPending()
+	{
+		std::vector<Shader*> &shaders = pendingShaders();
+		shaders.erase(std::remove(shaders.begin(), shaders.end(), this), shaders.end());
+	}
+
+	static bool &parallelCompile()
+	{
+		static bool available = false;
+		return available;
+	}
+
+	// asks the driver for as many compiler threads as it likes, once
+	static void enableParallelCompile()
+	{
+		static bool checked = false;
+		if (checked)
+			return;
+		checked = true;
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+		{
+			const char *extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			bool khr = strcmp(extension, "GL_KHR_parallel_shader_compile") == 0;
+			if (!khr && strcmp(extension, "GL_ARB_parallel_shader_compile") != 0)
+				continue;
+			PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress(khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB");
+			if (maxShaderCompilerThreads != NULL)
+			{
+				maxShaderCompilerThreads(0xFFFFFFFF);
+				parallelCompile() = true;
+				logInfo(CATEGORY_SHADER, "parallel shader compile enabled ({})", extension);
+			}
+			return;
+		}
+	}
+
+	struct UniformSlot
+	{
+		unsigned int hash;
+		GLint location;
+		bool used;
+	};
+	// open addressing table of every active uniform, filled once after linking
+	std::vector<UniformSlot> uniformTable;
+	unsigned int uniformMask;
+
+	void addUniform(const std::string &name, GLint location)
+	{
+		unsigned int hash = uniformHash(name.c_str());
+		unsigned int i = hash & uniformMask;
+		for (; uniformTable[i].used; i = (i + 1) & uniformMask)
+		{
+			if (uniformTable[i].hash == hash)
+			{
+				logWarning(CATEGORY_SHADER, "uniform {} collides with another uniform hash in program {}", name, ID);
+				return;
+			}
+		}
+		uniformTable[i].hash = hash;
+		uniformTable[i].location = location;
+		uniformTable[i].used = true;
+	}
+
+	// arrays are registered as "name", "name[0]", "name[1]"... so every spelling the code uses resolves
+	void reflectUniforms()
+	{
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		unsigned int size = 16;
+		while (size < 4 * (unsigned int)count)
+			size *= 2;
+		uniformTable.assign(size, UniformSlot());
+		uniformMask = size - 1;
+		std::vector<GLchar> nameBuffer(maxLength + 1);
+		for (GLint i = 0; i < count; i++)
+		{
+			GLsizei length = 0;
+			GLint arraySize = 0;
+			GLenum type;
+			glGetActiveUniform(ID, i, nameBuffer.size(), &length, &arraySize, &type, &nameBuffer[0]);
+			std::string name(&nameBuffer[0], length);
+			GLint uniformLocation = glGetUniformLocation(ID, name.c_str());
+			if (uniformLocation < 0)
+				continue; // block members have no location
+			std::string::size_type bracket = name.rfind("[0]");
+			if (bracket == std::string::npos || bracket + 3 != name.size())
+			{
+				addUniform(name, uniformLocation);
+				continue;
+			}
+			std::string base = name.substr(0, bracket);
+			addUniform(base, uniformLocation);
+			for (GLint element = 0; element < arraySize; element++)
+			{
+				std::string elementName = base + "[" + std::to_string(element) + "]";
+				addUniform(elementName, glGetUniformLocation(ID, elementName.c_str()));
+			}
+		}
+	}
+
+	// samplers following the material naming convention get their fixed units, the program doesn't have to be bound
+	void bindSamplers()
+	{
+		for (int type = 0; type < MATERIAL_TEXTURE_TYPE_COUNT; type++)
+		{
+			for (int number = 0; number < MATERIAL_TEXTURES_PER_TYPE; number++)
+			{
+				GLint samplerLocation = location(std::string(materialTextureNames[type]) + std::to_string(number + 1));
+				if (samplerLocation >= 0)
+					glProgramUniform1i(ID, samplerLocation, type * MATERIAL_TEXTURES_PER_TYPE + number);
+			}
+		}
+		GLint shadowMapLocation = location("shadowMap");
+		if (shadowMapLocation >= 0)
+			glProgramUniform1i(ID, shadowMapLocation, SHADOW_MAP_TEXTURE_UNIT);
+		GLint skyboxLocation = location("skybox");
+		if (skyboxLocation >= 0)
+			glProgramUniform1i(ID, skyboxLocation, SKYBOX_TEXTURE_UNIT);
+	}
+
+	// blocks the program doesn't declare are simply skipped
+	void bindUniformBlocks()
+	{
+		for (int binding = 0; binding < UNIFORM_BLOCK_BINDING_COUNT; binding++)
+		{
+			GLuint blockIndex = glGetUniformBlockIndex(ID, uniformBlockNames[binding]);
+			if (blockIndex != GL_INVALID_INDEX)
+				glUniformBlockBinding(ID, blockIndex, binding);
+		}
+	}
+
 	// utility function for checking shader compilation/linking errors.
 	// ------------------------------------------------------------------------
-	void checkCompileErrors(GLuint shader, std::string type)
+	bool checkCompileErrors(GLuint shader, std::string type)
 	{
 		GLint success;
-		GLchar infoLog[1024];
+		GLint length = 0;
+		std::string infoLog;
 		if (type != "PROGRAM")
 		{
 			glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 			if (!success)
 			{
-				glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-				std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+				glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+				infoLog.resize(length > 0 ? length : 1);
+				glGetShaderInfoLog(shader, (GLsizei)infoLog.size(), NULL, &infoLog[0]);
+				logError(CATEGORY_SHADER, "ERROR::SHADER_COMPILATION_ERROR of type: {}", type);
 			}
 		}
 		else
@@ -182,10 +609,20 @@ private:
 			glGetProgramiv(shader, GL_LINK_STATUS, &success);
 			if (!success)
 			{
-				glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-				std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+				glGetProgramiv(shader, GL_INFO_LOG_LENGTH, &length);
+				infoLog.resize(length > 0 ? length : 1);
+				glGetProgramInfoLog(shader, (GLsizei)infoLog.size(), NULL, &infoLog[0]);
+				logError(CATEGORY_SHADER, "ERROR::PROGRAM_LINKING_ERROR of type: {}", type);
 			}
 		}
+		if (!success)
+		{
+			// the whole log, it can be longer than one log record holds
+			infoLog.resize(strnlen(infoLog.c_str(), infoLog.size()));
+			logText(LEVEL_ERROR, CATEGORY_SHADER, infoLog);
+			logError(CATEGORY_SHADER, " -- --------------------------------------------------- -- ");
+		}
+		return success == GL_TRUE;
 	}
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <map>
+#include <string>
+
+#include "shader.h"
+using namespace std;
+
+// Feature flags a material asks for; each one is a #define of the same name in the shader source.
+enum ShaderFeature {
+	SHADER_INSTANCED    = 1 << 0, // per-instance model/normal matrices (materialModel.vs)
+	SHADER_SHADOWS      = 1 << 1, // shadow map lookup (materialModel)
+	SHADER_SPOT_LIGHT   = 1 << 2, // spotLight from the Lights block (materialModel.fs)
+	SHADER_DIR_LIGHT    = 1 << 3, // dirLight uniform (materialModel.fs)
+	SHADER_POINT_LIGHTS = 1 << 4, // pointLights[NR_POINT_LIGHTS] (materialModel.fs)
+	SHADER_REFLECT      = 1 << 5, // skybox reflection (materialReflex)
+	SHADER_REFRACT      = 1 << 6, // skybox refraction (materialReflex)
+	SHADER_FLAT         = 1 << 7, // plain colour, no lighting inputs (materialReflex)
+	SHADER_UBER_ASTEROID = 1 << 8, // lit/reflect/refract picked per instance, needs INSTANCED (materialModel)
+	SHADER_FEATURE_COUNT = 9
+};
+
+static const char *const shaderFeatureNames[SHADER_FEATURE_COUNT] = {
+	"INSTANCED", "SHADOWS", "SPOT_LIGHT", "DIR_LIGHT", "POINT_LIGHTS", "REFLECT", "REFRACT", "FLAT", "UBER_ASTEROID"
+};
+
+// Compiles specialised programs from one source per feature set and hands out the same
+// program for every later request, so each material only runs the code paths it uses.
+class ShaderVariants {
+private:
+	struct VariantKey {
+		string vertexPath;
+		string fragmentPath;
+		unsigned int features;
+		int pointLights;
+
+		bool operator<(const VariantKey &other) const {
+			if (features != other.features) {
+				return features < other.features;
+			}
+			if (pointLights != other.pointLights) {
+				return pointLights < other.pointLights;
+			}
+			if (vertexPath != other.vertexPath) {
+				return vertexPath < other.vertexPath;
+			}
+			return fragmentPath < other.fragmentPath;
+		}
+	};
+
+	map<VariantKey, Shader*> variants;
+
+	static string definesFor(unsigned int features, int pointLights) {
+		string defines;
+		for (int i = 0; i < SHADER_FEATURE_COUNT; i++) {
+			if (features & (1u << i)) {
+				defines += string("#define ") + shaderFeatureNames[i] + "\n";
+			}
+		}
+		if (features & SHADER_POINT_LIGHTS) {
+			defines += "#define NR_POINT_LIGHTS " + to_string(pointLights > 0 ? pointLights : 1) + "\n";
+		}
+		return defines;
+	}
+
+public:
+	~ShaderVariants() {
+		for (map<VariantKey, Shader*>::iterator it = variants.begin(); it != variants.end(); ++it) {
+			delete it->second;
+		}
+	}
+
+	Shader *get(const char *vertexPath, const char *fragmentPath, unsigned int features, int pointLights = 0) {
+		VariantKey key;
+		key.vertexPath = vertexPath;
+		key.fragmentPath = fragmentPath;
+		key.features = features;
+		key.pointLights = (features & SHADER_POINT_LIGHTS) ? pointLights : 0;
+		map<VariantKey, Shader*>::iterator found = variants.find(key);
+		if (found != variants.end()) {
+			return found->second;
+		}
+		Shader *shader = new Shader(vertexPath, fragmentPath, nullptr, definesFor(features, key.pointLights));
+		variants[key] = shader;
+		logDebug(CATEGORY_SHADER, "compiling variant {} + {} features {}", vertexPath, fragmentPath, features);
+		return shader;
+	}
+
+	int getVariantCount() {
+		return variants.size();
+	}
+};
+#endif
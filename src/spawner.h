@@ -0,0 +1,154 @@
+#pragma once
+#ifndef SPAWNER_H
+#define SPAWNER_H
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <vector>
+using namespace std;
+
+struct SpawnRequest {
+	int type; // Asteroida::types, or SPAWN_RANDOM_TYPE
+
+	SpawnRequest(int type) {
+		this->type = type;
+	}
+};
+
+const int SPAWN_RANDOM_TYPE = -1;
+
+// Uniform grid for Poisson-disk rejection. Cells are minDistance/sqrt(3) wide, so only the
+// 5x5x5 block around a candidate can hold a point closer than minDistance - a constant-time check.
+class PoissonGrid {
+private:
+	glm::vec3 origin;
+	glm::ivec3 dimensions;
+	float cellSize;
+	float minDistance;
+	vector<int> cellHeads; // first point in a cell, -1 if empty
+	vector<int> nextPoint; // next point in the same cell
+	vector<glm::vec3> points;
+
+	bool cellOf(glm::vec3 point, glm::ivec3 &cell) const {
+		glm::vec3 local = (point - origin) / cellSize;
+		cell = glm::ivec3(floor(local.x), floor(local.y), floor(local.z));
+		return cell.x >= 0 && cell.y >= 0 && cell.z >= 0 && cell.x < dimensions.x && cell.y < dimensions.y && cell.z < dimensions.z;
+	}
+
+	int cellIndex(glm::ivec3 cell) const {
+		return (cell.z * dimensions.y + cell.y) * dimensions.x + cell.x;
+	}
+
+public:
+	PoissonGrid() {
+		dimensions = glm::ivec3(0);
+		cellSize = 1.0f;
+		minDistance = 0.0f;
+	}
+
+	// covers the spawn volume plus one minDistance margin, anything further away can't reject a candidate
+	void reset(glm::vec3 minBounds, glm::vec3 maxBounds, float minDistance) {
+		this->minDistance = minDistance;
+		this->cellSize = minDistance / sqrt(3.0f);
+		this->origin = minBounds - glm::vec3(minDistance);
+		glm::vec3 extent = (maxBounds - minBounds + glm::vec3(2.0f * minDistance)) / cellSize;
+		dimensions = glm::ivec3(ceil(extent.x), ceil(extent.y), ceil(extent.z)) + glm::ivec3(1);
+		cellHeads.assign(dimensions.x * dimensions.y * dimensions.z, -1);
+		nextPoint.clear();
+		points.clear();
+	}
+
+	void insert(glm::vec3 point) {
+		glm::ivec3 cell;
+		if (!cellOf(point, cell)) {
+			return;
+		}
+		int index = cellIndex(cell);
+		points.push_back(point);
+		nextPoint.push_back(cellHeads[index]);
+		cellHeads[index] = points.size() - 1;
+	}
+
+	bool isFree(glm::vec3 candidate) const {
+		glm::ivec3 cell;
+		if (!cellOf(candidate, cell)) {
+			return false;
+		}
+		float minDistanceSquared = minDistance * minDistance;
+		glm::ivec3 from = glm::max(cell - glm::ivec3(2), glm::ivec3(0));
+		glm::ivec3 to = glm::min(cell + glm::ivec3(2), dimensions - glm::ivec3(1));
+		for (int z = from.z; z <= to.z; z++) {
+			for (int y = from.y; y <= to.y; y++) {
+				for (int x = from.x; x <= to.x; x++) {
+					for (int i = cellHeads[cellIndex(glm::ivec3(x, y, z))]; i >= 0; i = nextPoint[i]) {
+						glm::vec3 offset = points[i] - candidate;
+						if (glm::dot(offset, offset) < minDistanceSquared) {
+							return false;
+						}
+					}
+				}
+			}
+		}
+		return true;
+	}
+};
+
+// Collects spawn requests from any thread and releases at most `budget` of them per frame.
+class SpawnScheduler {
+private:
+	mutex requestsMutex;
+	deque<SpawnRequest> requests;
+	atomic<int> pendingCount;
+	int budget;
+
+public:
+	SpawnScheduler(int budget = 4) : pendingCount(0) {
+		this->budget = budget;
+	}
+
+	void request(int count, int type = SPAWN_RANDOM_TYPE) {
+		lock_guard<mutex> lock(requestsMutex);
+		for (int i = 0; i < count; i++) {
+			requests.push_back(SpawnRequest(type));
+		}
+		pendingCount += count;
+	}
+
+	// a frame's failed placements go back to the front, in the order they were taken, so they are
+	// retried first next frame
+	void retry(const vector<SpawnRequest> &failed) {
+		lock_guard<mutex> lock(requestsMutex);
+		requests.insert(requests.begin(), failed.begin(), failed.end());
+		pendingCount += failed.size();
+	}
+
+	void takeFrameBudget(vector<SpawnRequest> &out) {
+		out.clear();
+		lock_guard<mutex> lock(requestsMutex);
+		while (!requests.empty() && out.size() < budget) {
+			out.push_back(requests.front());
+			requests.pop_front();
+			pendingCount--;
+		}
+	}
+
+	int getPendingCount() const {
+		return pendingCount.load();
+	}
+
+	void setBudget(int budget) {
+		this->budget = budget;
+	}
+
+	void clear() {
+		lock_guard<mutex> lock(requestsMutex);
+		requests.clear();
+		pendingCount = 0;
+	}
+};
+#endif
@@ -0,0 +1,278 @@
+#pragma once
+#ifndef TEXTURE_BAKER_H
+#define TEXTURE_BAKER_H
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "textureCache.h"
+#include "vfs.h"
+#include "logger.h"
+using namespace std;
+
+// Decodes an image and computes its whole mip chain on the CPU, optionally block compressing
+// every level (BC1 for RGB, BC3 for RGBA). Nothing here touches GL, the game bakes on a cache
+// miss and the cook tool bakes everything ahead of time.
+class TextureBaker {
+private:
+	// 2x2 box filter; an odd last row or column is folded into its neighbour's average
+	static TextureLevel downsample(const TextureLevel &source, int channels) {
+		TextureLevel level;
+		level.width = max(1, source.width / 2);
+		level.height = max(1, source.height / 2);
+		level.data.resize((size_t)level.width * level.height * channels);
+		for (int y = 0; y < level.height; y++) {
+			int y0 = min(y * 2, source.height - 1);
+			int y1 = min(y * 2 + 1, source.height - 1);
+			for (int x = 0; x < level.width; x++) {
+				int x0 = min(x * 2, source.width - 1);
+				int x1 = min(x * 2 + 1, source.width - 1);
+				for (int c = 0; c < channels; c++) {
+					int sum = source.data[((size_t)y0 * source.width + x0) * channels + c] + source.data[((size_t)y0 * source.width + x1) * channels + c]
+						+ source.data[((size_t)y1 * source.width + x0) * channels + c] + source.data[((size_t)y1 * source.width + x1) * channels + c];
+					level.data[((size_t)y * level.width + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+		return level;
+	}
+
+	static unsigned short to565(const int color[3]) {
+		return (unsigned short)(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+	}
+
+	static void from565(unsigned short packed, int color[3]) {
+		int r = packed >> 11 & 31, g = packed >> 5 & 63, b = packed & 31;
+		color[0] = r << 3 | r >> 2;
+		color[1] = g << 2 | g >> 4;
+		color[2] = b << 3 | b >> 2;
+	}
+
+	// 4-colour BC1 block from 16 RGBA texels: endpoints span the block's colour box along the
+	// diagonal its texels lean towards, inset a little, and each texel takes the nearest of the four
+	static void encodeColorBlock(const unsigned char texels[16][4], unsigned char *block) {
+		int low[3] = { 255, 255, 255 }, high[3] = { 0, 0, 0 }, mean[3] = { 0, 0, 0 };
+		for (int i = 0; i < 16; i++) {
+			for (int c = 0; c < 3; c++) {
+				low[c] = min(low[c], (int)texels[i][c]);
+				high[c] = max(high[c], (int)texels[i][c]);
+				mean[c] += texels[i][c];
+			}
+		}
+		// green and blue running against red flip their end of the diagonal
+		int covariance[3] = { 0, 0, 0 };
+		for (int i = 0; i < 16; i++) {
+			int red = texels[i][0] * 16 - mean[0];
+			for (int c = 1; c < 3; c++) {
+				covariance[c] += red * (texels[i][c] * 16 - mean[c]);
+			}
+		}
+		for (int c = 1; c < 3; c++) {
+			if (covariance[c] < 0) {
+				swap(low[c], high[c]);
+			}
+		}
+		for (int c = 0; c < 3; c++) {
+			int inset = (high[c] - low[c]) / 16;
+			high[c] -= inset;
+			low[c] += inset;
+		}
+
+		unsigned short color0 = to565(high), color1 = to565(low);
+		if (color0 < color1) {
+			swap(color0, color1);
+		}
+		int palette[4][3];
+		from565(color0, palette[0]);
+		from565(color1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		unsigned int indices = 0;
+		if (color0 != color1) {
+			for (int i = 0; i < 16; i++) {
+				int best = 0, bestDistance = 1 << 30;
+				for (int p = 0; p < 4; p++) {
+					int distance = 0;
+					for (int c = 0; c < 3; c++) {
+						int difference = texels[i][c] - palette[p][c];
+						distance += difference * difference;
+					}
+					if (distance < bestDistance) {
+						best = p;
+						bestDistance = distance;
+					}
+				}
+				indices |= (unsigned int)best << (2 * i);
+			}
+		}
+		block[0] = color0 & 0xFF;
+		block[1] = color0 >> 8;
+		block[2] = color1 & 0xFF;
+		block[3] = color1 >> 8;
+		for (int b = 0; b < 4; b++) {
+			block[4 + b] = (indices >> (8 * b)) & 0xFF;
+		}
+	}
+
+	// 8-value BC3 alpha block between the block's lowest and highest alpha
+	static void encodeAlphaBlock(const unsigned char texels[16][4], unsigned char *block) {
+		int low = 255, high = 0;
+		for (int i = 0; i < 16; i++) {
+			low = min(low, (int)texels[i][3]);
+			high = max(high, (int)texels[i][3]);
+		}
+		int palette[8];
+		palette[0] = high;
+		palette[1] = low;
+		for (int p = 1; p < 7; p++) {
+			palette[p + 1] = ((7 - p) * high + p * low) / 7;
+		}
+		unsigned long long indices = 0;
+		if (high != low) {
+			for (int i = 0; i < 16; i++) {
+				int best = 0, bestDistance = 256;
+				for (int p = 0; p < 8; p++) {
+					int distance = abs(texels[i][3] - palette[p]);
+					if (distance < bestDistance) {
+						best = p;
+						bestDistance = distance;
+					}
+				}
+				indices |= (unsigned long long)best << (3 * i);
+			}
+		}
+		block[0] = high;
+		block[1] = low;
+		for (int b = 0; b < 6; b++) {
+			block[2 + b] = (indices >> (8 * b)) & 0xFF;
+		}
+	}
+
+	// edge blocks of sizes that aren't a multiple of 4 repeat the last row and column
+	static TextureLevel compress(const TextureLevel &source, int channels, int format) {
+		TextureLevel level;
+		level.width = source.width;
+		level.height = source.height;
+		level.data.resize(textureLevelSize(format, source.width, source.height));
+		int blockBytes = format == TEXTURE_FORMAT_BC3 ? 16 : 8;
+		unsigned char *block = level.data.empty() ? NULL : &level.data[0];
+		for (int by = 0; by < source.height; by += 4) {
+			for (int bx = 0; bx < source.width; bx += 4) {
+				unsigned char texels[16][4];
+				for (int i = 0; i < 16; i++) {
+					int x = min(bx + i % 4, source.width - 1);
+					int y = min(by + i / 4, source.height - 1);
+					const unsigned char *texel = &source.data[((size_t)y * source.width + x) * channels];
+					texels[i][0] = texel[0];
+					texels[i][1] = texel[1];
+					texels[i][2] = texel[2];
+					texels[i][3] = channels == 4 ? texel[3] : 255;
+				}
+				if (format == TEXTURE_FORMAT_BC3) {
+					encodeAlphaBlock(texels, block);
+					encodeColorBlock(texels, block + 8);
+				}
+				else {
+					encodeColorBlock(texels, block);
+				}
+				block += blockBytes;
+			}
+		}
+		return level;
+	}
+
+public:
+	// decodes sourcePath into a full mip chain; single channel images are never compressed
+	static bool bake(const string &sourcePath, bool compressed, TextureImage &image) {
+		VfsFile file;
+		if (!vfs().open(sourcePath, file)) {
+			logError(CATEGORY_ASSETS, "Texture failed to load at path: {} (can't read the file)", sourcePath);
+			return false;
+		}
+		int width, height, channels;
+		unsigned char *data = stbi_load_from_memory(file.getData(), (int)file.getSize(), &width, &height, &channels, 0);
+		if (data != NULL && channels == 2) {
+			// grey and alpha is uploaded as RGBA
+			stbi_image_free(data);
+			data = stbi_load_from_memory(file.getData(), (int)file.getSize(), &width, &height, &channels, 4);
+			channels = 4;
+		}
+		file.close();
+		if (data == NULL) {
+			logError(CATEGORY_ASSETS, "Texture failed to load at path: {} ({})", sourcePath, stbi_failure_reason());
+			return false;
+		}
+
+		vector<TextureLevel> levels(1);
+		levels[0].width = width;
+		levels[0].height = height;
+		levels[0].data.assign(data, data + (size_t)width * height * channels);
+		stbi_image_free(data);
+		while ((levels.back().width > 1 || levels.back().height > 1) && levels.size() < TEXTURE_CACHE_MAX_LEVELS) {
+			levels.push_back(downsample(levels.back(), channels));
+		}
+
+		image.format = channels == 1 ? TEXTURE_FORMAT_R8 : channels == 3 ? TEXTURE_FORMAT_RGB8 : TEXTURE_FORMAT_RGBA8;
+		if (compressed && channels > 1) {
+			image.format = channels == 4 ? TEXTURE_FORMAT_BC3 : TEXTURE_FORMAT_BC1;
+			for (int i = 0; i < levels.size(); i++) {
+				levels[i] = compress(levels[i], channels, image.format);
+			}
+		}
+		image.levels.swap(levels);
+		return true;
+	}
+
+	// the baked copy of sourcePath: either its cache, opened, if that's current (and, when block
+	// compressed, usable), or otherwise baked uncompressed into image and stored for next time. A
+	// block compressed cache the driver can't use is left alone, it's what the cook shipped
+	static bool load(const string &sourcePath, bool acceptCompressed, TextureCache &cache, TextureImage &image) {
+		bool keepCache = false;
+		if (cache.open(sourcePath)) {
+			if (acceptCompressed || !isCompressedTextureFormat(cache.getFormat())) {
+				return true;
+			}
+			logWarning(CATEGORY_ASSETS, "{} is baked block compressed, which the driver doesn't support", sourcePath);
+			cache.close();
+			keepCache = true;
+		}
+#ifdef ASSETS_COOKED_ONLY
+		logError(CATEGORY_ASSETS, "{} has not been cooked, run asteroids-cook", sourcePath);
+		return false;
+#else
+		if (!bake(sourcePath, false, image)) {
+			return false;
+		}
+		if (!keepCache) {
+			TextureCache::store(sourcePath, image);
+		}
+		return true;
+#endif
+	}
+
+	// the baked copy of sourcePath in memory, copied out of its cache when that's current
+	static bool load(const string &sourcePath, bool acceptCompressed, TextureImage &image) {
+		TextureCache cache;
+		if (!load(sourcePath, acceptCompressed, cache, image)) {
+			return false;
+		}
+		if (cache.isOpen()) {
+			image.format = cache.getFormat();
+			image.levels.resize(cache.getLevelCount());
+			for (int i = 0; i < cache.getLevelCount(); i++) {
+				image.levels[i].width = cache.getLevelWidth(i);
+				image.levels[i].height = cache.getLevelHeight(i);
+				image.levels[i].data.assign(cache.getLevelData(i), cache.getLevelData(i) + cache.getLevelSize(i));
+			}
+		}
+		return true;
+	}
+};
+#endif
@@ -0,0 +1,233 @@
+#pragma once
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include "vfs.h"
+#include "assetPath.h"
+#include "contentHash.h"
+#include "logger.h"
+using namespace std;
+
+// Baked textures, one file per source image in texturecache/:
+//   header | level records | 16-byte aligned level data, largest level first
+// Every mip level is computed offline (see TextureBaker), so loading one is a mapping and one
+// glTexImage2D or glCompressedTexImage2D per level. The header pins the source's size and time
+// like the mesh cache does; builds with ASSETS_COOKED_ONLY skip that check.
+const unsigned int TEXTURE_CACHE_MAGIC = 0x58455441; // "ATEX"
+const unsigned int TEXTURE_CACHE_VERSION = 1;        // bump when the baker or the layout changes
+const int TEXTURE_CACHE_MAX_LEVELS = 16;
+
+enum TextureFormat {
+	TEXTURE_FORMAT_R8,
+	TEXTURE_FORMAT_RGB8,
+	TEXTURE_FORMAT_RGBA8,
+	TEXTURE_FORMAT_BC1, // RGB in 8 bytes per 4x4 block
+	TEXTURE_FORMAT_BC3, // RGBA in 16 bytes per 4x4 block
+	TEXTURE_FORMAT_COUNT
+};
+
+inline bool isCompressedTextureFormat(int format) {
+	return format == TEXTURE_FORMAT_BC1 || format == TEXTURE_FORMAT_BC3;
+}
+
+// bytes of one level, block formats round up to whole blocks
+inline size_t textureLevelSize(int format, int width, int height) {
+	switch (format) {
+	case TEXTURE_FORMAT_R8: return (size_t)width * height;
+	case TEXTURE_FORMAT_RGB8: return (size_t)width * height * 3;
+	case TEXTURE_FORMAT_RGBA8: return (size_t)width * height * 4;
+	case TEXTURE_FORMAT_BC1: return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 8;
+	case TEXTURE_FORMAT_BC3: return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 16;
+	default: return 0;
+	}
+}
+
+struct TextureLevel {
+	int width;
+	int height;
+	vector<unsigned char> data;
+};
+
+// a baked image in memory, levels[0] is the full size one
+struct TextureImage {
+	int format;
+	vector<TextureLevel> levels;
+};
+
+struct TextureCacheHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int format;
+	unsigned int levelCount;
+	unsigned long long sourceSize;
+	unsigned long long sourceTime;
+};
+
+struct TextureCacheLevel {
+	unsigned int width;
+	unsigned int height;
+	unsigned long long offset;
+	unsigned long long size;
+};
+
+class TextureCache {
+private:
+	VfsFile file;
+	const TextureCacheHeader *header;
+	const TextureCacheLevel *levels;
+
+	static const char *directory() {
+		return "texturecache";
+	}
+
+	static size_t align(size_t offset) {
+		return (offset + 15) & ~(size_t)15;
+	}
+
+	// from the asset archive when the source is packed, so packed caches check against packed sources
+	static bool sourceStamp(const string &sourcePath, unsigned long long &size, unsigned long long &time) {
+		return vfs().stat(sourcePath, size, time);
+	}
+
+	bool validate(const string &sourcePath) {
+		size_t fileSize = file.getSize();
+		if (fileSize < sizeof(TextureCacheHeader)) {
+			return false;
+		}
+		header = (const TextureCacheHeader*)file.getData();
+		if (header->magic != TEXTURE_CACHE_MAGIC || header->version != TEXTURE_CACHE_VERSION || header->format >= TEXTURE_FORMAT_COUNT
+			|| header->levelCount == 0 || header->levelCount > TEXTURE_CACHE_MAX_LEVELS) {
+			return false;
+		}
+#ifndef ASSETS_COOKED_ONLY
+		unsigned long long size, time;
+		if (!sourceStamp(sourcePath, size, time) || header->sourceSize != size || header->sourceTime != time) {
+			return false;
+		}
+#endif
+		if (sizeof(TextureCacheHeader) + header->levelCount * sizeof(TextureCacheLevel) > fileSize) {
+			return false;
+		}
+		levels = (const TextureCacheLevel*)(file.getData() + sizeof(TextureCacheHeader));
+		for (unsigned int i = 0; i < header->levelCount; i++) {
+			if (levels[i].size != textureLevelSize(header->format, levels[i].width, levels[i].height) || levels[i].offset + levels[i].size > fileSize) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+public:
+	TextureCache() {
+		header = NULL;
+		levels = NULL;
+	}
+
+	static string path(const string &sourcePath) {
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.tex", contentHash(canonicalAssetPath(sourcePath)));
+		return string(directory()) + "/" + name;
+	}
+
+	// maps the baked copy of sourcePath; false if there is none or it's stale
+	bool open(const string &sourcePath) {
+		if (!vfs().open(path(sourcePath), file)) {
+			return false;
+		}
+		if (!validate(sourcePath)) {
+			logInfo(CATEGORY_ASSETS, "texture cache {} of {} is stale", path(sourcePath), sourcePath);
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close() {
+		file.close();
+		header = NULL;
+	}
+
+	bool isOpen() const {
+		return header != NULL;
+	}
+
+	int getFormat() const {
+		return header->format;
+	}
+
+	int getLevelCount() const {
+		return header->levelCount;
+	}
+
+	int getLevelWidth(int level) const {
+		return levels[level].width;
+	}
+
+	int getLevelHeight(int level) const {
+		return levels[level].height;
+	}
+
+	const unsigned char *getLevelData(int level) const {
+		return file.getData() + levels[level].offset;
+	}
+
+	size_t getLevelSize(int level) const {
+		return (size_t)levels[level].size;
+	}
+
+	static bool store(const string &sourcePath, const TextureImage &image) {
+		TextureCacheHeader header;
+		memset(&header, 0, sizeof(header));
+		header.magic = TEXTURE_CACHE_MAGIC;
+		header.version = TEXTURE_CACHE_VERSION;
+		header.format = image.format;
+		header.levelCount = image.levels.size();
+		if (image.levels.empty() || image.levels.size() > TEXTURE_CACHE_MAX_LEVELS || !sourceStamp(sourcePath, header.sourceSize, header.sourceTime)) {
+			return false;
+		}
+
+		vector<TextureCacheLevel> records(image.levels.size());
+		size_t offset = align(sizeof(TextureCacheHeader) + records.size() * sizeof(TextureCacheLevel));
+		for (int i = 0; i < image.levels.size(); i++) {
+			records[i].width = image.levels[i].width;
+			records[i].height = image.levels[i].height;
+			records[i].size = image.levels[i].data.size();
+			records[i].offset = offset;
+			offset = align(offset + image.levels[i].data.size());
+		}
+
+#ifdef _WIN32
+		_mkdir(directory());
+#else
+		mkdir(directory(), 0755);
+#endif
+		string target = path(sourcePath);
+		ofstream out(target.c_str(), ios::binary | ios::trunc);
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)&records[0], records.size() * sizeof(TextureCacheLevel));
+		const char padding[16] = { 0 };
+		for (int i = 0; i < image.levels.size(); i++) {
+			out.write(padding, records[i].offset - (size_t)out.tellp());
+			out.write((const char*)&image.levels[i].data[0], image.levels[i].data.size());
+		}
+		if (!out) {
+			logWarning(CATEGORY_ASSETS, "could not write texture cache {}", target);
+			out.close();
+			remove(target.c_str());
+			return false;
+		}
+		return true;
+	}
+};
+#endif
@@ -0,0 +1,95 @@
+#pragma once
+#ifndef UNIFORM_BUFFERS_H
+#define UNIFORM_BUFFERS_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <cstring>
+
+#include "glState.h"
+#include "glResource.h"
+using namespace std;
+
+// Binding points shared by every program. Shader hooks its blocks up to these after linking,
+// so a buffer bound here once is seen by all of them.
+enum UniformBlockBinding {
+	FRAME_BLOCK_BINDING,    // uniform Frame: camera and projection
+	LIGHTS_BLOCK_BINDING,   // uniform Lights
+	MATERIAL_BLOCK_BINDING, // uniform Material
+	UNIFORM_BLOCK_BINDING_COUNT
+};
+
+static const char *const uniformBlockNames[UNIFORM_BLOCK_BINDING_COUNT] = { "Frame", "Lights", "Material" };
+
+// C++ mirrors of the std140 blocks. Every vec3 is followed by a float (or padding) because
+// std140 aligns vec3 to 16 bytes; the GLSL declarations keep the same order.
+struct FrameUniforms {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 cameraPos;
+	float padding;
+};
+
+struct SpotLightUniforms {
+	glm::vec3 position;
+	float cutOff;
+	glm::vec3 direction;
+	float outerCutOff;
+	glm::vec3 ambient;
+	float constant;
+	glm::vec3 diffuse;
+	float linear;
+	glm::vec3 specular;
+	float quadratic;
+};
+
+struct LightUniforms {
+	SpotLightUniforms spotLight;
+};
+
+struct MaterialUniforms {
+	glm::vec3 ambient;
+	float shininess;
+	glm::vec3 specular;
+	float padding;
+};
+
+// One uniform buffer bound to a fixed binding point for its whole life. update() keeps a copy
+// of the last upload and only touches the buffer when the contents actually changed.
+template<typename T>
+class UniformBuffer {
+private:
+	GLBuffer UBO;
+	T uploaded;
+	bool valid;
+
+public:
+	UniformBuffer(UniformBlockBinding binding) {
+		this->valid = false;
+		memset(&uploaded, 0, sizeof(T));
+		UBO = GLBuffer::create();
+		glState().bindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(T), NULL, GL_DYNAMIC_DRAW);
+		UBO.setSize(sizeof(T));
+		glBindBufferBase(GL_UNIFORM_BUFFER, binding, UBO); // also binds the generic target, matching the cache
+	}
+
+	// returns true if the buffer was written
+	bool update(const T &contents) {
+		if (valid && memcmp(&uploaded, &contents, sizeof(T)) == 0) {
+			return false;
+		}
+		uploaded = contents;
+		valid = true;
+		glState().bindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &uploaded);
+		return true;
+	}
+
+	GLuint getID() {
+		return UBO;
+	}
+};
+#endif
@@ -0,0 +1,124 @@
+#pragma once
+#ifndef VFS_H
+#define VFS_H
+
+#include <string>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "assetArchive.h"
+#include "mappedFile.h"
+#include "logger.h"
+using namespace std;
+
+// A file's contents as loaders see them: a span into the mounted archive, or a mapping of the
+// loose file when the archive doesn't have it. Valid until closed, never copied.
+class VfsFile {
+private:
+	const unsigned char *data;
+	size_t size;
+	MappedFile loose;
+
+	VfsFile(const VfsFile &other);
+	VfsFile &operator=(const VfsFile &other);
+
+	friend class VirtualFileSystem;
+
+public:
+	VfsFile() {
+		data = NULL;
+		size = 0;
+	}
+
+	void close() {
+		loose.close();
+		data = NULL;
+		size = 0;
+	}
+
+	bool isOpen() const {
+		return data != NULL;
+	}
+
+	const unsigned char *getData() const {
+		return data;
+	}
+
+	size_t getSize() const {
+		return size;
+	}
+};
+
+// Where loaders get files from. With an archive mounted, a lookup is a binary search in memory
+// that's already mapped, and the loaders read the packed bytes in place; without one (or for
+// files it doesn't have) they read the loose files, so a development build needs no packing.
+// Mount once at startup, before anything loads; lookups are then safe from any thread.
+class VirtualFileSystem {
+private:
+	AssetArchive archive;
+
+	VirtualFileSystem() {
+	}
+
+public:
+	static VirtualFileSystem &instance() {
+		static VirtualFileSystem vfs;
+		return vfs;
+	}
+
+	bool mount(const string &archivePath) {
+		if (!archive.open(archivePath)) {
+			logInfo(CATEGORY_ASSETS, "no asset archive {}, loading loose files", archivePath);
+			return false;
+		}
+		logInfo(CATEGORY_ASSETS, "mounted {} with {} files", archivePath, archive.getEntryCount());
+		return true;
+	}
+
+	void unmount() {
+		archive.close();
+	}
+
+	bool open(const string &path, VfsFile &file) {
+		file.close();
+		const AssetArchiveEntry *entry = archive.find(path);
+		if (entry != NULL) {
+			file.data = archive.getData(*entry);
+			file.size = (size_t)entry->size;
+			return true;
+		}
+		if (!file.loose.open(path)) {
+			return false;
+		}
+		file.data = file.loose.getData();
+		file.size = file.loose.getSize();
+		return true;
+	}
+
+	bool exists(const string &path) {
+		struct stat status;
+		return archive.find(path) != NULL || ::stat(path.c_str(), &status) == 0;
+	}
+
+	// size and modification time of the file open() would read
+	bool stat(const string &path, unsigned long long &size, unsigned long long &time) {
+		const AssetArchiveEntry *entry = archive.find(path);
+		if (entry != NULL) {
+			size = entry->size;
+			time = entry->time;
+			return true;
+		}
+		struct stat status;
+		if (::stat(path.c_str(), &status) != 0) {
+			return false;
+		}
+		size = status.st_size;
+		time = status.st_mtime;
+		return true;
+	}
+};
+
+inline VirtualFileSystem &vfs() {
+	return VirtualFileSystem::instance();
+}
+#endif
@@ -0,0 +1,183 @@
+// asteroids-objbench [--rocks count] [--runs count] [model.obj]
+//
+// Times the dedicated OBJ parser (src/objImporter.h) against the ASSIMP import it replaced and
+// checks they agree: same meshes and materials, and every triangle corner with the same position,
+// texture coordinates and normal. Tangent frames are compared by how many corners agree, not
+// corner by corner: ASSIMP's smoothing is greedy and merges across UV seams, and at a pole there
+// is no right answer. Without a model it writes a procedural asteroid field, the kind of large
+// export the parser is for. Exits with 1 if the imports disagree.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "meshImporter.h"
+#include "objImporter.h"
+#include "logger.h"
+using namespace std;
+
+const float POSITION_TOLERANCE = 1e-5f;     // relative to the coordinate's magnitude
+const float TANGENT_TOLERANCE_DEGREES = 20.0f;
+const float TANGENT_AGREEMENT = 0.95f;      // share of corners whose frames have to be within the tolerance
+
+// rocks of displaced spheres in a ring, quads with positions, texture coordinates and normals
+static bool writeField(const string &path, int rocks) {
+	FILE *file = fopen(path.c_str(), "wb");
+	if (file == NULL) {
+		return false;
+	}
+	const int rings = 24, segments = 48;
+	const float pi = 3.14159265f;
+	srand(7);
+	fprintf(file, "# procedural asteroid field, %d rocks\n", rocks);
+	int base = 1;
+	for (int r = 0; r < rocks; r++) {
+		float angle = 2.0f * pi * r / rocks, distance = 100.0f + rand() % 4000 / 100.0f;
+		glm::vec3 center(cos(angle) * distance, (rand() % 2000 - 1000) / 100.0f, sin(angle) * distance);
+		float radius = 0.5f + rand() % 100 / 50.0f, phase = rand() % 628 / 100.0f;
+		fprintf(file, "o rock%d\n", r);
+		for (int y = 0; y <= rings; y++) {
+			for (int x = 0; x <= segments; x++) {
+				float theta = pi * y / rings, phi = 2.0f * pi * x / segments;
+				glm::vec3 normal(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+				float bump = 1.0f + 0.15f * sin(3.0f * phi + phase) * sin(5.0f * theta);
+				glm::vec3 position = center + normal * radius * bump;
+				fprintf(file, "v %.6f %.6f %.6f\n", position.x, position.y, position.z);
+				fprintf(file, "vt %.6f %.6f\n", (float)x / segments, (float)y / rings);
+				fprintf(file, "vn %.6f %.6f %.6f\n", normal.x, normal.y, normal.z);
+			}
+		}
+		for (int y = 0; y < rings; y++) {
+			for (int x = 0; x < segments; x++) {
+				int a = base + y * (segments + 1) + x, b = a + segments + 1;
+				fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, b + 1, b + 1, b + 1, a + 1, a + 1, a + 1);
+			}
+		}
+		base += (rings + 1) * (segments + 1);
+	}
+	return fclose(file) == 0;
+}
+
+// best of runs, in milliseconds
+static double timeImport(bool (*import)(const string&, vector<MeshData>&), const string &path, int runs, vector<MeshData> &meshes) {
+	double best = 1e30;
+	for (int i = 0; i < runs; i++) {
+		meshes.clear();
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		if (!import(path, meshes)) {
+			return -1.0;
+		}
+		best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+static bool importObj(const string &path, vector<MeshData> &meshes) {
+	return ObjImporter::import(path, meshes);
+}
+
+static bool importAssimp(const string &path, vector<MeshData> &meshes) {
+	return MeshImporter::importWithAssimp(path, meshes);
+}
+
+static float angleDegrees(glm::vec3 a, glm::vec3 b) {
+	float lengths = glm::length(a) * glm::length(b);
+	if (lengths == 0.0f) {
+		return 0.0f;
+	}
+	return acos(glm::clamp(glm::dot(a, b) / lengths, -1.0f, 1.0f)) * 180.0f / 3.14159265f;
+}
+
+static bool close(glm::vec3 a, glm::vec3 b) {
+	glm::vec3 difference = glm::abs(a - b);
+	glm::vec3 scale = glm::max(glm::abs(a), glm::vec3(1.0f));
+	return difference.x <= POSITION_TOLERANCE * scale.x && difference.y <= POSITION_TOLERANCE * scale.y && difference.z <= POSITION_TOLERANCE * scale.z;
+}
+
+static bool compare(const vector<MeshData> &ours, const vector<MeshData> &theirs) {
+	if (ours.size() != theirs.size()) {
+		logError(CATEGORY_ASSETS, "{} meshes, ASSIMP has {}", (int)ours.size(), (int)theirs.size());
+		return false;
+	}
+	int mismatches = 0;
+	size_t corners = 0, agreeingTangents = 0;
+	size_t vertices = 0, assimpVertices = 0;
+	for (int m = 0; m < ours.size(); m++) {
+		vertices += ours[m].vertices.size();
+		assimpVertices += theirs[m].vertices.size();
+		if (ours[m].indices.size() != theirs[m].indices.size() || ours[m].textures.size() != theirs[m].textures.size()) {
+			logError(CATEGORY_ASSETS, "mesh {}: {} indices and {} textures, ASSIMP has {} and {}", m, (int)ours[m].indices.size(),
+				(int)ours[m].textures.size(), (int)theirs[m].indices.size(), (int)theirs[m].textures.size());
+			return false;
+		}
+		for (int t = 0; t < ours[m].textures.size(); t++) {
+			if (ours[m].textures[t].type != theirs[m].textures[t].type || ours[m].textures[t].path != theirs[m].textures[t].path) {
+				logError(CATEGORY_ASSETS, "mesh {}: texture {} {}, ASSIMP has {} {}", m, ours[m].textures[t].type, ours[m].textures[t].path,
+					theirs[m].textures[t].type, theirs[m].textures[t].path);
+				return false;
+			}
+		}
+		for (size_t i = 0; i < ours[m].indices.size(); i++) {
+			const Vertex &a = ours[m].vertices[ours[m].indices[i]], &b = theirs[m].vertices[theirs[m].indices[i]];
+			if (!close(a.Position, b.Position) || !close(a.Normal, b.Normal) || !close(glm::vec3(a.TexCoords, 0.0f), glm::vec3(b.TexCoords, 0.0f))) {
+				if (mismatches++ < 5) {
+					logError(CATEGORY_ASSETS, "mesh {} corner {}: ({} {} {}) differs from ASSIMP's ({} {} {})", m, (int)i,
+						a.Position.x, a.Position.y, a.Position.z, b.Position.x, b.Position.y, b.Position.z);
+				}
+			}
+			corners++;
+			if (max(angleDegrees(a.Tangent, b.Tangent), angleDegrees(a.Bitangent, b.Bitangent)) <= TANGENT_TOLERANCE_DEGREES) {
+				agreeingTangents++;
+			}
+		}
+	}
+	float agreement = corners > 0 ? (float)agreeingTangents / corners : 1.0f;
+	logInfo(CATEGORY_ASSETS, "{} vertices, ASSIMP {}; {}% of tangent frames within {} degrees", (int)vertices, (int)assimpVertices,
+		agreement * 100.0f, TANGENT_TOLERANCE_DEGREES);
+	if (mismatches > 0) {
+		logError(CATEGORY_ASSETS, "{} corners differ", mismatches);
+	}
+	return mismatches == 0 && agreement >= TANGENT_AGREEMENT;
+}
+
+int main(int argc, char **argv) {
+	int rocks = 400, runs = 3;
+	string path;
+	for (int i = 1; i < argc; i++) {
+		if (string(argv[i]) == "--rocks" && i + 1 < argc) {
+			rocks = max(1, atoi(argv[++i]));
+		}
+		else if (string(argv[i]) == "--runs" && i + 1 < argc) {
+			runs = max(1, atoi(argv[++i]));
+		}
+		else {
+			path = argv[i];
+		}
+	}
+	bool generated = path.empty();
+	if (generated) {
+		path = "objbench_field.obj";
+		if (!writeField(path, rocks)) {
+			logError(CATEGORY_ASSETS, "could not write {}", path);
+			return 1;
+		}
+	}
+
+	vector<MeshData> ours, theirs;
+	double objTime = timeImport(importObj, path, runs, ours);
+	double assimpTime = timeImport(importAssimp, path, runs, theirs);
+	if (generated) {
+		remove(path.c_str());
+	}
+	if (objTime < 0.0 || assimpTime < 0.0) {
+		logError(CATEGORY_ASSETS, "could not import {}", path);
+		return 1;
+	}
+	logInfo(CATEGORY_ASSETS, "{}: OBJ parser {} ms, ASSIMP {} ms, {}x faster", path, objTime, assimpTime, assimpTime / max(objTime, 0.001));
+	return compare(ours, theirs) ? 0 : 1;
+}
@@ -0,0 +1,301 @@
+// asteroids-cook [--force] [--compress] [--pack] [gameDirectory]
+//
+// Cooks everything under gameDirectory/res into the caches the game loads instead of the sources,
+// so a cooked game never parses a model or decodes an image at startup. --compress bakes colour
+// textures as BC1/BC3 blocks, for drivers with S3TC. Inputs are content hashed into cook.manifest
+// and only what changed since the last run is cooked again; independent assets cook in parallel.
+// --pack then puts res/ and the caches into one archive, assets.pak, which the game maps at startup.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <assimp/Importer.hpp>
+
+#include "meshImporter.h"
+#include "meshCache.h"
+#include "textureBaker.h"
+#include "textureCache.h"
+#include "contentHash.h"
+#include "assetArchive.h"
+#include "logger.h"
+using namespace std;
+
+namespace fs = std::filesystem;
+
+const char *COOK_MANIFEST = "cook.manifest";
+const char *ASSET_ARCHIVE = "assets.pak";
+
+enum CookRule { RULE_MESH, RULE_TEXTURE };
+
+static const char *const cookRuleNames[] = { "mesh", "texture" };
+
+static bool compressTextures = false;
+
+struct CookJob {
+	string sourcePath;         // relative to the game directory, the way the game loads it
+	vector<string> inputs;     // every file the output depends on, sourcePath first
+	CookRule rule;
+	unsigned int ruleVersion;  // bumping the output format invalidates the manifest entries
+	unsigned long long hash;
+	bool succeeded;
+};
+
+struct ManifestEntry {
+	unsigned long long hash;
+	unsigned int ruleVersion;
+};
+
+// "hash ruleVersion path" per line
+static map<string, ManifestEntry> readManifest() {
+	map<string, ManifestEntry> manifest;
+	ifstream file(COOK_MANIFEST);
+	string path;
+	ManifestEntry entry;
+	while (file >> hex >> entry.hash >> dec >> entry.ruleVersion && getline(file >> ws, path)) {
+		manifest[path] = entry;
+	}
+	return manifest;
+}
+
+static bool writeManifest(const vector<CookJob> &jobs) {
+	ofstream file(COOK_MANIFEST, ios::trunc);
+	for (int i = 0; i < jobs.size(); i++) {
+		if (jobs[i].succeeded) {
+			file << hex << jobs[i].hash << dec << ' ' << jobs[i].ruleVersion << ' ' << jobs[i].sourcePath << '\n';
+		}
+	}
+	return (bool)file;
+}
+
+static string lowercaseExtension(const fs::path &path) {
+	string extension = path.extension().string();
+	transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	return extension;
+}
+
+// which rule cooks a file, if any. Files nothing cooks (shaders, material libraries) are loaded
+// as they are, loose or packed.
+static bool ruleFor(const fs::path &path, Assimp::Importer &importer, CookRule &rule, unsigned int &ruleVersion) {
+	string extension = lowercaseExtension(path);
+	if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp") {
+		rule = RULE_TEXTURE;
+		ruleVersion = TEXTURE_CACHE_VERSION;
+		return true;
+	}
+	if (extension != ".mtl" && importer.IsExtensionSupported(extension.c_str())) {
+		rule = RULE_MESH;
+		ruleVersion = MESH_CACHE_VERSION;
+		return true;
+	}
+	return false;
+}
+
+// a model's materials come from its .mtl files, so they are inputs too
+static vector<string> inputsOf(const fs::path &path, CookRule rule) {
+	vector<string> inputs;
+	inputs.push_back(path.generic_string());
+	if (rule == RULE_MESH && lowercaseExtension(path) == ".obj") {
+		vector<string> libraries;
+		for (const fs::directory_entry &entry : fs::directory_iterator(path.parent_path())) {
+			if (entry.is_regular_file() && lowercaseExtension(entry.path()) == ".mtl") {
+				libraries.push_back(entry.path().generic_string());
+			}
+		}
+		sort(libraries.begin(), libraries.end());
+		inputs.insert(inputs.end(), libraries.begin(), libraries.end());
+	}
+	return inputs;
+}
+
+static bool hashInputs(CookJob &job) {
+	job.hash = contentHash(cookRuleNames[job.rule]);
+	if (job.rule == RULE_TEXTURE) {
+		job.hash = contentHash(string(compressTextures ? "bc" : "raw"), job.hash);
+	}
+	for (int i = 0; i < job.inputs.size(); i++) {
+		unsigned long long fileHash;
+		if (!fileContentHash(job.inputs[i], fileHash)) {
+			logError(CATEGORY_ASSETS, "could not read {}", job.inputs[i]);
+			return false;
+		}
+		job.hash = contentHash(job.inputs[i], job.hash);
+		job.hash = contentHash(&fileHash, sizeof(fileHash), job.hash);
+	}
+	return true;
+}
+
+// the manifest only says the inputs are unchanged; the output also has to be there and current
+static bool isCooked(const CookJob &job, const map<string, ManifestEntry> &manifest) {
+	map<string, ManifestEntry>::const_iterator found = manifest.find(job.sourcePath);
+	if (found == manifest.end() || found->second.hash != job.hash || found->second.ruleVersion != job.ruleVersion) {
+		return false;
+	}
+	switch (job.rule) {
+	case RULE_MESH: {
+		MeshCache cache;
+		return cache.open(job.sourcePath);
+	}
+	case RULE_TEXTURE: {
+		TextureCache cache;
+		return cache.open(job.sourcePath);
+	}
+	}
+	return false;
+}
+
+static bool cookMesh(const CookJob &job) {
+	vector<MeshData> meshes;
+	if (!MeshImporter::import(job.sourcePath, meshes)) {
+		return false;
+	}
+	glm::vec3 boundsMin, boundsMax;
+	computeBounds(meshes, boundsMin, boundsMax);
+	return MeshCache::store(job.sourcePath, meshes, boundsMin, boundsMax);
+}
+
+static bool cookTexture(const CookJob &job) {
+	TextureImage image;
+	return TextureBaker::bake(job.sourcePath, compressTextures, image) && TextureCache::store(job.sourcePath, image);
+}
+
+// the packed files keep their paths, so the game finds them by the same names it loads loose
+static bool pack() {
+	vector<string> files;
+	const char *const directories[] = { "res", "meshcache", "texturecache" };
+	for (int d = 0; d < 3; d++) {
+		if (!fs::is_directory(directories[d])) {
+			continue;
+		}
+		for (const fs::directory_entry &entry : fs::recursive_directory_iterator(directories[d])) {
+			if (entry.is_regular_file()) {
+				files.push_back(entry.path().generic_string());
+			}
+		}
+	}
+	if (!AssetArchive::write(ASSET_ARCHIVE, files)) {
+		return false;
+	}
+	logInfo(CATEGORY_ASSETS, "packed {} files into {}", (int)files.size(), ASSET_ARCHIVE);
+	return true;
+}
+
+static bool cook(const CookJob &job) {
+	switch (job.rule) {
+	case RULE_MESH: return cookMesh(job);
+	case RULE_TEXTURE: return cookTexture(job);
+	}
+	return false;
+}
+
+// workers take the next job until none are left, jobs don't depend on each other
+static void cookAll(vector<CookJob> &jobs, const vector<int> &pending) {
+	atomic<size_t> next(0);
+	int workerCount = max(1, min((int)thread::hardware_concurrency(), (int)pending.size()));
+	vector<thread> workers;
+	for (int w = 0; w < workerCount; w++) {
+		workers.push_back(thread([&jobs, &pending, &next]() {
+			for (size_t i = next++; i < pending.size(); i = next++) {
+				CookJob &job = jobs[pending[i]];
+				chrono::steady_clock::time_point start = chrono::steady_clock::now();
+				job.succeeded = cook(job);
+				if (job.succeeded) {
+					logInfo(CATEGORY_ASSETS, "cooked {} {} in {} ms", cookRuleNames[job.rule], job.sourcePath,
+						chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+				}
+				else {
+					logError(CATEGORY_ASSETS, "failed to cook {}", job.sourcePath);
+				}
+			}
+		}));
+	}
+	for (int w = 0; w < workers.size(); w++) {
+		workers[w].join();
+	}
+}
+
+int main(int argc, char **argv) {
+	bool force = false;
+	bool packAssets = false;
+	string gameDirectory = ".";
+	for (int i = 1; i < argc; i++) {
+		if (string(argv[i]) == "--force") {
+			force = true;
+		}
+		else if (string(argv[i]) == "--compress") {
+			compressTextures = true;
+		}
+		else if (string(argv[i]) == "--pack") {
+			packAssets = true;
+		}
+		else {
+			gameDirectory = argv[i];
+		}
+	}
+
+	// the caches are keyed by the paths the game uses, which are relative to where it runs
+	error_code error;
+	fs::current_path(gameDirectory, error);
+	if (error || !fs::is_directory("res")) {
+		logError(CATEGORY_ASSETS, "{} has no res directory to cook", gameDirectory);
+		return 1;
+	}
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	vector<CookJob> jobs;
+	Assimp::Importer importer;
+	for (const fs::directory_entry &entry : fs::recursive_directory_iterator("res")) {
+		CookJob job;
+		if (!entry.is_regular_file() || !ruleFor(entry.path(), importer, job.rule, job.ruleVersion)) {
+			continue;
+		}
+		job.sourcePath = entry.path().generic_string();
+		job.inputs = inputsOf(entry.path(), job.rule);
+		job.succeeded = false;
+		jobs.push_back(job);
+	}
+
+	map<string, ManifestEntry> manifest;
+	if (!force) {
+		manifest = readManifest();
+	}
+	vector<int> pending;
+	int unreadable = 0;
+	for (int i = 0; i < jobs.size(); i++) {
+		if (!hashInputs(jobs[i])) {
+			unreadable++;
+		}
+		else if (isCooked(jobs[i], manifest)) {
+			jobs[i].succeeded = true;
+		}
+		else {
+			pending.push_back(i);
+		}
+	}
+
+	cookAll(jobs, pending);
+
+	int cooked = 0;
+	for (int i = 0; i < pending.size(); i++) {
+		if (jobs[pending[i]].succeeded) {
+			cooked++;
+		}
+	}
+	int failed = unreadable + (int)pending.size() - cooked;
+	if (!writeManifest(jobs)) {
+		logError(CATEGORY_ASSETS, "could not write {}", COOK_MANIFEST);
+		failed++;
+	}
+	if (packAssets && !pack()) {
+		failed++;
+	}
+	logInfo(CATEGORY_ASSETS, "cooked {} assets, {} up to date, {} failed, in {} s", cooked,
+		(int)jobs.size() - (int)pending.size() - unreadable, failed, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+	return failed > 0 ? 1 : 0;
+}